@@ -88,11 +88,15 @@ import org.mozilla.vrbrowser.utils.StringUtils;
 import org.mozilla.vrbrowser.utils.SystemUtils;
 
 import java.io.File;
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
 import java.util.ArrayList;
 import java.util.Arrays;
 import java.util.HashMap;
 import java.util.HashSet;
+import java.util.LinkedHashMap;
 import java.util.LinkedList;
+import java.util.Map;
 import java.util.Set;
 import java.util.concurrent.CopyOnWriteArrayList;
 import java.util.function.Consumer;
@@ -164,6 +168,9 @@ public class VRBrowserActivity extends PlatformActivity implements WidgetManager
     int mLastGesture;
     SwipeRunnable mLastRunnable;
     Handler mHandler = new Handler();
+    // Widget updates are coalesced by handle and sent to native code in one packed batch.
+    private final LinkedHashMap<Integer, WidgetPlacement> mPendingWidgetUpdates = new LinkedHashMap<>();
+    private final Runnable mFlushWidgetUpdates = this::flushWidgetUpdates;
     Runnable mAudioUpdateRunnable;
     Windows mWindows;
     RootWidget mRootWidget;
@@ -1333,7 +1340,12 @@ public class VRBrowserActivity extends PlatformActivity implements WidgetManager
         }
         final int handle = aWidget.getHandle();
         final WidgetPlacement clone = aWidget.getPlacement().clone();
-        queueRunnable(() -> updateWidgetNative(handle, clone));
+        if (mPendingWidgetUpdates.isEmpty()) {
+            mHandler.post(mFlushWidgetUpdates);
+        }
+        // Re-inserted so that the flush applies updates in the order they were last made.
+        mPendingWidgetUpdates.remove(handle);
+        mPendingWidgetUpdates.put(handle, clone);
 
         final int textureWidth = aWidget.getPlacement().textureWidth();
         final int textureHeight = aWidget.getPlacement().textureHeight();
@@ -1390,6 +1402,46 @@ public class VRBrowserActivity extends PlatformActivity implements WidgetManager
         queueRunnable(this::updateVisibleWidgetsNative);
     }
 
+    @Override
+    public void beginWidgetTransaction() {
+        queueRunnable(this::beginWidgetTransactionNative);
+    }
+
+    @Override
+    public void commitWidgetTransaction() {
+        queueRunnable(this::commitWidgetTransactionNative);
+    }
+
+    private void flushWidgetUpdates() {
+        mHandler.removeCallbacks(mFlushWidgetUpdates);
+        if (mPendingWidgetUpdates.isEmpty()) {
+            return;
+        }
+        int size = WidgetPlacement.PACKED_HEADER_SIZE;
+        for (WidgetPlacement placement: mPendingWidgetUpdates.values()) {
+            size += placement.packedSize();
+        }
+        final ByteBuffer buffer = ByteBuffer.allocateDirect(size).order(ByteOrder.nativeOrder());
+        buffer.putInt(WidgetPlacement.PACKED_VERSION);
+        buffer.putInt(mPendingWidgetUpdates.size());
+        for (Map.Entry<Integer, WidgetPlacement> entry: mPendingWidgetUpdates.entrySet()) {
+            entry.getValue().packInto(buffer, entry.getKey());
+        }
+        mPendingWidgetUpdates.clear();
+        final int packedSize = buffer.position();
+        super.queueRunnable(() -> updateWidgetsNative(buffer, packedSize));
+    }
+
+    // Pending widget updates are queued ahead of anything else so the render thread
+    // never sees a later call before the placements it was made with.
+    @Override
+    protected void queueRunnable(Runnable aRunnable) {
+        if (Looper.myLooper() == Looper.getMainLooper()) {
+            flushWidgetUpdates();
+        }
+        super.queueRunnable(aRunnable);
+    }
+
     @Override
     public void startWidgetResize(final Widget aWidget, float aMaxWidth, float aMaxHeight, float minWidth, float minHeight) {
         if (aWidget == null) {
@@ -1708,8 +1760,10 @@ public class VRBrowserActivity extends PlatformActivity implements WidgetManager
     }
 
     private native void addWidgetNative(int aHandle, WidgetPlacement aPlacement);
-    private native void updateWidgetNative(int aHandle, WidgetPlacement aPlacement);
+    private native void updateWidgetsNative(ByteBuffer aBuffer, int aSize);
     private native void updateVisibleWidgetsNative();
+    private native void beginWidgetTransactionNative();
+    private native void commitWidgetTransactionNative();
     private native void removeWidgetNative(int aHandle);
     private native void startWidgetResizeNative(int aHandle, float maxWidth, float maxHeight, float minWidth, float minHeight);
     private native void finishWidgetResizeNative(int aHandle);
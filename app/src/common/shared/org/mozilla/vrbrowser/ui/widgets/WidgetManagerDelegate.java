@@ -61,6 +61,9 @@ public interface WidgetManagerDelegate {
     void updateWidget(Widget aWidget);
     void removeWidget(Widget aWidget);
     void updateVisibleWidgets();
+    // Widget changes made between these calls are applied together at the start of the next frame.
+    void beginWidgetTransaction();
+    void commitWidgetTransaction();
     void startWidgetResize(Widget aWidget, float maxWidth, float maxHeight, float minWidth, float minHeight);
     void finishWidgetResize(Widget aWidget);
     void startWidgetMove(Widget aWidget, @WidgetMoveBehaviourFlags int aMoveBehaviour);
@@ -17,6 +17,9 @@ import androidx.annotation.NonNull;
 import org.mozilla.vrbrowser.R;
 import org.mozilla.vrbrowser.browser.SettingsStore;
 
+import java.nio.ByteBuffer;
+import java.nio.charset.StandardCharsets;
+
 public class WidgetPlacement {
     static final float WORLD_DPI_RATIO = 2.0f/720.0f;
 
@@ -71,6 +74,66 @@ public class WidgetPlacement {
      */
     public float cylinderMapRadius;
 
+    // Packed layout read by WidgetPlacement::FromBuffer in native code. Bump the version when
+    // the layout changes. A batch starts with the version and the record count.
+    public static final int PACKED_VERSION = 1;
+    public static final int PACKED_HEADER_SIZE = 8;
+    private static final int PACKED_RECORD_SIZE = 100;
+    private static final int PACKED_VISIBLE = 1;
+    private static final int PACKED_SHOW_POINTER = 1 << 1;
+    private static final int PACKED_COMPOSITED = 1 << 2;
+    private static final int PACKED_LAYER = 1 << 3;
+    private static final int PACKED_PROXIFY_LAYER = 1 << 4;
+    private static final int PACKED_CYLINDER = 1 << 5;
+
+    private byte[] packedName() {
+        return name != null ? name.getBytes(StandardCharsets.UTF_8) : new byte[0];
+    }
+
+    public int packedSize() {
+        return PACKED_RECORD_SIZE + ((packedName().length + 3) & ~3);
+    }
+
+    public void packInto(@NonNull ByteBuffer aBuffer, int aHandle) {
+        aBuffer.putInt(aHandle);
+        aBuffer.putInt(width);
+        aBuffer.putInt(height);
+        aBuffer.putFloat(anchorX);
+        aBuffer.putFloat(anchorY);
+        aBuffer.putFloat(translationX);
+        aBuffer.putFloat(translationY);
+        aBuffer.putFloat(translationZ);
+        aBuffer.putFloat(rotationAxisX);
+        aBuffer.putFloat(rotationAxisY);
+        aBuffer.putFloat(rotationAxisZ);
+        aBuffer.putFloat(rotation);
+        aBuffer.putInt(parentHandle);
+        aBuffer.putFloat(parentAnchorX);
+        aBuffer.putFloat(parentAnchorY);
+        aBuffer.putFloat(density);
+        aBuffer.putFloat(worldWidth);
+        int flags = 0;
+        flags |= visible ? PACKED_VISIBLE : 0;
+        flags |= showPointer ? PACKED_SHOW_POINTER : 0;
+        flags |= composited ? PACKED_COMPOSITED : 0;
+        flags |= layer ? PACKED_LAYER : 0;
+        flags |= proxifyLayer ? PACKED_PROXIFY_LAYER : 0;
+        flags |= cylinder ? PACKED_CYLINDER : 0;
+        aBuffer.putInt(flags);
+        aBuffer.putInt(scene);
+        aBuffer.putFloat(textureScale);
+        aBuffer.putFloat(cylinderMapRadius);
+        aBuffer.putInt(tintColor);
+        aBuffer.putInt(borderColor);
+        aBuffer.putInt(clearColor);
+        byte[] nameBytes = packedName();
+        aBuffer.putInt(nameBytes.length);
+        aBuffer.put(nameBytes);
+        for (int i = nameBytes.length; (i & 3) != 0; i++) {
+            aBuffer.put((byte)0);
+        }
+    }
+
     public WidgetPlacement clone() {
         WidgetPlacement w = new WidgetPlacement();
         w.copyFrom(this);
@@ -254,49 +254,55 @@ public class Windows implements TrayListener, TopBarWidget.Delegate, TitleBarWid
             return null;
         }
 
-        if (mFullscreenWindow != null) {
-            mFullscreenWindow.getSession().exitFullScreen();
-            onFullScreen(mFullscreenWindow, false);
-        }
-
-        WindowWidget frontWindow = getFrontWindow();
-        WindowWidget leftWindow = getLeftWindow();
-        WindowWidget rightWindow = getRightWindow();
+        WindowWidget newWindow;
+        mWidgetManager.beginWidgetTransaction();
+        try {
+            if (mFullscreenWindow != null) {
+                mFullscreenWindow.getSession().exitFullScreen();
+                onFullScreen(mFullscreenWindow, false);
+            }
 
-        WindowWidget newWindow = createWindow(null);
-        WindowWidget focusedWindow = getFocusedWindow();
+            WindowWidget frontWindow = getFrontWindow();
+            WindowWidget leftWindow = getLeftWindow();
+            WindowWidget rightWindow = getRightWindow();
+
+            newWindow = createWindow(null);
+            WindowWidget focusedWindow = getFocusedWindow();
+
+            if (frontWindow == null) {
+                // First window
+                placeWindow(newWindow, WindowPlacement.FRONT);
+            } else if (leftWindow == null && rightWindow == null) {
+                // Opening a new window from one window
+                placeWindow(newWindow, WindowPlacement.FRONT);
+                placeWindow(frontWindow, WindowPlacement.LEFT);
+            } else if (leftWindow != null && focusedWindow == leftWindow) {
+                // Opening a new window from left window
+                placeWindow(newWindow, WindowPlacement.FRONT);
+                placeWindow(frontWindow, WindowPlacement.RIGHT);
+            } else if (leftWindow != null && focusedWindow == frontWindow) {
+                // Opening a new window from front window
+                placeWindow(newWindow, WindowPlacement.FRONT);
+                placeWindow(frontWindow, WindowPlacement.RIGHT);
+            } else if (rightWindow != null && focusedWindow == rightWindow) {
+                // Opening a new window from right window
+                placeWindow(newWindow, WindowPlacement.FRONT);
+                placeWindow(frontWindow, WindowPlacement.LEFT);
+            } else if (rightWindow != null && focusedWindow == frontWindow) {
+                // Opening a new window from right window
+                placeWindow(newWindow, WindowPlacement.FRONT);
+                placeWindow(frontWindow, WindowPlacement.LEFT);
+            }
 
-        if (frontWindow == null) {
-            // First window
-            placeWindow(newWindow, WindowPlacement.FRONT);
-        } else if (leftWindow == null && rightWindow == null) {
-            // Opening a new window from one window
-            placeWindow(newWindow, WindowPlacement.FRONT);
-            placeWindow(frontWindow, WindowPlacement.LEFT);
-        } else if (leftWindow != null && focusedWindow == leftWindow) {
-            // Opening a new window from left window
-            placeWindow(newWindow, WindowPlacement.FRONT);
-            placeWindow(frontWindow, WindowPlacement.RIGHT);
-        } else if (leftWindow != null && focusedWindow == frontWindow) {
-            // Opening a new window from front window
-            placeWindow(newWindow, WindowPlacement.FRONT);
-            placeWindow(frontWindow, WindowPlacement.RIGHT);
-        } else if (rightWindow != null && focusedWindow == rightWindow) {
-            // Opening a new window from right window
-            placeWindow(newWindow, WindowPlacement.FRONT);
-            placeWindow(frontWindow, WindowPlacement.LEFT);
-        } else if (rightWindow != null && focusedWindow == frontWindow) {
-            // Opening a new window from right window
-            placeWindow(newWindow, WindowPlacement.FRONT);
-            placeWindow(frontWindow, WindowPlacement.LEFT);
+            updateMaxWindowScales();
+            mWidgetManager.addWidget(newWindow);
+            focusWindow(newWindow);
+            updateCurvedMode(true);
+            updateViews();
+        } finally {
+            mWidgetManager.commitWidgetTransaction();
         }
 
-        updateMaxWindowScales();
-        mWidgetManager.addWidget(newWindow);
-        focusWindow(newWindow);
-        updateCurvedMode(true);
-        updateViews();
-
         // We are only interested in general windows opened.
         if (!isInPrivateMode()) {
             GleanMetricsService.newWindowOpenEvent();
@@ -344,49 +350,54 @@ public class Windows implements TrayListener, TopBarWidget.Delegate, TitleBarWid
         WindowWidget leftWindow = getLeftWindow();
         WindowWidget rightWindow = getRightWindow();
 
-        aWindow.hidePanel(PanelType.BOOKMARKS);
-        aWindow.hidePanel(PanelType.HISTORY);
-        aWindow.hidePanel(PanelType.DOWNLOADS);
+        mWidgetManager.beginWidgetTransaction();
+        try {
+            aWindow.hidePanel(PanelType.BOOKMARKS);
+            aWindow.hidePanel(PanelType.HISTORY);
+            aWindow.hidePanel(PanelType.DOWNLOADS);
 
-        if (leftWindow == aWindow) {
-            removeWindow(leftWindow);
-            if (mFocusedWindow == leftWindow && frontWindow != null) {
-                focusWindow(frontWindow);
-            }
-        } else if (rightWindow == aWindow) {
-            removeWindow(rightWindow);
-            if (mFocusedWindow == rightWindow && frontWindow != null) {
-                focusWindow(frontWindow);
-            }
-        } else if (frontWindow == aWindow) {
-            removeWindow(frontWindow);
-            if (rightWindow != null) {
-                placeWindow(rightWindow, WindowPlacement.FRONT);
-            } else if (leftWindow != null) {
-                placeWindow(leftWindow, WindowPlacement.FRONT);
-            }
+            if (leftWindow == aWindow) {
+                removeWindow(leftWindow);
+                if (mFocusedWindow == leftWindow && frontWindow != null) {
+                    focusWindow(frontWindow);
+                }
+            } else if (rightWindow == aWindow) {
+                removeWindow(rightWindow);
+                if (mFocusedWindow == rightWindow && frontWindow != null) {
+                    focusWindow(frontWindow);
+                }
+            } else if (frontWindow == aWindow) {
+                removeWindow(frontWindow);
+                if (rightWindow != null) {
+                    placeWindow(rightWindow, WindowPlacement.FRONT);
+                } else if (leftWindow != null) {
+                    placeWindow(leftWindow, WindowPlacement.FRONT);
+                }
 
-            if (mFocusedWindow == frontWindow && !getCurrentWindows().isEmpty() && getFrontWindow() != null) {
-                focusWindow(getFrontWindow());
-            }
+                if (mFocusedWindow == frontWindow && !getCurrentWindows().isEmpty() && getFrontWindow() != null) {
+                    focusWindow(getFrontWindow());
+                }
 
-        }
+            }
 
-        boolean empty = getCurrentWindows().isEmpty();
-        if (empty && isInPrivateMode()) {
-            // Clear private tabs
-            SessionStore.get().destroyPrivateSessions();
-            // Exit private mode if the only window is closed.
-            exitPrivateMode();
-        } else if (empty) {
-            // Ensure that there is at least one window.
-            WindowWidget window = addWindow();
-            if (window != null) {
-                window.loadHome();
+            boolean empty = getCurrentWindows().isEmpty();
+            if (empty && isInPrivateMode()) {
+                // Clear private tabs
+                SessionStore.get().destroyPrivateSessions();
+                // Exit private mode if the only window is closed.
+                exitPrivateMode();
+            } else if (empty) {
+                // Ensure that there is at least one window.
+                WindowWidget window = addWindow();
+                if (window != null) {
+                    window.loadHome();
+                }
             }
-        }
 
-        updateViews();
+            updateViews();
+        } finally {
+            mWidgetManager.commitWidgetTransaction();
+        }
         if (mDelegate != null) {
             mDelegate.onWindowClosed();
         }
@@ -0,0 +1,19 @@
+/* -*- Mode: Java; c-basic-offset: 4; tab-width: 4; indent-tabs-mode: nil; -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+package org.mozilla.vrbrowser.utils;
+
+import android.graphics.SurfaceTexture;
+
+import androidx.annotation.Keep;
+
+// Batches the GeckoSurfaceTexture calls native code makes back to back, so they cost one JNI call.
+public class GeckoSurfaceTextureUtils {
+    @Keep
+    public static void updateAndReleaseTexImage(SurfaceTexture aSurface) {
+        aSurface.updateTexImage();
+        aSurface.releaseTexImage();
+    }
+}
@@ -0,0 +1,81 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "BenchmarkStats.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <numeric>
+#include <time.h>
+
+namespace crow {
+
+double
+CPUTimeMicroseconds() {
+  struct timespec ts = {};
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return (double)ts.tv_sec * 1e6 + (double)ts.tv_nsec * 1e-3;
+}
+
+double
+WallTimeMicroseconds() {
+  struct timespec ts = {};
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e6 + (double)ts.tv_nsec * 1e-3;
+}
+
+SampleSet::SampleSet(const std::string& aName) : mName(aName) {}
+
+void
+SampleSet::Reserve(const size_t aCount) {
+  mSamples.reserve(aCount);
+}
+
+void
+SampleSet::Add(const double aValue) {
+  mSamples.push_back(aValue);
+}
+
+double
+SampleSet::Percentile(const double aPercentile) const {
+  if (mSamples.empty()) {
+    return 0.0;
+  }
+  std::vector<double> sorted = mSamples;
+  std::sort(sorted.begin(), sorted.end());
+  const double rank = aPercentile / 100.0 * (double)(sorted.size() - 1);
+  return sorted[(size_t)std::lround(rank)];
+}
+
+double
+SampleSet::Mean() const {
+  if (mSamples.empty()) {
+    return 0.0;
+  }
+  return std::accumulate(mSamples.begin(), mSamples.end(), 0.0) / (double)mSamples.size();
+}
+
+size_t
+SampleSet::Count() const {
+  return mSamples.size();
+}
+
+void
+SampleSet::Print() const {
+  printf("%-24s n=%-6zu mean=%9.2f p50=%9.2f p95=%9.2f p99=%9.2f\n", mName.c_str(), mSamples.size(),
+         Mean(), Percentile(50.0), Percentile(95.0), Percentile(99.0));
+}
+
+ScopedPhase::ScopedPhase(SampleSet& aSamples)
+    : mSamples(aSamples)
+    , mStart(CPUTimeMicroseconds())
+{}
+
+ScopedPhase::~ScopedPhase() {
+  mSamples.Add(CPUTimeMicroseconds() - mStart);
+}
+
+} // namespace crow
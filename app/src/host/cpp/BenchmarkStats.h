@@ -0,0 +1,45 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef VRBROWSER_BENCHMARK_STATS_H
+#define VRBROWSER_BENCHMARK_STATS_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace crow {
+
+// Thread CPU time in microseconds.
+double CPUTimeMicroseconds();
+// Monotonic wall clock time in microseconds, includes time blocked on locks.
+double WallTimeMicroseconds();
+
+class SampleSet {
+public:
+  explicit SampleSet(const std::string& aName);
+  void Reserve(const size_t aCount);
+  void Add(const double aValue);
+  double Percentile(const double aPercentile) const;
+  double Mean() const;
+  size_t Count() const;
+  void Print() const;
+private:
+  std::string mName;
+  std::vector<double> mSamples;
+};
+
+class ScopedPhase {
+public:
+  explicit ScopedPhase(SampleSet& aSamples);
+  ~ScopedPhase();
+private:
+  SampleSet& mSamples;
+  double mStart;
+};
+
+} // namespace crow
+
+#endif // VRBROWSER_BENCHMARK_STATS_H
@@ -0,0 +1,332 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+// Blits a synthetic side by side WebXR frame through ExternalBlitter on an offscreen
+// Mesa context. Checks that drawing both eyes in one draw matches drawing each eye
+// into its own viewport, with an overlay layer and with a reprojected frame, and
+// times both paths. Exits with 1 on failure.
+//
+//   blitter-test [--frames N]
+
+#include "BenchmarkStats.h"
+#include "Expect.h"
+#include "ExternalBlitter.h"
+#include "GeckoSurfaceTextureHost.h"
+#include "HostEGL.h"
+
+#include "vrb/CreationContext.h"
+#include "vrb/gl.h"
+#include "vrb/Matrix.h"
+#include "vrb/RenderContext.h"
+
+#include <EGL/eglext.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+using namespace crow;
+
+namespace {
+
+const int32_t kFrameHandle = 1;
+const int32_t kOverlayHandle = 2;
+// The next SurfaceTexture Gecko rotates the overlay layer to.
+const int32_t kRotatedOverlayHandle = 3;
+// Size of the WebXR frame, both eyes side by side.
+const int32_t kFrameWidth = 64;
+const int32_t kFrameHeight = 32;
+// Size of the target the eyes are blitted into.
+const int32_t kTargetWidth = 128;
+const int32_t kTargetHeight = 64;
+const int kTolerance = 2;
+
+typedef std::vector<uint8_t> Pixels;
+
+// 2D texture filled with one color per eye, wrapped in an EGLImage and bound to an
+// external texture the way a SurfaceTexture is on Android.
+struct Source {
+  GLuint texture = 0;
+  GLuint external = 0;
+  EGLImageKHR image = EGL_NO_IMAGE_KHR;
+
+  bool Create(const HostEGL& aEGL, const uint8_t* aLeft, const uint8_t* aRight) {
+    Pixels pixels((size_t)(kFrameWidth * kFrameHeight * 4));
+    for (int32_t y = 0; y < kFrameHeight; y++) {
+      for (int32_t x = 0; x < kFrameWidth; x++) {
+        memcpy(&pixels[(size_t)((y * kFrameWidth + x) * 4)], x < kFrameWidth / 2 ? aLeft : aRight, 4);
+      }
+    }
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, kFrameWidth, kFrameHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    PFNEGLCREATEIMAGEKHRPROC createImage = (PFNEGLCREATEIMAGEKHRPROC)eglGetProcAddress("eglCreateImageKHR");
+    PFNGLEGLIMAGETARGETTEXTURE2DOESPROC targetTexture =
+        (PFNGLEGLIMAGETARGETTEXTURE2DOESPROC)eglGetProcAddress("glEGLImageTargetTexture2DOES");
+    if (!createImage || !targetTexture) {
+      Fail("EGLImage entry points missing");
+      return false;
+    }
+    const EGLint attribs[] = { EGL_GL_TEXTURE_LEVEL_KHR, 0, EGL_NONE };
+    image = createImage(aEGL.display, aEGL.context, EGL_GL_TEXTURE_2D_KHR, (EGLClientBuffer)(uintptr_t)texture, attribs);
+    if (image == EGL_NO_IMAGE_KHR) {
+      Fail("unable to create EGLImage: 0x%X", eglGetError());
+      return false;
+    }
+    glGenTextures(1, &external);
+    glBindTexture(GL_TEXTURE_EXTERNAL_OES, external);
+    targetTexture(GL_TEXTURE_EXTERNAL_OES, (GLeglImageOES)image);
+    glBindTexture(GL_TEXTURE_EXTERNAL_OES, 0);
+    return glGetError() == GL_NO_ERROR;
+  }
+
+  void Destroy(const HostEGL& aEGL) {
+    PFNEGLDESTROYIMAGEKHRPROC destroyImage = (PFNEGLDESTROYIMAGEKHRPROC)eglGetProcAddress("eglDestroyImageKHR");
+    glDeleteTextures(1, &external);
+    if (image != EGL_NO_IMAGE_KHR && destroyImage) {
+      destroyImage(aEGL.display, image);
+    }
+    glDeleteTextures(1, &texture);
+  }
+};
+
+struct Target {
+  GLuint texture = 0;
+  GLuint fbo = 0;
+
+  bool Create() {
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, kTargetWidth, kTargetHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glGenFramebuffers(1, &fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+    return glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+  }
+
+  void Clear() {
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glViewport(0, 0, kTargetWidth, kTargetHeight);
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+  }
+
+  Pixels Read() {
+    Pixels result((size_t)(kTargetWidth * kTargetHeight * 4));
+    glReadPixels(0, 0, kTargetWidth, kTargetHeight, GL_RGBA, GL_UNSIGNED_BYTE, result.data());
+    return result;
+  }
+
+  void Destroy() {
+    glDeleteFramebuffers(1, &fbo);
+    glDeleteTextures(1, &texture);
+  }
+};
+
+// Each eye into its own viewport, as on devices that bind one eye buffer at a time.
+void
+DrawPerEye(ExternalBlitter& aBlitter) {
+  const int32_t eyeWidth = kTargetWidth / 2;
+  glViewport(0, 0, eyeWidth, kTargetHeight);
+  aBlitter.Draw(device::Eye::Left);
+  glViewport(eyeWidth, 0, kTargetWidth - eyeWidth, kTargetHeight);
+  aBlitter.Draw(device::Eye::Right);
+}
+
+void
+ExpectSame(const char* aName, const Pixels& aExpected, const Pixels& aActual) {
+  int maxError = 0;
+  for (size_t i = 0; i < aExpected.size(); i++) {
+    maxError = std::max(maxError, abs((int)aExpected[i] - (int)aActual[i]));
+  }
+  if (maxError > kTolerance) {
+    Fail("%s: channels differ by up to %d", aName, maxError);
+  } else {
+    Pass(aName);
+  }
+}
+
+// Checks the center of each eye, away from filtered edges.
+void
+ExpectEyes(const char* aName, const Pixels& aPixels, const uint8_t* aLeft, const uint8_t* aRight) {
+  const int32_t y = kTargetHeight / 2;
+  const uint8_t* eyes[] = { aLeft, aRight };
+  for (int eye = 0; eye < 2; eye++) {
+    const int32_t x = kTargetWidth / 4 + eye * kTargetWidth / 2;
+    const uint8_t* pixel = &aPixels[(size_t)((y * kTargetWidth + x) * 4)];
+    for (int c = 0; c < 3; c++) {
+      if (abs((int)pixel[c] - (int)eyes[eye][c]) > kTolerance) {
+        Fail("%s: %s eye is (%d, %d, %d) expected (%d, %d, %d)", aName, eye ? "right" : "left",
+             pixel[0], pixel[1], pixel[2], eyes[eye][0], eyes[eye][1], eyes[eye][2]);
+        return;
+      }
+    }
+  }
+  Pass(aName);
+}
+
+} // namespace
+
+int
+main(int argc, char** argv) {
+  int32_t frames = 2000;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (strcmp(argv[i], "--frames") == 0) {
+      frames = atoi(argv[i + 1]);
+    }
+  }
+
+  HostEGL egl;
+  if (!egl.Initialize(64, 64)) {
+    egl.Shutdown();
+    return 1;
+  }
+  vrb::RenderContextPtr context = vrb::RenderContext::Create();
+  vrb::CreationContextPtr create = context->GetRenderThreadCreationContext();
+  ExternalBlitterPtr blitter = ExternalBlitter::Create(create);
+  context->InitializeGL();
+  // As BrowserWorld::InitializeGL() leaves it.
+  glEnable(GL_BLEND);
+  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+  glEnable(GL_DEPTH_TEST);
+  blitter->SetEnabledCapabilities(true, true);
+  blitter->SetBlendFunction(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+  const uint8_t red[] = { 255, 0, 0, 255 };
+  const uint8_t green[] = { 0, 255, 0, 255 };
+  // Premultiplied half transparent blue, as WebGL outputs it.
+  const uint8_t overlay[] = { 0, 0, 128, 128 };
+  const uint8_t redUnderOverlay[] = { 127, 0, 128, 255 };
+  const uint8_t greenUnderOverlay[] = { 0, 127, 128, 255 };
+  const uint8_t rotatedOverlay[] = { 128, 0, 0, 128 };
+  const uint8_t redUnderRotated[] = { 255, 0, 0, 255 };
+  const uint8_t greenUnderRotated[] = { 128, 127, 0, 255 };
+  Source frame;
+  Source overlayFrame;
+  Source rotatedOverlayFrame;
+  Target target;
+  if (!frame.Create(egl, red, green) || !overlayFrame.Create(egl, overlay, overlay) ||
+      !rotatedOverlayFrame.Create(egl, rotatedOverlay, rotatedOverlay) || !target.Create()) {
+    Fail("unable to create the test textures");
+    return ExitCode();
+  }
+  blitter->SetFramebuffer(target.fbo, 0, 0, kTargetWidth, kTargetHeight);
+  SetHostSurfaceTexture(kFrameHandle, frame.external);
+  SetHostSurfaceTexture(kOverlayHandle, overlayFrame.external);
+  SetHostSurfaceTexture(kRotatedOverlayHandle, rotatedOverlayFrame.external);
+  const device::EyeRect leftEye(0.0f, 0.0f, 0.5f, 1.0f);
+  const device::EyeRect rightEye(0.5f, 0.0f, 0.5f, 1.0f);
+
+  blitter->StartFrame(kFrameHandle, leftEye, rightEye);
+  target.Clear();
+  DrawPerEye(*blitter);
+  const Pixels perEye = target.Read();
+  target.Clear();
+  blitter->DrawStereo(kTargetWidth, kTargetHeight);
+  const Pixels stereo = target.Read();
+  ExpectEyes("per eye draw", perEye, red, green);
+  ExpectSame("stereo draw matches per eye draw", perEye, stereo);
+  Expect("depth test left enabled", glIsEnabled(GL_DEPTH_TEST) == GL_TRUE);
+
+  ExternalVR::FrameLayer layer = {};
+  layer.slot = 1;
+  layer.surfaceHandle = kOverlayHandle;
+  layer.frameId = 1;
+  layer.textureWidth = kFrameWidth;
+  layer.textureHeight = kFrameHeight;
+  target.Clear();
+  blitter->SetOverlayLayers(std::vector<ExternalVR::FrameLayer>(1, layer));
+  GLint boundFramebuffer = 0;
+  glGetIntegerv(GL_FRAMEBUFFER_BINDING, &boundFramebuffer);
+  Expect("framebuffer restored after overlay copy", (GLuint)boundFramebuffer == target.fbo);
+  target.Clear();
+  DrawPerEye(*blitter);
+  const Pixels overlayPerEye = target.Read();
+  target.Clear();
+  blitter->DrawStereo(kTargetWidth, kTargetHeight);
+  ExpectEyes("overlay per eye draw", overlayPerEye, redUnderOverlay, greenUnderOverlay);
+  ExpectSame("overlay stereo draw matches per eye draw", overlayPerEye, target.Read());
+  Expect("blending restored", glIsEnabled(GL_BLEND) == GL_TRUE);
+  GLint blendSource = 0;
+  glGetIntegerv(GL_BLEND_SRC_RGB, &blendSource);
+  Expect("blend function restored", blendSource == GL_SRC_ALPHA);
+
+  // A caller that draws without blending still gets blended overlays, and blending stays off.
+  glDisable(GL_BLEND);
+  blitter->SetEnabledCapabilities(true, false);
+  target.Clear();
+  blitter->DrawStereo(kTargetWidth, kTargetHeight);
+  ExpectEyes("overlay without caller blending", target.Read(), redUnderOverlay, greenUnderOverlay);
+  Expect("blending left disabled", glIsEnabled(GL_BLEND) == GL_FALSE);
+  glEnable(GL_BLEND);
+  blitter->SetEnabledCapabilities(true, true);
+
+  // The next frame of the same layer slot arrives in another SurfaceTexture.
+  layer.surfaceHandle = kRotatedOverlayHandle;
+  layer.frameId = 2;
+  blitter->SetOverlayLayers(std::vector<ExternalVR::FrameLayer>(1, layer));
+  target.Clear();
+  blitter->DrawStereo(kTargetWidth, kTargetHeight);
+  ExpectEyes("overlay from rotated surface", target.Read(), redUnderRotated, greenUnderRotated);
+  blitter->SetOverlayLayers(std::vector<ExternalVR::FrameLayer>());
+
+  // Reprojecting to the pose the frame was rendered at draws it unchanged.
+  const float halfFov = 45.0f * (float)M_PI / 180.0f;
+  const vrb::Matrix projection = vrb::Matrix::PerspectiveMatrix(halfFov, halfFov, halfFov, halfFov, 0.1f, 100.0f);
+  const vrb::Matrix head = vrb::Matrix::Identity();
+  blitter->KeepFrame(head, kFrameWidth, kFrameHeight);
+  blitter->EndFrame();
+  Expect("reprojected frame started", blitter->StartReprojectedFrame(head, projection, projection));
+  target.Clear();
+  DrawPerEye(*blitter);
+  const Pixels reprojectedPerEye = target.Read();
+  target.Clear();
+  blitter->DrawStereo(kTargetWidth, kTargetHeight);
+  ExpectEyes("reprojected per eye draw", reprojectedPerEye, red, green);
+  ExpectSame("reprojected stereo draw matches per eye draw", reprojectedPerEye, target.Read());
+  blitter->EndFrame();
+
+  SampleSet perEyeTime("Draw x2");
+  SampleSet stereoTime("DrawStereo");
+  perEyeTime.Reserve((size_t)frames);
+  stereoTime.Reserve((size_t)frames);
+  for (int32_t i = 0; i < frames; i++) {
+    blitter->StartFrame(kFrameHandle, leftEye, rightEye);
+    glBindFramebuffer(GL_FRAMEBUFFER, target.fbo);
+    {
+      ScopedPhase scope(perEyeTime);
+      DrawPerEye(*blitter);
+    }
+    {
+      ScopedPhase scope(stereoTime);
+      blitter->DrawStereo(kTargetWidth, kTargetHeight);
+    }
+    blitter->EndFrame();
+    glFinish();
+  }
+  printf("submit CPU time per frame in microseconds:\n");
+  perEyeTime.Print();
+  stereoTime.Print();
+
+  blitter->StopPresenting();
+  SetHostSurfaceTexture(kFrameHandle, 0);
+  SetHostSurfaceTexture(kOverlayHandle, 0);
+  SetHostSurfaceTexture(kRotatedOverlayHandle, 0);
+  frame.Destroy(egl);
+  overlayFrame.Destroy(egl);
+  rotatedOverlayFrame.Destroy(egl);
+  target.Destroy();
+  context->ShutdownGL();
+  blitter = nullptr;
+  egl.Shutdown();
+  return ExitCode();
+}
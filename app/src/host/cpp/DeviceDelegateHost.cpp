@@ -0,0 +1,251 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "DeviceDelegateHost.h"
+#include "GestureDelegate.h"
+
+#include "vrb/CameraEye.h"
+#include "vrb/Color.h"
+#include "vrb/ConcreteClass.h"
+#include "vrb/CreationContext.h"
+#include "vrb/GLError.h"
+#include "vrb/Matrix.h"
+#include "vrb/RenderContext.h"
+#include "vrb/Vector.h"
+
+#include <vector>
+
+namespace crow {
+
+static const float kIPD = 0.064f;
+static const float kFovDegrees = 45.0f;
+static const vrb::Vector kAverageHeight(0.0f, 1.7f, 0.0f);
+
+DeviceDelegateHost::ControllerPose::ControllerPose()
+    : transform(vrb::Matrix::Identity())
+    , pressed(false)
+{}
+
+struct DeviceDelegateHost::State {
+  vrb::RenderContextWeak context;
+  device::RenderMode renderMode;
+  ImmersiveDisplayPtr display;
+  ControllerDelegatePtr controller;
+  vrb::CameraEyePtr cameras[device::EyeCount];
+  vrb::Matrix head;
+  vrb::Matrix reorient;
+  vrb::Color clearColor;
+  std::vector<ControllerPose> poses;
+  Script script;
+  uint64_t frame;
+  int32_t glWidth, glHeight;
+  float near, far;
+  State()
+      : renderMode(device::RenderMode::StandAlone)
+      , head(vrb::Matrix::Translation(kAverageHeight))
+      , reorient(vrb::Matrix::Identity())
+      , frame(0)
+      , glWidth(1920)
+      , glHeight(1080)
+      , near(0.1f)
+      , far(100.0f)
+  {}
+
+  void Initialize() {
+    vrb::RenderContextPtr render = context.lock();
+    if (!render) {
+      return;
+    }
+    vrb::CreationContextPtr create = render->GetRenderThreadCreationContext();
+    for (int i = 0; i < device::EyeCount; ++i) {
+      cameras[i] = vrb::CameraEye::Create(create);
+    }
+    cameras[device::EyeIndex(device::Eye::Left)]->SetEyeTransform(vrb::Matrix::Translation(vrb::Vector(-kIPD * 0.5f, 0.0f, 0.0f)));
+    cameras[device::EyeIndex(device::Eye::Right)]->SetEyeTransform(vrb::Matrix::Translation(vrb::Vector(kIPD * 0.5f, 0.0f, 0.0f)));
+    UpdatePerspective();
+  }
+
+  void UpdatePerspective() {
+    const float fov = kFovDegrees * (float)M_PI / 180.0f;
+    vrb::Matrix projection = vrb::Matrix::PerspectiveMatrix(fov, fov, fov, fov, near, far);
+    for (vrb::CameraEyePtr& camera: cameras) {
+      if (camera) {
+        camera->SetPerspective(projection);
+      }
+    }
+    if (display) {
+      display->SetFieldOfView(device::Eye::Left, kFovDegrees, kFovDegrees, kFovDegrees, kFovDegrees);
+      display->SetFieldOfView(device::Eye::Right, kFovDegrees, kFovDegrees, kFovDegrees, kFovDegrees);
+      display->SetEyeResolution(glWidth / 2, glHeight);
+      display->SetEyeOffset(device::Eye::Left, -kIPD * 0.5f, 0.0f, 0.0f);
+      display->SetEyeOffset(device::Eye::Right, kIPD * 0.5f, 0.0f, 0.0f);
+    }
+  }
+};
+
+DeviceDelegateHostPtr
+DeviceDelegateHost::Create(vrb::RenderContextPtr& aContext, const int32_t aControllerCount) {
+  DeviceDelegateHostPtr result = std::make_shared<vrb::ConcreteClass<DeviceDelegateHost, DeviceDelegateHost::State> >();
+  result->m.context = aContext;
+  result->m.poses.resize((size_t)aControllerCount);
+  result->m.Initialize();
+  return result;
+}
+
+device::DeviceType
+DeviceDelegateHost::GetDeviceType() {
+  return device::OculusQuest;
+}
+
+void
+DeviceDelegateHost::SetRenderMode(const device::RenderMode aMode) {
+  m.renderMode = aMode;
+}
+
+device::RenderMode
+DeviceDelegateHost::GetRenderMode() {
+  return m.renderMode;
+}
+
+void
+DeviceDelegateHost::RegisterImmersiveDisplay(ImmersiveDisplayPtr aDisplay) {
+  m.display = std::move(aDisplay);
+  if (m.display) {
+    m.display->SetDeviceName("Host");
+    m.display->SetCapabilityFlags(device::Position | device::Orientation | device::Present |
+                                  device::InlineSession | device::ImmersiveVRSession);
+    m.UpdatePerspective();
+    m.display->CompleteEnumeration();
+  }
+}
+
+GestureDelegateConstPtr
+DeviceDelegateHost::GetGestureDelegate() {
+  return nullptr;
+}
+
+vrb::CameraPtr
+DeviceDelegateHost::GetCamera(const device::Eye aWhich) {
+  return m.cameras[device::EyeIndex(aWhich)];
+}
+
+const vrb::Matrix&
+DeviceDelegateHost::GetHeadTransform() const {
+  return m.head;
+}
+
+const vrb::Matrix&
+DeviceDelegateHost::GetReorientTransform() const {
+  return m.reorient;
+}
+
+void
+DeviceDelegateHost::SetReorientTransform(const vrb::Matrix& aMatrix) {
+  m.reorient = aMatrix;
+}
+
+void
+DeviceDelegateHost::SetClearColor(const vrb::Color& aColor) {
+  m.clearColor = aColor;
+}
+
+void
+DeviceDelegateHost::SetClipPlanes(const float aNear, const float aFar) {
+  m.near = aNear;
+  m.far = aFar;
+  m.UpdatePerspective();
+}
+
+void
+DeviceDelegateHost::SetControllerDelegate(ControllerDelegatePtr& aController) {
+  m.controller = aController;
+  for (int32_t index = 0; index < (int32_t)m.poses.size(); index++) {
+    m.controller->CreateController(index, -1, "Oculus Touch (Right)");
+    m.controller->SetEnabled(index, true);
+    m.controller->SetLeftHanded(index, (index % 2) == 1);
+    m.controller->SetCapabilityFlags(index, device::Orientation | device::Position);
+    m.controller->SetButtonCount(index, 2);
+  }
+}
+
+void
+DeviceDelegateHost::ReleaseControllerDelegate() {
+  m.controller = nullptr;
+}
+
+int32_t
+DeviceDelegateHost::GetControllerModelCount() const {
+  return 0;
+}
+
+const std::string
+DeviceDelegateHost::GetControllerModelName(const int32_t) const {
+  static const std::string name;
+  return name;
+}
+
+bool
+DeviceDelegateHost::SupportsFramePrediction(FramePrediction aPrediction) const {
+  return true;
+}
+
+void
+DeviceDelegateHost::ProcessEvents() {
+  if (m.script) {
+    m.script(m.frame, m.head, m.poses.data(), (int32_t)m.poses.size());
+  }
+  if (!m.controller) {
+    return;
+  }
+  for (int32_t index = 0; index < (int32_t)m.poses.size(); index++) {
+    const ControllerPose& pose = m.poses[index];
+    m.controller->SetTransform(index, pose.transform);
+    m.controller->SetButtonState(index, ControllerDelegate::BUTTON_TRIGGER, device::kImmersiveButtonTrigger,
+                                 pose.pressed, pose.pressed);
+  }
+}
+
+void
+DeviceDelegateHost::StartFrame(const FramePrediction aPrediction) {
+  m.frame++;
+  for (vrb::CameraEyePtr& camera: m.cameras) {
+    camera->SetHeadTransform(m.head);
+  }
+  VRB_GL_CHECK(glClearColor(m.clearColor.Red(), m.clearColor.Green(), m.clearColor.Blue(), m.clearColor.Alpha()));
+  VRB_GL_CHECK(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
+}
+
+void
+DeviceDelegateHost::BindEye(const device::Eye aWhich) {
+  const int32_t eyeWidth = m.glWidth / 2;
+  VRB_GL_CHECK(glViewport(aWhich == device::Eye::Left ? 0 : eyeWidth, 0, eyeWidth, m.glHeight));
+}
+
+void
+DeviceDelegateHost::EndFrame(const FrameEndMode aMode) {
+  // noop, the harness measures CPU submission cost only.
+}
+
+void
+DeviceDelegateHost::SetViewport(const int32_t aWidth, const int32_t aHeight) {
+  m.glWidth = aWidth;
+  m.glHeight = aHeight;
+  m.UpdatePerspective();
+}
+
+void
+DeviceDelegateHost::SetScript(const Script& aScript) {
+  m.script = aScript;
+}
+
+uint64_t
+DeviceDelegateHost::GetFrameCount() const {
+  return m.frame;
+}
+
+DeviceDelegateHost::DeviceDelegateHost(State& aState) : m(aState) {}
+DeviceDelegateHost::~DeviceDelegateHost() = default;
+
+} // namespace crow
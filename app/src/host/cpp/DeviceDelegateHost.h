@@ -0,0 +1,69 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef DEVICE_DELEGATE_HOST_DOT_H
+#define DEVICE_DELEGATE_HOST_DOT_H
+
+#include "vrb/Forward.h"
+#include "vrb/MacroUtils.h"
+#include "vrb/Matrix.h"
+#include "DeviceDelegate.h"
+
+#include <functional>
+#include <memory>
+
+namespace crow {
+
+class DeviceDelegateHost;
+typedef std::shared_ptr<DeviceDelegateHost> DeviceDelegateHostPtr;
+
+// Headless device used by the host benchmark harness. Head and controller poses
+// are driven by a script callback invoked from ProcessEvents() once per frame.
+class DeviceDelegateHost : public DeviceDelegate {
+public:
+  struct ControllerPose {
+    vrb::Matrix transform;
+    bool pressed;
+    ControllerPose();
+  };
+  typedef std::function<void(const uint64_t aFrame, vrb::Matrix& aHead, ControllerPose* aControllers, const int32_t aCount)> Script;
+
+  static DeviceDelegateHostPtr Create(vrb::RenderContextPtr& aContext, const int32_t aControllerCount);
+  // DeviceDelegate interface
+  device::DeviceType GetDeviceType() override;
+  void SetRenderMode(const device::RenderMode aMode) override;
+  device::RenderMode GetRenderMode() override;
+  void RegisterImmersiveDisplay(ImmersiveDisplayPtr aDisplay) override;
+  GestureDelegateConstPtr GetGestureDelegate() override;
+  vrb::CameraPtr GetCamera(const device::Eye aWhich) override;
+  const vrb::Matrix& GetHeadTransform() const override;
+  const vrb::Matrix& GetReorientTransform() const override;
+  void SetReorientTransform(const vrb::Matrix& aMatrix) override;
+  void SetClearColor(const vrb::Color& aColor) override;
+  void SetClipPlanes(const float aNear, const float aFar) override;
+  void SetControllerDelegate(ControllerDelegatePtr& aController) override;
+  void ReleaseControllerDelegate() override;
+  int32_t GetControllerModelCount() const override;
+  const std::string GetControllerModelName(const int32_t aModelIndex) const override;
+  bool SupportsFramePrediction(FramePrediction aPrediction) const override;
+  void ProcessEvents() override;
+  void StartFrame(const FramePrediction aPrediction) override;
+  void BindEye(const device::Eye aWhich) override;
+  void EndFrame(const FrameEndMode aMode) override;
+  // DeviceDelegateHost interface
+  void SetViewport(const int32_t aWidth, const int32_t aHeight);
+  void SetScript(const Script& aScript);
+  uint64_t GetFrameCount() const;
+protected:
+  struct State;
+  DeviceDelegateHost(State& aState);
+  virtual ~DeviceDelegateHost();
+private:
+  State& m;
+  VRB_NO_DEFAULTS(DeviceDelegateHost)
+};
+
+} // namespace crow
+#endif // DEVICE_DELEGATE_HOST_DOT_H
@@ -0,0 +1,56 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef VRBROWSER_EXPECT_H
+#define VRBROWSER_EXPECT_H
+
+#include <cstdarg>
+#include <cstdio>
+
+namespace crow {
+
+// Check reporting shared by the host tests: one "ok" or "FAIL" line per check and
+// a process exit code of 1 once any check failed.
+
+inline int&
+FailureCount() {
+  static int sFailures = 0;
+  return sFailures;
+}
+
+inline void
+Pass(const char* aName) {
+  printf("ok   %s\n", aName);
+}
+
+// Prints a FAIL line made from the printf style arguments.
+inline void
+Fail(const char* aFormat, ...) {
+  va_list args;
+  va_start(args, aFormat);
+  printf("FAIL ");
+  vprintf(aFormat, args);
+  printf("\n");
+  va_end(args);
+  FailureCount()++;
+}
+
+inline void
+Expect(const char* aName, const bool aPassed) {
+  if (aPassed) {
+    Pass(aName);
+  } else {
+    Fail("%s", aName);
+  }
+}
+
+inline int
+ExitCode() {
+  return FailureCount() > 0 ? 1 : 0;
+}
+
+} // namespace crow
+
+#endif // VRBROWSER_EXPECT_H
@@ -0,0 +1,337 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+// Headless frame-loop benchmark. Drives BrowserWorld with a scripted head and
+// controllers on an offscreen Mesa EGL context and reports per-phase CPU time.
+//
+//   frame-benchmark [--frames N] [--widgets W] [--controllers C] [--sweep MAX] [--drag HANDLE]
+//
+// With --sweep the run is repeated while the widget count doubles from 5 up to
+// MAX, so that per-frame cost can be plotted against widget count. With --drag
+// the first controller grabs the given root widget and keeps dragging it.
+// Use --widgets 50 --controllers 3 to measure the controller hit test broadphase.
+// Before measuring, widget transaction ordering is checked and the run exits with
+// 1 if it fails.
+
+#include "BenchmarkStats.h"
+#include "Expect.h"
+#include "BrowserWorld.h"
+#include "DeviceDelegateHost.h"
+#include "HostEGL.h"
+#include "WidgetPlacement.h"
+
+#include "vrb/Logger.h"
+#include "vrb/Matrix.h"
+#include "vrb/Vector.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <time.h>
+
+using namespace crow;
+
+namespace {
+
+// The splash animation runs for 2.6 seconds before the world is ticked.
+const double kWarmupSeconds = 3.0;
+const int32_t kSweepStart = 5;
+// Not used by the benchmark widgets.
+const int32_t kScratchHandle = 100000;
+
+struct Options {
+  int32_t frames;
+  int32_t widgets;
+  int32_t controllers;
+  int32_t sweep;
+  int32_t drag;
+  Options() : frames(2000), widgets(20), controllers(2), sweep(0), drag(0) {}
+};
+
+bool
+ParseOptions(int argc, char** argv, Options& aOptions) {
+  for (int i = 1; i < argc; i++) {
+    if ((i + 1) >= argc) {
+      return false;
+    }
+    const int32_t value = atoi(argv[i + 1]);
+    if (strcmp(argv[i], "--frames") == 0) {
+      aOptions.frames = value;
+    } else if (strcmp(argv[i], "--widgets") == 0) {
+      aOptions.widgets = value;
+    } else if (strcmp(argv[i], "--controllers") == 0) {
+      aOptions.controllers = value;
+    } else if (strcmp(argv[i], "--sweep") == 0) {
+      aOptions.sweep = value;
+    } else if (strcmp(argv[i], "--drag") == 0) {
+      aOptions.drag = value;
+    } else {
+      return false;
+    }
+    i++;
+  }
+  return aOptions.frames > 0 && aOptions.widgets >= 0 && aOptions.controllers >= 0;
+}
+
+double
+WallSeconds() {
+  struct timespec ts = {};
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+bool
+IsRootWidget(const int32_t aIndex) {
+  return (aIndex % 3) != 2;
+}
+
+vrb::Vector
+GridTranslation(const int32_t aIndex) {
+  const int32_t columns = 5;
+  const float column = (float)(aIndex % columns) - (float)(columns / 2);
+  const float row = (float)(aIndex / columns);
+  return vrb::Vector(column * 90.0f, 150.0f + row * 60.0f, -300.0f - (float)aIndex);
+}
+
+WidgetPlacementPtr
+CreatePlacement(const int32_t aIndex, const int32_t aHandle) {
+  WidgetPlacementPtr placement = WidgetPlacement::Create();
+  placement->width = 800;
+  placement->height = 450;
+  placement->density = 1.0f;
+  placement->textureScale = 1.0f;
+  placement->worldWidth = 1.0f;
+  placement->visible = true;
+  placement->showPointer = true;
+  placement->anchor = vrb::Vector(0.5f, 0.5f, 0.0f);
+  placement->scene = (int)WidgetPlacement::Scene::ROOT_TRANSPARENT;
+  placement->name = "widget";
+  if (!IsRootWidget(aIndex)) {
+    placement->parentHandle = aHandle - 1;
+    placement->parentAnchor = vrb::Vector(0.5f, 0.0f, 0.0f);
+    placement->anchor = vrb::Vector(0.5f, 1.0f, 0.0f);
+    placement->translation = vrb::Vector(0.0f, -10.0f, 1.0f);
+  } else {
+    placement->parentHandle = -1;
+    placement->translation = GridTranslation(aIndex);
+  }
+  return placement;
+}
+
+// Lay widgets out on a grid in front of the user. Every third widget is
+// parented to the widget before it so that the relayout path is exercised.
+void
+AddWidgets(const int32_t aFrom, const int32_t aTo) {
+  for (int32_t index = aFrom; index < aTo; index++) {
+    const int32_t handle = index + 1;
+    BrowserWorld::Instance().AddWidget(handle, CreatePlacement(index, handle));
+  }
+}
+
+// Adds widgets inside a transaction so that they land in the same frame.
+void
+AddWidgetsInTransaction(BrowserWorld& aWorld, const int32_t aFrom, const int32_t aTo) {
+  aWorld.BeginWidgetTransaction();
+  AddWidgets(aFrom, aTo);
+  aWorld.CommitWidgetTransaction();
+}
+
+// Java flushes pending widget updates right before adding a widget, so an update made
+// inside the transaction that adds a window reaches the world ahead of the add.
+void
+CheckUpdateBeforeAdd(BrowserWorld& aWorld) {
+  WidgetPlacementPtr placement = CreatePlacement(0, kScratchHandle);
+  aWorld.BeginWidgetTransaction();
+  aWorld.UpdateWidgetRecursive(kScratchHandle, placement);
+  aWorld.AddWidget(kScratchHandle, placement);
+  aWorld.CommitWidgetTransaction();
+  aWorld.Draw();
+  Expect("update queued before add adds the widget", aWorld.HasWidget(kScratchHandle));
+  aWorld.RemoveWidget(kScratchHandle);
+  aWorld.Draw();
+  Expect("removed widget is gone", !aWorld.HasWidget(kScratchHandle));
+}
+
+// A transaction committed right before the next one begins is applied with it.
+void
+CheckOverlappingTransactions(BrowserWorld& aWorld) {
+  WidgetPlacementPtr placement = CreatePlacement(0, kScratchHandle);
+  aWorld.BeginWidgetTransaction();
+  aWorld.AddWidget(kScratchHandle, placement);
+  aWorld.CommitWidgetTransaction();
+  aWorld.BeginWidgetTransaction();
+  aWorld.UpdateVisibleWidgets();
+  aWorld.Draw();
+  Expect("open transaction is not applied", !aWorld.HasWidget(kScratchHandle));
+  aWorld.CommitWidgetTransaction();
+  aWorld.Draw();
+  Expect("both transactions applied on commit", aWorld.HasWidget(kScratchHandle));
+  aWorld.RemoveWidget(kScratchHandle);
+  aWorld.Draw();
+}
+
+void
+Script(const uint64_t aFrame, vrb::Matrix& aHead, DeviceDelegateHost::ControllerPose* aControllers,
+       const int32_t aCount) {
+  const float t = (float)aFrame / 72.0f;
+  const float yaw = 0.4f * sinf(t);
+  aHead = vrb::Matrix::Rotation(vrb::Vector(0.0f, 1.0f, 0.0f), yaw)
+      .PostMultiply(vrb::Matrix::Translation(vrb::Vector(0.0f, 1.7f, 0.0f)));
+  for (int32_t index = 0; index < aCount; index++) {
+    const float phase = t + (float)index;
+    const float x = (index % 2 == 0 ? 0.2f : -0.2f);
+    aControllers[index].transform = vrb::Matrix::Rotation(vrb::Vector(0.0f, 1.0f, 0.0f), 0.6f * sinf(phase))
+        .PostMultiply(vrb::Matrix::Rotation(vrb::Vector(1.0f, 0.0f, 0.0f), 0.3f * cosf(phase)))
+        .PostMultiply(vrb::Matrix::Translation(vrb::Vector(x, 1.2f, -0.3f)));
+    aControllers[index].pressed = ((aFrame / 36) % 4) == (uint64_t)index;
+  }
+}
+
+void
+RunFrames(BrowserWorld& aWorld, const int32_t aFrames, const int32_t aWidgets, const int32_t aControllers) {
+  SampleSet startFrame("StartFrame");
+  SampleSet drawLeft("Draw(Left)");
+  SampleSet drawRight("Draw(Right)");
+  SampleSet endFrame("EndFrame");
+  SampleSet total("Frame");
+  SampleSet layout("LayoutWidget(all)");
+  SampleSet touched("Widgets relaid/frame");
+  for (SampleSet* samples: {&startFrame, &drawLeft, &drawRight, &endFrame, &total, &layout, &touched}) {
+    samples->Reserve((size_t)aFrames);
+  }
+  uint64_t sortFramesStart = 0, sortSkippedStart = 0;
+  aWorld.GetDepthSortStats(sortFramesStart, sortSkippedStart);
+  uint64_t hitExactStart = 0, hitSkippedStart = 0, hitBatchedStart = 0;
+  aWorld.GetHitTestStats(hitExactStart, hitSkippedStart, hitBatchedStart);
+  uint64_t cacheHitsStart = 0, cacheMissesStart = 0;
+  aWorld.GetTransformCacheStats(cacheHitsStart, cacheMissesStart);
+
+  for (int32_t frame = 0; frame < aFrames; frame++) {
+    uint64_t passes = 0, touchedBefore = 0, touchedAfter = 0;
+    aWorld.GetLayoutStats(passes, touchedBefore);
+    {
+      ScopedPhase frameScope(total);
+      {
+        ScopedPhase scope(startFrame);
+        aWorld.StartFrame();
+      }
+      {
+        ScopedPhase scope(drawLeft);
+        aWorld.Draw(device::Eye::Left);
+      }
+      {
+        ScopedPhase scope(drawRight);
+        aWorld.Draw(device::Eye::Right);
+      }
+      {
+        ScopedPhase scope(endFrame);
+        aWorld.EndFrame();
+      }
+    }
+    aWorld.GetLayoutStats(passes, touchedAfter);
+    touched.Add((double)(touchedAfter - touchedBefore));
+    // Handle lookups dominate relayout, which Java triggers on every window move.
+    ScopedPhase scope(layout);
+    for (int32_t handle = 1; handle <= aWidgets; handle++) {
+      aWorld.LayoutWidget(handle);
+    }
+  }
+
+  printf("frames=%d widgets=%d controllers=%d (thread CPU time, microseconds)\n",
+         aFrames, aWidgets, aControllers);
+  for (SampleSet* samples: {&startFrame, &drawLeft, &drawRight, &endFrame, &total, &layout, &touched}) {
+    samples->Print();
+  }
+  uint64_t sortFrames = 0, sortSkipped = 0;
+  aWorld.GetDepthSortStats(sortFrames, sortSkipped);
+  printf("depth sort: %llu of %llu frames skipped the full sort\n",
+         (unsigned long long)(sortSkipped - sortSkippedStart), (unsigned long long)(sortFrames - sortFramesStart));
+  uint64_t hitExact = 0, hitSkipped = 0, hitBatched = 0;
+  aWorld.GetHitTestStats(hitExact, hitSkipped, hitBatched);
+  printf("hit tests: %llu exact, %llu rejected by bounding spheres, %llu batched quads\n",
+         (unsigned long long)(hitExact - hitExactStart), (unsigned long long)(hitSkipped - hitSkippedStart),
+         (unsigned long long)(hitBatched - hitBatchedStart));
+  uint64_t cacheHits = 0, cacheMisses = 0;
+  aWorld.GetTransformCacheStats(cacheHits, cacheMisses);
+  printf("transform cache: %llu hits, %llu misses\n",
+         (unsigned long long)(cacheHits - cacheHitsStart), (unsigned long long)(cacheMisses - cacheMissesStart));
+}
+
+} // namespace
+
+int
+main(int argc, char** argv) {
+  Options options;
+  if (!ParseOptions(argc, argv, options)) {
+    fprintf(stderr, "usage: %s [--frames N] [--widgets W] [--controllers C] [--sweep MAX] [--drag HANDLE]\n", argv[0]);
+    return 1;
+  }
+
+  const int32_t width = 1920;
+  const int32_t height = 1080;
+  HostEGL egl;
+  if (!egl.Initialize(width, height)) {
+    egl.Shutdown();
+    return 1;
+  }
+
+  BrowserWorld& world = BrowserWorld::Instance();
+  DeviceDelegateHostPtr host = DeviceDelegateHost::Create(world.GetRenderContext(), options.controllers);
+  host->SetViewport(width, height);
+  world.RegisterDeviceDelegate(host);
+  world.InitializeGL();
+  world.Resume();
+  AddWidgetsInTransaction(world, 0, options.sweep > 0 ? 0 : options.widgets);
+  host->SetScript(Script);
+  if (options.drag > 0 && IsRootWidget(options.drag - 1)) {
+    // Keep the first controller pressed and aimed at the widget, sweeping sideways.
+    const vrb::Vector grid = GridTranslation(options.drag - 1);
+    const float targetX = grid.x() * WidgetPlacement::kWorldDPIRatio;
+    const float targetY = grid.y() * WidgetPlacement::kWorldDPIRatio;
+    host->SetScript([=](const uint64_t aFrame, vrb::Matrix& aHead, DeviceDelegateHost::ControllerPose* aControllers,
+                        const int32_t aCount) {
+      Script(aFrame, aHead, aControllers, aCount);
+      if (aCount > 0) {
+        const float sweep = 0.05f * sinf((float)aFrame / 72.0f);
+        aControllers[0].transform = vrb::Matrix::Translation(vrb::Vector(targetX + sweep, targetY, -0.3f));
+        aControllers[0].pressed = true;
+      }
+    });
+  }
+
+  const double warmupEnd = WallSeconds() + kWarmupSeconds;
+  while (WallSeconds() < warmupEnd) {
+    world.Draw();
+  }
+  CheckUpdateBeforeAdd(world);
+  CheckOverlappingTransactions(world);
+  if (options.drag > 0) {
+    world.StartWidgetMove(options.drag, 0);
+  }
+
+  if (options.sweep <= 0) {
+    RunFrames(world, options.frames, options.widgets, options.controllers);
+  } else {
+    int32_t count = 0;
+    for (int32_t target = kSweepStart; target <= options.sweep; target *= 2) {
+      AddWidgetsInTransaction(world, count, target);
+      count = target;
+      RunFrames(world, options.frames, count, options.controllers);
+    }
+  }
+
+  uint64_t commits = 0, queued = 0, applied = 0;
+  world.GetWidgetTransactionStats(commits, queued, applied);
+  printf("widget transactions: %llu commits, %llu changes queued, %llu applied\n",
+         (unsigned long long)commits, (unsigned long long)queued, (unsigned long long)applied);
+
+  world.Pause();
+  world.ShutdownGL();
+  world.RegisterDeviceDelegate(nullptr);
+  BrowserWorld::Destroy();
+  egl.Shutdown();
+  return ExitCode();
+}
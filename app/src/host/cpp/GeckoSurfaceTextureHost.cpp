@@ -0,0 +1,95 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+// Host replacement for GeckoSurfaceTexture.cpp. Gecko surfaces only exist on
+// Android, so lookups fail the same way they do before Java is initialized unless
+// a test registered a texture for the handle.
+
+#include "GeckoSurfaceTextureHost.h"
+#include "vrb/ConcreteClass.h"
+#include "vrb/Logger.h"
+
+#include <map>
+
+namespace {
+
+std::map<int32_t, GLuint> sTextures;
+
+}
+
+namespace crow {
+
+void
+SetHostSurfaceTexture(const int32_t aHandle, const GLuint aTexture) {
+  if (aTexture) {
+    sTextures[aHandle] = aTexture;
+  } else {
+    sTextures.erase(aHandle);
+  }
+}
+
+struct GeckoSurfaceTexture::State {
+  GLuint texture;
+  State() : texture(0) {}
+};
+
+void
+GeckoSurfaceTexture::InitializeJava(JNIEnv*, jobject) {}
+
+void
+GeckoSurfaceTexture::ShutdownJava() {}
+
+GeckoSurfaceTexturePtr
+GeckoSurfaceTexture::Create(const int32_t aHandle) {
+  std::map<int32_t, GLuint>::const_iterator iter = sTextures.find(aHandle);
+  if (iter == sTextures.end()) {
+    VRB_ERROR("Unable to create GeckoSurfaceTexture for handle %d on host", aHandle);
+    return nullptr;
+  }
+  auto result = std::make_shared<vrb::ConcreteClass<GeckoSurfaceTexture, GeckoSurfaceTexture::State> >();
+  result->texture = iter->second;
+  return result;
+}
+
+uint64_t
+GeckoSurfaceTexture::GetJNICallCount() {
+  return 0;
+}
+
+GLuint
+GeckoSurfaceTexture::GetTextureName() {
+  return m.texture;
+}
+
+void
+GeckoSurfaceTexture::AttachToGLContext(EGLContext) {}
+
+bool
+GeckoSurfaceTexture::IsAttachedToGLContext(EGLContext) const {
+  return false;
+}
+
+void
+GeckoSurfaceTexture::DetachFromGLContext() {}
+
+void
+GeckoSurfaceTexture::UpdateTexImage() {}
+
+void
+GeckoSurfaceTexture::ReleaseTexImage() {}
+
+void
+GeckoSurfaceTexture::UpdateAndReleaseTexImage() {}
+
+void
+GeckoSurfaceTexture::IncrementUse() {}
+
+void
+GeckoSurfaceTexture::DecrementUse() {}
+
+GeckoSurfaceTexture::GeckoSurfaceTexture(State& aState) : m(aState) {}
+GeckoSurfaceTexture::~GeckoSurfaceTexture() = default;
+
+} // namespace crow
@@ -0,0 +1,19 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef VRBROWSER_GECKO_SURFACE_TEXTURE_HOST_H
+#define VRBROWSER_GECKO_SURFACE_TEXTURE_HOST_H
+
+#include "GeckoSurfaceTexture.h"
+
+namespace crow {
+
+// Makes GeckoSurfaceTexture::Create(aHandle) return a surface that samples aTexture,
+// a GL_TEXTURE_EXTERNAL_OES texture owned by the caller. Zero removes the handle.
+void SetHostSurfaceTexture(const int32_t aHandle, const GLuint aTexture);
+
+} // namespace crow
+
+#endif // VRBROWSER_GECKO_SURFACE_TEXTURE_HOST_H
@@ -0,0 +1,174 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+// Compares controller rays against N quads through Quad::TestIntersection with
+// the batched QuadHitBatch kernel, and checks that both report the same hits.
+//
+//   hit-test-benchmark [--iterations N] [--quads Q] [--controllers C]
+
+#include "BenchmarkStats.h"
+#include "HostEGL.h"
+#include "Quad.h"
+#include "QuadHitBatch.h"
+
+#include "vrb/CreationContext.h"
+#include "vrb/Matrix.h"
+#include "vrb/RenderContext.h"
+#include "vrb/Transform.h"
+#include "vrb/Vector.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+using namespace crow;
+
+namespace {
+
+// Relative distance error allowed between the kernel and Quad::TestIntersection.
+const float kDistanceTolerance = 0.0001f;
+// Rays grazing a quad edge may land on either side in float math.
+const double kMismatchTolerance = 0.0001;
+
+float
+Random(const float aMin, const float aMax) {
+  return aMin + (aMax - aMin) * ((float)rand() / (float)RAND_MAX);
+}
+
+struct Ray {
+  vrb::Vector start;
+  vrb::Vector direction;
+};
+
+} // namespace
+
+int
+main(int argc, char** argv) {
+  int32_t iterations = 2000;
+  int32_t quadCount = 50;
+  int32_t controllers = 3;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (strcmp(argv[i], "--iterations") == 0) {
+      iterations = atoi(argv[i + 1]);
+    } else if (strcmp(argv[i], "--quads") == 0) {
+      quadCount = atoi(argv[i + 1]);
+    } else if (strcmp(argv[i], "--controllers") == 0) {
+      controllers = atoi(argv[i + 1]);
+    }
+  }
+
+  HostEGL egl;
+  if (!egl.Initialize(64, 64)) {
+    egl.Shutdown();
+    return 1;
+  }
+  vrb::RenderContextPtr context = vrb::RenderContext::Create();
+  context->InitializeGL();
+  vrb::CreationContextPtr create = context->GetRenderThreadCreationContext();
+
+  // Quads on a rough shell around the user, some tilted, under a reoriented root.
+  srand(1);
+  vrb::TransformPtr root = vrb::Transform::Create(create);
+  root->SetTransform(vrb::Matrix::Rotation(vrb::Vector(0.0f, 1.0f, 0.0f), 0.1f));
+  std::vector<QuadPtr> quads;
+  for (int32_t i = 0; i < quadCount; i++) {
+    QuadPtr quad = Quad::Create(create, Random(0.5f, 3.0f), Random(0.3f, 2.0f));
+    vrb::TransformPtr transform = vrb::Transform::Create(create);
+    vrb::Matrix matrix = vrb::Matrix::Rotation(vrb::Vector(Random(-0.2f, 0.2f), 1.0f, 0.0f).Normalize(), Random(-0.8f, 0.8f));
+    matrix.TranslateInPlace(vrb::Vector(Random(-4.0f, 4.0f), Random(-1.0f, 2.5f), Random(-6.0f, -1.5f)));
+    transform->SetTransform(matrix);
+    transform->AddNode(quad->GetRoot());
+    root->AddNode(transform);
+    quads.push_back(quad);
+  }
+
+  const int32_t rayCount = iterations * controllers;
+  std::vector<Ray> rays((size_t)rayCount);
+  for (Ray& ray: rays) {
+    ray.start = vrb::Vector(Random(-0.3f, 0.3f), Random(1.0f, 1.6f), Random(-0.3f, 0.3f));
+    ray.direction = vrb::Vector(Random(-0.8f, 0.8f), Random(-0.4f, 0.6f), -1.0f).Normalize();
+  }
+
+  QuadHitBatchPtr batch = QuadHitBatch::Create();
+  std::vector<float> scalarDistances((size_t)quadCount);
+  std::vector<float> batchDistances;
+  std::vector<float> referenceDistances;
+  SampleSet scalar("Quad::TestIntersection x" + std::to_string(quadCount));
+  SampleSet batched("QuadHitBatch x" + std::to_string(quadCount));
+  SampleSet batchedScalar("QuadHitBatch(scalar) x" + std::to_string(quadCount));
+  for (SampleSet* samples: {&scalar, &batched, &batchedScalar}) {
+    samples->Reserve((size_t)iterations);
+  }
+  size_t mismatches = 0;
+  size_t checks = 0;
+  size_t hits = 0;
+  float maxError = 0.0f;
+  for (int32_t iteration = 0; iteration < iterations; iteration++) {
+    const Ray* frameRays = &rays[(size_t)(iteration * controllers)];
+    // Each sample is one frame: every controller against every quad.
+    {
+      ScopedPhase scope(scalar);
+      for (int32_t c = 0; c < controllers; c++) {
+        for (size_t i = 0; i < quads.size(); i++) {
+          vrb::Vector result, normal;
+          bool inside = false;
+          float distance = -1.0f;
+          quads[i]->TestIntersection(frameRays[c].start, frameRays[c].direction, result, normal, true, inside, distance);
+          scalarDistances[i] = inside ? distance : -1.0f;
+        }
+      }
+    }
+    for (SampleSet* samples: {&batched, &batchedScalar}) {
+      ScopedPhase scope(*samples);
+      batch->Clear();
+      for (const QuadPtr& quad: quads) {
+        vrb::Matrix inverse;
+        vrb::Vector point, normal, min, max;
+        quad->GetHitPlane(inverse, point, normal);
+        quad->GetHitBounds(min, max);
+        batch->Add(inverse, point, normal, min, max);
+      }
+      for (int32_t c = 0; c < controllers; c++) {
+        if (samples == &batched) {
+          batch->Intersect(frameRays[c].start, frameRays[c].direction, batchDistances);
+        } else {
+          batch->IntersectScalar(frameRays[c].start, frameRays[c].direction, referenceDistances);
+        }
+      }
+    }
+
+    // Validate the last controller of the frame, which both paths computed last.
+    for (size_t i = 0; i < quads.size(); i++) {
+      const float expected = scalarDistances[i];
+      for (const float actual: {batchDistances[i], referenceDistances[i]}) {
+        checks++;
+        if ((expected >= 0.0f) != (actual >= 0.0f)) {
+          mismatches++;
+        } else if (expected >= 0.0f) {
+          hits++;
+          maxError = std::max(maxError, fabsf(expected - actual) / std::max(1.0f, expected));
+        }
+      }
+    }
+  }
+
+  printf("iterations=%d quads=%d controllers=%d (thread CPU time, microseconds per frame)\n",
+         iterations, quadCount, controllers);
+  scalar.Print();
+  batched.Print();
+  batchedScalar.Print();
+  printf("validated %zu hits, %zu inside mismatches, max relative distance error %g\n",
+         hits, mismatches, maxError);
+
+  quads.clear();
+  root = nullptr;
+  context->ShutdownGL();
+  egl.Shutdown();
+  const bool matches = ((double)mismatches <= kMismatchTolerance * (double)checks) && (maxError <= kDistanceTolerance);
+  return matches ? 0 : 1;
+}
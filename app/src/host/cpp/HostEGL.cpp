@@ -0,0 +1,61 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "HostEGL.h"
+
+#include "vrb/Logger.h"
+
+#include <EGL/eglext.h>
+
+namespace crow {
+
+bool
+HostEGL::Initialize(const int32_t aWidth, const int32_t aHeight) {
+  display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+  if (display == EGL_NO_DISPLAY || !eglInitialize(display, nullptr, nullptr)) {
+    VRB_ERROR("Unable to initialize EGL display");
+    return false;
+  }
+  const EGLint configAttribs[] = {
+      EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+      EGL_RENDERABLE_TYPE, EGL_OPENGL_ES3_BIT_KHR,
+      EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8, EGL_ALPHA_SIZE, 8,
+      EGL_DEPTH_SIZE, 24,
+      EGL_NONE
+  };
+  EGLConfig config;
+  EGLint count = 0;
+  if (!eglChooseConfig(display, configAttribs, &config, 1, &count) || count == 0) {
+    VRB_ERROR("Unable to find an ES3 pbuffer EGL config");
+    return false;
+  }
+  const EGLint surfaceAttribs[] = { EGL_WIDTH, aWidth, EGL_HEIGHT, aHeight, EGL_NONE };
+  surface = eglCreatePbufferSurface(display, config, surfaceAttribs);
+  eglBindAPI(EGL_OPENGL_ES_API);
+  const EGLint contextAttribs[] = { EGL_CONTEXT_CLIENT_VERSION, 3, EGL_NONE };
+  context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttribs);
+  if (surface == EGL_NO_SURFACE || context == EGL_NO_CONTEXT) {
+    VRB_ERROR("Unable to create EGL surface or context");
+    return false;
+  }
+  return eglMakeCurrent(display, surface, surface, context) == EGL_TRUE;
+}
+
+void
+HostEGL::Shutdown() {
+  if (display == EGL_NO_DISPLAY) {
+    return;
+  }
+  eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+  if (context != EGL_NO_CONTEXT) {
+    eglDestroyContext(display, context);
+  }
+  if (surface != EGL_NO_SURFACE) {
+    eglDestroySurface(display, surface);
+  }
+  eglTerminate(display);
+}
+
+} // namespace crow
@@ -0,0 +1,26 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef VRBROWSER_HOST_EGL_H
+#define VRBROWSER_HOST_EGL_H
+
+#include <EGL/egl.h>
+#include <stdint.h>
+
+namespace crow {
+
+// Offscreen ES3 pbuffer context made current on the calling thread.
+struct HostEGL {
+  EGLDisplay display = EGL_NO_DISPLAY;
+  EGLSurface surface = EGL_NO_SURFACE;
+  EGLContext context = EGL_NO_CONTEXT;
+
+  bool Initialize(const int32_t aWidth, const int32_t aHeight);
+  void Shutdown();
+};
+
+} // namespace crow
+
+#endif // VRBROWSER_HOST_EGL_H
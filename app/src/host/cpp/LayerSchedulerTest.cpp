@@ -0,0 +1,210 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+// Checks that LayerScheduler keeps layers in the order a full sort by
+// VRLayer::ShouldDrawBefore() gives, and that it only sorts all layers when a
+// layer is added or a priority or draw in front flag changes. Then replays
+// random frames against a full sort per frame and times both. Exits with 1 on
+// failure.
+//
+//   layer-scheduler-test [--layers N] [--frames F]
+
+#include "BenchmarkStats.h"
+#include "Expect.h"
+#include "LayerScheduler.h"
+#include "VRLayer.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+using namespace crow;
+
+namespace {
+
+// Stands in for a device's own layer type.
+struct TestLayer {
+  VRLayerQuadPtr layer;
+  VRLayerPtr GetLayer() const { return layer; }
+};
+typedef std::shared_ptr<TestLayer> TestLayerPtr;
+typedef LayerScheduler<TestLayerPtr> Scheduler;
+
+TestLayerPtr
+CreateLayer(const int32_t aPriority) {
+  TestLayerPtr result = std::make_shared<TestLayer>();
+  result->layer = VRLayerQuad::Create(64, 64, VRLayerSurface::SurfaceType::AndroidSurface);
+  result->layer->SetPriority(aPriority);
+  return result;
+}
+
+bool
+DrawsBefore(const TestLayerPtr& aFirst, const TestLayerPtr& aSecond) {
+  if (aFirst->layer->GetDrawInFront() != aSecond->layer->GetDrawInFront()) {
+    return !aFirst->layer->GetDrawInFront();
+  }
+  return aFirst->layer->ShouldDrawBefore(*aSecond->layer);
+}
+
+// Draw requests of a frame, in the order the world makes them.
+void
+RequestDraws(const std::vector<TestLayerPtr>& aLayers) {
+  for (const TestLayerPtr& layer: aLayers) {
+    layer->layer->ClearRequestDraw();
+  }
+  for (const TestLayerPtr& layer: aLayers) {
+    layer->layer->RequestDraw();
+  }
+}
+
+bool
+IsOrdered(const Scheduler& aScheduler) {
+  const std::vector<TestLayerPtr>& layers = aScheduler.GetLayers();
+  for (size_t i = 1; i < layers.size(); i++) {
+    if (DrawsBefore(layers[i], layers[i - 1])) {
+      return false;
+    }
+  }
+  for (size_t i = 0; i < layers.size(); i++) {
+    if (layers[i]->layer->GetDrawInFront() != (i >= aScheduler.GetFrontIndex())) {
+      return false;
+    }
+  }
+  return true;
+}
+
+uint64_t
+FullSorts(const Scheduler& aScheduler) {
+  uint64_t fullSorts = 0, moves = 0;
+  aScheduler.GetStats(fullSorts, moves);
+  return fullSorts;
+}
+
+uint64_t
+Moves(const Scheduler& aScheduler) {
+  uint64_t fullSorts = 0, moves = 0;
+  aScheduler.GetStats(fullSorts, moves);
+  return moves;
+}
+
+void
+TestOrdering() {
+  Scheduler scheduler;
+  std::vector<TestLayerPtr> layers;
+  for (int32_t priority: {0, 2, 1, 0, 1, 0}) {
+    layers.push_back(CreateLayer(priority));
+    scheduler.Add(layers.back());
+  }
+  layers[3]->layer->SetDrawInFront(true);
+  RequestDraws(layers);
+  scheduler.Update();
+  Expect("added layers sorted", IsOrdered(scheduler) && FullSorts(scheduler) == 1);
+  Expect("front layer last", scheduler.GetFrontIndex() == layers.size() - 1 &&
+                             scheduler.GetLayers().back() == layers[3]);
+
+  RequestDraws(layers);
+  scheduler.Update();
+  Expect("same frame again is not sorted", FullSorts(scheduler) == 1 && Moves(scheduler) == 0);
+
+  // Equal priority layers swap draw order.
+  std::vector<TestLayerPtr> requests = layers;
+  std::swap(requests[0], requests[5]);
+  RequestDraws(requests);
+  scheduler.Update();
+  Expect("draw order change fixed by insertion", IsOrdered(scheduler) && FullSorts(scheduler) == 1 &&
+                                                 Moves(scheduler) > 0);
+
+  layers[2]->layer->SetPriority(1);
+  scheduler.Update();
+  Expect("unchanged priority is not sorted", FullSorts(scheduler) == 1);
+  layers[2]->layer->SetPriority(5);
+  scheduler.Update();
+  Expect("priority change sorted", IsOrdered(scheduler) && FullSorts(scheduler) == 2 &&
+                                   scheduler.GetLayers().front() == layers[2]);
+
+  layers[1]->layer->SetDrawInFront(true);
+  scheduler.Update();
+  Expect("draw in front change sorted", IsOrdered(scheduler) && FullSorts(scheduler) == 3 &&
+                                        scheduler.GetFrontIndex() == layers.size() - 2);
+
+  const TestLayerPtr removed = scheduler.Remove(layers[0]->GetLayer());
+  Expect("removed layer returned", removed == layers[0] && !scheduler.Find(layers[0]->GetLayer()));
+  Expect("removal keeps order", IsOrdered(scheduler) && scheduler.GetLayers().size() == layers.size() - 1 &&
+                                scheduler.GetFrontIndex() == layers.size() - 3);
+  Expect("missing layer not removed", !scheduler.Remove(layers[0]->GetLayer()));
+}
+
+// Random frames with an occasional priority, draw in front or layer set change.
+void
+TestRandomFrames(const int32_t aLayerCount, const int32_t aFrames) {
+  srand(1);
+  Scheduler scheduler;
+  std::vector<TestLayerPtr> layers;
+  for (int32_t i = 0; i < aLayerCount; i++) {
+    layers.push_back(CreateLayer(rand() % 3));
+    scheduler.Add(layers.back());
+  }
+  std::vector<TestLayerPtr> reference = layers;
+  SampleSet fullSort("std::sort");
+  SampleSet update("LayerScheduler::Update");
+  fullSort.Reserve((size_t)aFrames);
+  update.Reserve((size_t)aFrames);
+  int32_t misordered = 0;
+  for (int32_t frame = 0; frame < aFrames; frame++) {
+    const int event = rand() % 100;
+    if (event == 0) {
+      layers[(size_t)rand() % layers.size()]->layer->SetPriority(rand() % 3);
+    } else if (event == 1) {
+      TestLayerPtr& layer = layers[(size_t)rand() % layers.size()];
+      layer->layer->SetDrawInFront(!layer->layer->GetDrawInFront());
+    } else if (event == 2) {
+      const size_t index = (size_t)rand() % layers.size();
+      scheduler.Remove(layers[index]->GetLayer());
+      reference.erase(std::find(reference.begin(), reference.end(), layers[index]));
+      layers[index] = CreateLayer(rand() % 3);
+      scheduler.Add(layers[index]);
+      reference.push_back(layers[index]);
+    } else if (event < 10) {
+      // The world's depth sort swaps two widgets.
+      std::swap(layers[(size_t)rand() % layers.size()], layers[(size_t)rand() % layers.size()]);
+    }
+    RequestDraws(layers);
+    {
+      ScopedPhase scope(fullSort);
+      std::sort(reference.begin(), reference.end(), DrawsBefore);
+    }
+    {
+      ScopedPhase scope(update);
+      scheduler.Update();
+    }
+    misordered += IsOrdered(scheduler) ? 0 : 1;
+  }
+  printf("%d layers, %d frames, %llu full sorts, %llu insertion moves\n", aLayerCount, aFrames,
+         (unsigned long long)FullSorts(scheduler), (unsigned long long)Moves(scheduler));
+  fullSort.Print();
+  update.Print();
+  Expect("random frames ordered", misordered == 0);
+}
+
+} // namespace
+
+int
+main(int argc, char** argv) {
+  int32_t layerCount = 20;
+  int32_t frames = 10000;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (strcmp(argv[i], "--layers") == 0) {
+      layerCount = std::max(atoi(argv[i + 1]), 1);
+    } else if (strcmp(argv[i], "--frames") == 0) {
+      frames = atoi(argv[i + 1]);
+    }
+  }
+  TestOrdering();
+  TestRandomFrames(layerCount, frames);
+  return ExitCode();
+}
@@ -0,0 +1,63 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+// Host implementation of vrb/ModelLoaderAndroid.h, built into the host vrb library
+// in place of vrb's ModelLoaderAndroid.cpp, which reads the Android asset manager.
+// There are no packaged assets on the host, so models and load tasks are dropped and
+// their nodes stay empty, the same as while the loader waits for InitializeGL() on a
+// device.
+
+#include "vrb/ModelLoaderAndroid.h"
+#include "vrb/ConcreteClass.h"
+#include "vrb/Logger.h"
+
+namespace vrb {
+
+struct ModelLoaderAndroid::State {
+  uint32_t dropped;
+  State() : dropped(0) {}
+};
+
+ModelLoaderAndroidPtr
+ModelLoaderAndroid::Create(CreationContextPtr&) {
+  return std::make_shared<ConcreteClass<ModelLoaderAndroid, ModelLoaderAndroid::State> >();
+}
+
+void
+ModelLoaderAndroid::InitializeJava(JNIEnv*, jobject, jobject) {}
+
+void
+ModelLoaderAndroid::ShutdownJava() {}
+
+void
+ModelLoaderAndroid::InitializeGL() {}
+
+void
+ModelLoaderAndroid::ShutdownGL() {
+  if (m.dropped > 0) {
+    VRB_LOG("Dropped %u model loads on host", m.dropped);
+    m.dropped = 0;
+  }
+}
+
+void
+ModelLoaderAndroid::LoadModel(const std::string&, GroupPtr) {
+  m.dropped++;
+}
+
+void
+ModelLoaderAndroid::RunLoadTask(GroupPtr, LoadTask&, LoadFinishedCallback&) {
+  m.dropped++;
+}
+
+bool
+ModelLoaderAndroid::IsOnLoaderThread() const {
+  return false;
+}
+
+ModelLoaderAndroid::ModelLoaderAndroid(State& aState) : m(aState) {}
+ModelLoaderAndroid::~ModelLoaderAndroid() = default;
+
+} // namespace vrb
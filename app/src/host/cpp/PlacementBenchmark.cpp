@@ -0,0 +1,152 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+// Compares decoding N widget placements through per-field JNI reflection
+// (WidgetPlacement::FromJava) with decoding one packed direct ByteBuffer
+// (WidgetPlacement::FromBuffer). Runs on a desktop JVM with PlacementFixture.
+//
+//   placement-benchmark [--iterations N] [--widgets W]
+
+#include "BenchmarkStats.h"
+#include "WidgetPlacement.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace crow;
+
+namespace {
+
+class PackedWriter {
+public:
+  void Int(const int32_t aValue) { Append(&aValue, sizeof(aValue)); }
+  void Float(const float aValue) { Append(&aValue, sizeof(aValue)); }
+  void String(const std::string& aValue) {
+    Int((int32_t)aValue.size());
+    Append(aValue.data(), aValue.size());
+    while (mData.size() & 3) {
+      mData.push_back(0);
+    }
+  }
+  std::vector<uint8_t>& Data() { return mData; }
+private:
+  void Append(const void* aData, const size_t aSize) {
+    const uint8_t* bytes = (const uint8_t*)aData;
+    mData.insert(mData.end(), bytes, bytes + aSize);
+  }
+  std::vector<uint8_t> mData;
+};
+
+// Mirrors WidgetPlacement.packInto() for the PlacementFixture defaults.
+void
+PackFixture(PackedWriter& aWriter, const int32_t aHandle) {
+  aWriter.Int(aHandle);
+  aWriter.Int(800);
+  aWriter.Int(450);
+  aWriter.Float(0.5f);
+  aWriter.Float(0.5f);
+  for (int i = 0; i < 7; i++) {
+    aWriter.Float(0.0f); // translation, rotation axis and rotation
+  }
+  aWriter.Int(-1);
+  aWriter.Float(0.5f);
+  aWriter.Float(0.5f);
+  aWriter.Float(1.0f);
+  aWriter.Float(-1.0f);
+  aWriter.Int(1 | 2 | 8 | 32);
+  aWriter.Int(0);
+  aWriter.Float(0.7f);
+  aWriter.Float(4.0f);
+  aWriter.Int((int32_t)0xFFFFFFFF);
+  aWriter.Int(0);
+  aWriter.Int(0);
+  aWriter.String("Window");
+}
+
+} // namespace
+
+int
+main(int argc, char** argv) {
+  int32_t iterations = 2000;
+  int32_t widgets = 30;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (strcmp(argv[i], "--iterations") == 0) {
+      iterations = atoi(argv[i + 1]);
+    } else if (strcmp(argv[i], "--widgets") == 0) {
+      widgets = atoi(argv[i + 1]);
+    }
+  }
+
+  std::string classPath = std::string("-Djava.class.path=") + PLACEMENT_FIXTURE_JAR;
+  JavaVMOption options[1];
+  options[0].optionString = (char*)classPath.c_str();
+  JavaVMInitArgs args = {};
+  args.version = JNI_VERSION_1_6;
+  args.nOptions = 1;
+  args.options = options;
+  JavaVM* vm = nullptr;
+  JNIEnv* env = nullptr;
+  if (JNI_CreateJavaVM(&vm, (void**)&env, &args) != JNI_OK) {
+    fprintf(stderr, "Unable to create JVM\n");
+    return 1;
+  }
+  jclass clazz = env->FindClass("PlacementFixture");
+  jmethodID constructor = clazz ? env->GetMethodID(clazz, "<init>", "()V") : nullptr;
+  if (!constructor) {
+    fprintf(stderr, "Unable to find PlacementFixture in %s\n", PLACEMENT_FIXTURE_JAR);
+    vm->DestroyJavaVM();
+    return 1;
+  }
+  std::vector<jobject> fixtures;
+  for (int32_t i = 0; i < widgets; i++) {
+    fixtures.push_back(env->NewGlobalRef(env->NewObject(clazz, constructor)));
+  }
+
+  PackedWriter writer;
+  writer.Int(WidgetPlacement::kPackedVersion);
+  writer.Int(widgets);
+  for (int32_t i = 0; i < widgets; i++) {
+    PackFixture(writer, i + 1);
+  }
+  jobject buffer = env->NewDirectByteBuffer(writer.Data().data(), (jlong)writer.Data().size());
+
+  SampleSet reflection("FromJava x" + std::to_string(widgets));
+  SampleSet packed("FromBuffer x" + std::to_string(widgets));
+  reflection.Reserve((size_t)iterations);
+  packed.Reserve((size_t)iterations);
+  size_t decoded = 0;
+  for (int32_t iteration = 0; iteration < iterations; iteration++) {
+    {
+      ScopedPhase scope(reflection);
+      for (jobject& fixture: fixtures) {
+        decoded += WidgetPlacement::FromJava(env, fixture) ? 1 : 0;
+      }
+    }
+    {
+      ScopedPhase scope(packed);
+      const uint8_t* data = (const uint8_t*)env->GetDirectBufferAddress(buffer);
+      const size_t size = (size_t)env->GetDirectBufferCapacity(buffer);
+      size_t offset = 2 * sizeof(int32_t);
+      for (int32_t i = 0; i < widgets; i++) {
+        int32_t handle = 0;
+        decoded += WidgetPlacement::FromBuffer(data, size, offset, handle) ? 1 : 0;
+      }
+    }
+  }
+
+  printf("iterations=%d widgets=%d decoded=%zu (thread CPU time, microseconds per batch)\n",
+         iterations, widgets, decoded);
+  reflection.Print();
+  packed.Print();
+
+  for (jobject& fixture: fixtures) {
+    env->DeleteGlobalRef(fixture);
+  }
+  vm->DestroyJavaVM();
+  return 0;
+}
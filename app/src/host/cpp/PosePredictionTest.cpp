@@ -0,0 +1,186 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+// Offline accuracy test of PosePredictor. Replays a head pose trace, predicts
+// each sample forward by --frames sample intervals and compares against the
+// trace at that time, next to simply holding the last pose. The trace is a
+// CSV file with one "timestamp,px,py,pz,qx,qy,qz,qw" line per sample, in
+// seconds and meters. Without --trace a 72Hz synthetic head motion is used.
+// Exits with 1 if prediction is less accurate than holding the last pose.
+//
+//   pose-prediction-test [--trace FILE] [--frames F] [--seconds S]
+
+#include "BenchmarkStats.h"
+#include "PosePredictor.h"
+
+#include "vrb/Matrix.h"
+#include "vrb/Quaternion.h"
+#include "vrb/Vector.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+using namespace crow;
+
+namespace {
+
+const float kRadiansToDegrees = 180.0f / (float)M_PI;
+
+struct TraceSample {
+  double timestamp;
+  vrb::Vector position;
+  float rotation[4];
+};
+
+vrb::Matrix
+ToTransform(const TraceSample& aSample) {
+  vrb::Matrix result = vrb::Matrix::Rotation(
+      vrb::Quaternion(aSample.rotation[0], aSample.rotation[1], aSample.rotation[2], aSample.rotation[3]));
+  result.TranslateInPlace(aSample.position);
+  return result;
+}
+
+TraceSample
+FromTransform(const double aTimestamp, const vrb::Matrix& aTransform) {
+  const vrb::Quaternion rotation(aTransform);
+  return TraceSample{aTimestamp, aTransform.GetTranslation(), {rotation.x(), rotation.y(), rotation.z(), rotation.w()}};
+}
+
+bool
+LoadTrace(const char* aPath, std::vector<TraceSample>& aTrace) {
+  FILE* file = fopen(aPath, "r");
+  if (!file) {
+    fprintf(stderr, "Unable to open trace %s\n", aPath);
+    return false;
+  }
+  char line[512];
+  while (fgets(line, sizeof(line), file)) {
+    TraceSample sample = {};
+    float x, y, z;
+    if (sscanf(line, "%lf,%f,%f,%f,%f,%f,%f,%f", &sample.timestamp, &x, &y, &z,
+               &sample.rotation[0], &sample.rotation[1], &sample.rotation[2], &sample.rotation[3]) == 8) {
+      sample.position = vrb::Vector(x, y, z);
+      aTrace.push_back(sample);
+    }
+  }
+  fclose(file);
+  return aTrace.size() > 2;
+}
+
+// Head looking around and swaying at 72Hz, with timing jitter and a little sensor noise.
+void
+SynthesizeTrace(const double aSeconds, std::vector<TraceSample>& aTrace) {
+  srand(1);
+  const double interval = 1.0 / 72.0;
+  for (double time = 0.0; time < aSeconds; time += interval) {
+    const double timestamp = time + interval * 0.05 * ((double)rand() / RAND_MAX - 0.5);
+    const float noise = 0.0005f * ((float)rand() / (float)RAND_MAX - 0.5f);
+    const float yaw = 1.0f * sinf((float)(timestamp * 2.0 * M_PI * 0.4)) + noise;
+    const float pitch = 0.3f * sinf((float)(timestamp * 2.0 * M_PI * 0.25)) + noise;
+    vrb::Matrix transform = vrb::Matrix::Rotation(vrb::Vector(0.0f, 1.0f, 0.0f), yaw)
+        .PostMultiply(vrb::Matrix::Rotation(vrb::Vector(1.0f, 0.0f, 0.0f), pitch));
+    transform.TranslateInPlace(vrb::Vector(0.05f * sinf((float)(timestamp * 2.0 * M_PI * 0.3)), 1.6f,
+                                           0.03f * sinf((float)(timestamp * 2.0 * M_PI * 0.5))));
+    aTrace.push_back(FromTransform(timestamp, transform));
+  }
+}
+
+// Trace pose at aTimestamp, interpolated between the samples around it.
+bool
+SampleTrace(const std::vector<TraceSample>& aTrace, const double aTimestamp, TraceSample& aResult) {
+  auto next = std::lower_bound(aTrace.begin(), aTrace.end(), aTimestamp,
+                               [](const TraceSample& aSample, const double aTime) { return aSample.timestamp < aTime; });
+  if (next == aTrace.begin() || next == aTrace.end()) {
+    return false;
+  }
+  const TraceSample& before = *(next - 1);
+  const TraceSample& after = *next;
+  const float t = (float)((aTimestamp - before.timestamp) / (after.timestamp - before.timestamp));
+  aResult.timestamp = aTimestamp;
+  aResult.position = before.position + (after.position - before.position) * t;
+  float dot = 0.0f;
+  for (int i = 0; i < 4; i++) {
+    dot += before.rotation[i] * after.rotation[i];
+  }
+  const float sign = dot < 0.0f ? -1.0f : 1.0f;
+  float length = 0.0f;
+  for (int i = 0; i < 4; i++) {
+    aResult.rotation[i] = before.rotation[i] + (after.rotation[i] * sign - before.rotation[i]) * t;
+    length += aResult.rotation[i] * aResult.rotation[i];
+  }
+  for (float& value: aResult.rotation) {
+    value /= sqrtf(length);
+  }
+  return true;
+}
+
+void
+AddError(const vrb::Matrix& aPredicted, const TraceSample& aActual, SampleSet& aDegrees, SampleSet& aMillimeters) {
+  const TraceSample predicted = FromTransform(aActual.timestamp, aPredicted);
+  float dot = 0.0f;
+  for (int i = 0; i < 4; i++) {
+    dot += predicted.rotation[i] * aActual.rotation[i];
+  }
+  aDegrees.Add(2.0f * acosf(std::min(fabsf(dot), 1.0f)) * kRadiansToDegrees);
+  aMillimeters.Add((predicted.position - aActual.position).Magnitude() * 1000.0f);
+}
+
+} // namespace
+
+int
+main(int argc, char** argv) {
+  const char* tracePath = nullptr;
+  float frames = 1.0f;
+  double seconds = 60.0;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (strcmp(argv[i], "--trace") == 0) {
+      tracePath = argv[i + 1];
+    } else if (strcmp(argv[i], "--frames") == 0) {
+      frames = (float)atof(argv[i + 1]);
+    } else if (strcmp(argv[i], "--seconds") == 0) {
+      seconds = atof(argv[i + 1]);
+    }
+  }
+
+  std::vector<TraceSample> trace;
+  if (tracePath) {
+    if (!LoadTrace(tracePath, trace)) {
+      return 1;
+    }
+  } else {
+    SynthesizeTrace(seconds, trace);
+  }
+
+  PosePredictorPtr predictor = PosePredictor::Create();
+  SampleSet predictedDegrees("predicted (degrees)");
+  SampleSet heldDegrees("held (degrees)");
+  SampleSet predictedMillimeters("predicted (mm)");
+  SampleSet heldMillimeters("held (mm)");
+  for (const TraceSample& sample: trace) {
+    const vrb::Matrix transform = ToTransform(sample);
+    predictor->AddSample(0, sample.timestamp, transform);
+    const double interval = predictor->GetSampleInterval(0);
+    TraceSample actual;
+    if (interval <= 0.0 || !SampleTrace(trace, sample.timestamp + frames * interval, actual)) {
+      continue;
+    }
+    vrb::Matrix predicted;
+    PosePredictor::Motion motion;
+    predictor->Predict(0, actual.timestamp, predicted, motion);
+    AddError(predicted, actual, predictedDegrees, predictedMillimeters);
+    AddError(transform, actual, heldDegrees, heldMillimeters);
+  }
+
+  printf("%s samples=%zu frames=%.2f\n", tracePath ? tracePath : "synthetic", trace.size(), frames);
+  predictedDegrees.Print();
+  heldDegrees.Print();
+  predictedMillimeters.Print();
+  heldMillimeters.Print();
+  return predictedDegrees.Mean() < heldDegrees.Mean() ? 0 : 1;
+}
@@ -0,0 +1,77 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+// CPU check of ExternalBlitter::GetReprojectionMatrix, the clip space mapping used
+// to rotate a late WebXR frame to the current head pose. Exits with 1 on failure.
+//
+//   reprojection-test
+
+#include "Expect.h"
+#include "ExternalBlitter.h"
+
+#include "vrb/Matrix.h"
+#include "vrb/Vector.h"
+
+#include <cmath>
+#include <cstdio>
+
+using namespace crow;
+
+namespace {
+
+const float kEpsilon = 1e-4f;
+const float kHalfFov = 45.0f * (float)M_PI / 180.0f;
+
+// Where the center of the current view lands in the kept frame, in normalized device coordinates.
+vrb::Vector
+Reproject(const vrb::Matrix& aReprojection, const float aX, const float aY) {
+  return aReprojection.MultiplyPosition(vrb::Vector(aX, aY, 0.0f));
+}
+
+void
+Expect(const char* aName, const vrb::Vector& aActual, const float aX, const float aY) {
+  if (fabsf(aActual.x() - aX) > kEpsilon || fabsf(aActual.y() - aY) > kEpsilon) {
+    Fail("%s: got (%f, %f) expected (%f, %f)", aName, aActual.x(), aActual.y(), aX, aY);
+  } else {
+    Pass(aName);
+  }
+}
+
+} // namespace
+
+int
+main(int argc, char** argv) {
+  const vrb::Matrix projection = vrb::Matrix::PerspectiveMatrix(kHalfFov, kHalfFov, kHalfFov, kHalfFov, 0.1f, 100.0f);
+  const vrb::Matrix head = vrb::Matrix::Position(vrb::Vector(0.0f, 1.6f, 0.0f));
+  const float angle = 10.0f * (float)M_PI / 180.0f;
+  const vrb::Vector up(0.0f, 1.0f, 0.0f);
+  const vrb::Vector right(1.0f, 0.0f, 0.0f);
+
+  const vrb::Matrix same = ExternalBlitter::GetReprojectionMatrix(projection, head, head);
+  Expect("same pose, center", Reproject(same, 0.0f, 0.0f), 0.0f, 0.0f);
+  Expect("same pose, corner", Reproject(same, 0.8f, -0.6f), 0.8f, -0.6f);
+
+  // Moving the head without turning it leaves the image alone.
+  const vrb::Matrix moved = vrb::Matrix::Position(vrb::Vector(0.1f, 1.5f, -0.2f));
+  Expect("translation only", Reproject(ExternalBlitter::GetReprojectionMatrix(projection, head, moved), 0.3f, 0.2f),
+         0.3f, 0.2f);
+
+  // Turning left, the new view center was left of the old one by tan(angle) in a 90 degree view.
+  const vrb::Matrix left = head.PostMultiply(vrb::Matrix::Rotation(up, angle));
+  Expect("yaw left", Reproject(ExternalBlitter::GetReprojectionMatrix(projection, head, left), 0.0f, 0.0f),
+         -tanf(angle), 0.0f);
+
+  const vrb::Matrix lookUp = head.PostMultiply(vrb::Matrix::Rotation(right, angle));
+  Expect("pitch up", Reproject(ExternalBlitter::GetReprojectionMatrix(projection, head, lookUp), 0.0f, 0.0f),
+         0.0f, tanf(angle));
+
+  // Turning and moving back undoes the mapping.
+  const vrb::Matrix forward = ExternalBlitter::GetReprojectionMatrix(projection, head, left);
+  const vrb::Matrix back = ExternalBlitter::GetReprojectionMatrix(projection, left, head);
+  const vrb::Vector point = Reproject(forward, -0.4f, 0.5f);
+  Expect("round trip", Reproject(back, point.x(), point.y()), -0.4f, 0.5f);
+
+  return ExitCode();
+}
@@ -0,0 +1,177 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+// Two thread contention benchmark for ExternalVR::PushSystemState. The render
+// thread pushes frame poses, alone and while a reader thread plays Gecko, copying
+// the shared memory under systemMutex. Gecko reads the system state with a plain
+// copy under that mutex, so the push has to take it too. Reports how long the
+// render thread stalls on it per push, measured as wall time minus thread CPU
+// time. Also reports the controller bytes written and published per frame,
+// compared to rebuilding every controller entry on every push.
+//
+//   system-state-benchmark [--frames N] [--hold MICROSECONDS] [--controllers C]
+
+#include "BenchmarkStats.h"
+#include "ExternalVR.h"
+#include "moz_external_vr.h"
+
+#include "vrb/Matrix.h"
+#include "vrb/Vector.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <pthread.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace crow;
+
+namespace {
+
+struct Scenario {
+  const char* name;
+  bool reader;
+};
+
+struct ReaderResult {
+  uint64_t reads = 0;
+  uint64_t failedReads = 0;
+};
+
+// Pushes that stall longer than this are counted separately.
+const double kStallThreshold = 5.0;
+
+void
+Spin(const double aMicroseconds) {
+  const double end = WallTimeMicroseconds() + aMicroseconds;
+  while (WallTimeMicroseconds() < end) {}
+}
+
+// The first controller moves every frame and presses a button every 30 frames, the others idle.
+void
+UpdateControllers(std::vector<Controller>& aControllers, const int32_t aFrame) {
+  for (size_t i = 0; i < aControllers.size(); i++) {
+    Controller& controller = aControllers[i];
+    if (aFrame == 0) {
+      controller.enabled = true;
+      controller.immersiveName = "Host Controller";
+      controller.numButtons = 4;
+      controller.numAxes = 2;
+      controller.deviceCapabilities = device::Orientation | device::Position;
+      controller.leftHanded = (i % 2) == 1;
+    }
+    if (i == 0) {
+      controller.transformMatrix = vrb::Matrix::Position(vrb::Vector(0.2f, 1.2f + 0.001f * (float)(aFrame % 100), -0.3f));
+      const bool pressed = ((aFrame / 30) % 2) == 1;
+      controller.immersivePressedState = pressed ? 1 : 0;
+      controller.immersiveTriggerValues[0] = pressed ? 1.0f : 0.0f;
+    }
+  }
+}
+
+void
+RunReader(const ExternalVRPtr& aExternalVR, const double aHold, const std::atomic<bool>& aDone,
+          ReaderResult& aResult) {
+  mozilla::gfx::VRExternalShmem* shmem = aExternalVR->GetSharedData();
+  pthread_mutex_t* mutex = aExternalVR->GetSystemMutex();
+  mozilla::gfx::VRSystemState* state = new mozilla::gfx::VRSystemState();
+  while (!aDone.load(std::memory_order_relaxed)) {
+    if (pthread_mutex_lock(mutex) != 0) {
+      aResult.failedReads++;
+      continue;
+    }
+    memcpy(state, &(shmem->state), sizeof(mozilla::gfx::VRSystemState));
+    // Gecko holds the mutex while it processes the copy.
+    Spin(aHold);
+    pthread_mutex_unlock(mutex);
+    aResult.reads++;
+  }
+  delete state;
+}
+
+} // namespace
+
+int
+main(int argc, char** argv) {
+  int32_t frames = 20000;
+  double hold = 20.0;
+  int32_t controllerCount = 2;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (strcmp(argv[i], "--frames") == 0) {
+      frames = atoi(argv[i + 1]);
+    } else if (strcmp(argv[i], "--hold") == 0) {
+      hold = atof(argv[i + 1]);
+    } else if (strcmp(argv[i], "--controllers") == 0) {
+      controllerCount = std::min(atoi(argv[i + 1]), mozilla::gfx::kVRControllerMaxCount);
+    }
+  }
+
+  const Scenario scenarios[] = {
+    {"no reader", false},
+    {"reader", true},
+  };
+
+  printf("frames=%d hold=%.1fus controllers=%d (microseconds per PushFramePoses)\n",
+         frames, hold, controllerCount);
+  for (const Scenario& scenario: scenarios) {
+    // ExternalVR resets the shared state, so create it before the reader starts.
+    ExternalVRPtr externalVR = ExternalVR::Create();
+    std::atomic<bool> done(false);
+    ReaderResult result;
+    std::thread reader;
+    if (scenario.reader) {
+      reader = std::thread(RunReader, externalVR, hold, std::cref(done), std::ref(result));
+    }
+
+    std::vector<Controller> controllers((size_t)controllerCount);
+    SampleSet push(std::string(scenario.name) + " push");
+    SampleSet stall(std::string(scenario.name) + " stall");
+    push.Reserve((size_t)frames);
+    stall.Reserve((size_t)frames);
+    double worst = 0.0;
+    double totalStall = 0.0;
+    int32_t stalled = 0;
+    const vrb::Matrix head = vrb::Matrix::Position(vrb::Vector(0.0f, 1.6f, 0.0f));
+    for (int32_t frame = 0; frame < frames; frame++) {
+      UpdateControllers(controllers, frame);
+      const double start = WallTimeMicroseconds();
+      const double startCPU = CPUTimeMicroseconds();
+      externalVR->PushFramePoses(head, controllers, (double)(frame + 1));
+      const double elapsed = WallTimeMicroseconds() - start;
+      // Time the render thread was not running, mostly blocked on systemMutex.
+      const double blocked = std::max(elapsed - (CPUTimeMicroseconds() - startCPU), 0.0);
+      push.Add(elapsed);
+      stall.Add(blocked);
+      worst = std::max(worst, elapsed);
+      totalStall += blocked;
+      stalled += blocked > kStallThreshold ? 1 : 0;
+    }
+    done = true;
+    if (reader.joinable()) {
+      reader.join();
+    }
+
+    push.Print();
+    stall.Print();
+    printf("  max push=%.2f stall total=%.0f, pushes stalled over %.0fus=%d reads=%llu failed=%llu\n",
+           worst, totalStall, kStallThreshold, stalled, (unsigned long long)result.reads,
+           (unsigned long long)result.failedReads);
+
+    // Before delta tracking every push cleared all entries, rebuilt each enabled one
+    // and copied the whole system state into the shared memory.
+    uint64_t written = 0, published = 0;
+    externalVR->GetControllerStateStats(written, published);
+    const double rebuilt = (double)(sizeof(mozilla::gfx::VRSystemState::controllerState) +
+                                    controllerCount * sizeof(mozilla::gfx::VRControllerState));
+    const double copied = (double)sizeof(mozilla::gfx::VRSystemState);
+    printf("  controller bytes/frame written=%.1f (was %.1f) published=%.1f (was %.1f)\n",
+           (double)written / frames, rebuilt, (double)published / frames, copied);
+  }
+  return 0;
+}
@@ -0,0 +1,121 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+// Host replacement for VRBrowser.cpp. There is no Java VM on the host so every
+// call into the activity is a noop. Getters return the values the browser uses
+// on a fresh install, except for the environment which is kept empty so that no
+// skybox textures need to be loaded.
+
+#include "VRBrowser.h"
+
+namespace crow {
+
+void
+VRBrowser::InitializeJava(JNIEnv*, jobject) {}
+
+void
+VRBrowser::ShutdownJava() {}
+
+void
+VRBrowser::DispatchCreateWidget(jint, jobject, jint, jint) {}
+
+void
+VRBrowser::DispatchCreateWidgetLayer(jint, jobject, jint, jint, const std::function<void()>& aFirstCompositeCallback) {
+  if (aFirstCompositeCallback) {
+    aFirstCompositeCallback();
+  }
+}
+
+void
+VRBrowser::HandleMotionEvent(jint, jint, jboolean, jboolean, jfloat, jfloat) {}
+
+void
+VRBrowser::HandleScrollEvent(jint, jint, jfloat, jfloat) {}
+
+void
+VRBrowser::HandleAudioPose(jfloat, jfloat, jfloat, jfloat, jfloat, jfloat, jfloat) {}
+
+void
+VRBrowser::HandleGesture(jint) {}
+
+void
+VRBrowser::HandleResize(jint, jfloat, jfloat) {}
+
+void
+VRBrowser::HandleMoveEnd(jint, jfloat, jfloat, jfloat, jfloat) {}
+
+void
+VRBrowser::HandleBack() {}
+
+void
+VRBrowser::RegisterExternalContext(jlong) {}
+
+void
+VRBrowser::OnEnterWebXR() {}
+
+void
+VRBrowser::OnExitWebXR(const std::function<void()>& aCallback) {
+  if (aCallback) {
+    aCallback();
+  }
+}
+
+void
+VRBrowser::OnDismissWebXRInterstitial() {}
+
+void
+VRBrowser::OnWebXRRenderStateChange(const bool) {}
+
+void
+VRBrowser::RenderPointerLayer(jobject, const std::function<void()>& aFirstCompositeCallback) {
+  if (aFirstCompositeCallback) {
+    aFirstCompositeCallback();
+  }
+}
+
+std::string
+VRBrowser::GetStorageAbsolutePath(const std::string& aRelativePath) {
+  return aRelativePath;
+}
+
+bool
+VRBrowser::isOverrideEnvPathEnabled() {
+  return false;
+}
+
+std::string
+VRBrowser::GetActiveEnvironment() {
+  return "cubemap/void";
+}
+
+int32_t
+VRBrowser::GetPointerColor() {
+  return (int32_t)0xFFFFFFFF;
+}
+
+bool
+VRBrowser::AreLayersEnabled() {
+  return false;
+}
+
+void
+VRBrowser::SetDeviceType(const jint) {}
+
+void
+VRBrowser::HaltActivity(const jint) {}
+
+void
+VRBrowser::HandlePoorPerformance() {}
+
+void
+VRBrowser::OnAppLink(const std::string&) {}
+
+void
+VRBrowser::DisableLayers() {}
+
+void
+VRBrowser::AppendAppNotesToCrashLog(const std::string&) {}
+
+} // namespace crow
@@ -0,0 +1,38 @@
+/* -*- Mode: Java; c-basic-offset: 4; tab-width: 4; indent-tabs-mode: nil; -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+// Same fields as org.mozilla.vrbrowser.ui.widgets.WidgetPlacement, without the
+// Android dependencies, so that WidgetPlacement::FromJava can run on a desktop JVM.
+public class PlacementFixture {
+    public float density = 1.0f;
+    public int width = 800;
+    public int height = 450;
+    public float worldWidth = -1.0f;
+    public float anchorX = 0.5f;
+    public float anchorY = 0.5f;
+    public float translationX;
+    public float translationY;
+    public float translationZ;
+    public float rotationAxisX;
+    public float rotationAxisY;
+    public float rotationAxisZ;
+    public float rotation;
+    public int parentHandle = -1;
+    public float parentAnchorX = 0.5f;
+    public float parentAnchorY = 0.5f;
+    public boolean visible = true;
+    public int scene = 0;
+    public boolean showPointer = true;
+    public boolean composited = false;
+    public boolean layer = true;
+    public boolean proxifyLayer = false;
+    public float textureScale = 0.7f;
+    public boolean cylinder = true;
+    public int tintColor = 0xFFFFFFFF;
+    public int borderColor = 0;
+    public String name = "Window";
+    public int clearColor = 0;
+    public float cylinderMapRadius = 4.0f;
+}
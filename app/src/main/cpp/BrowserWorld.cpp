@@ -11,6 +11,7 @@
 #include "DeviceDelegate.h"
 #include "ExternalBlitter.h"
 #include "ExternalVR.h"
+#include "FramePacer.h"
 #include "GeckoSurfaceTexture.h"
 #include "Skybox.h"
 #include "SplashAnimation.h"
@@ -18,9 +19,11 @@
 #include "Widget.h"
 #include "WidgetMover.h"
 #include "WidgetResizer.h"
+#include "WidgetHierarchy.h"
 #include "WidgetPlacement.h"
 #include "Cylinder.h"
 #include "Quad.h"
+#include "QuadHitBatch.h"
 #include "VRBrowser.h"
 #include "VRVideo.h"
 #include "VRLayer.h"
@@ -57,6 +60,7 @@
 #include <array>
 #include <functional>
 #include <fstream>
+#include <cstring>
 #include <unordered_map>
 
 #define ASSERT_ON_RENDER_THREAD(X)                                          \
@@ -77,6 +81,44 @@ const int GestureSwipeRight = 1;
 
 const float kScrollFactor = 20.0f; // Just picked what fell right.
 const double kHoverRate = 1.0 / 10.0;
+// Head or widget movement below these is ignored when reusing depth sort keys.
+const float kDepthSortPositionThreshold = 0.001f;
+const float kDepthSortDirectionThreshold = 0.99999f; // About 0.25 degrees.
+// Widget layout dirty flags. Placement and size changes need a full UpdateWidget,
+// transform changes only need LayoutWidget. Descendants inherit kDirtyTransform.
+const uint8_t kDirtyPlacement = 1 << 0;
+const uint8_t kDirtyTransform = 1 << 1;
+const uint8_t kDirtySize = 1 << 2;
+// Seconds to wait for a WebXR frame while frames are not paced, e.g. behind the spinner.
+const float kUnpacedFrameWaitTimeout = 0.1f;
+
+bool
+SameTransform(const vrb::Matrix& aA, const vrb::Matrix& aB) {
+  return aA.GetTranslation() == aB.GetTranslation() &&
+         aA.MultiplyDirection(vrb::Vector(1.0f, 0.0f, 0.0f)) == aB.MultiplyDirection(vrb::Vector(1.0f, 0.0f, 0.0f)) &&
+         aA.MultiplyDirection(vrb::Vector(0.0f, 1.0f, 0.0f)) == aB.MultiplyDirection(vrb::Vector(0.0f, 1.0f, 0.0f)) &&
+         aA.MultiplyDirection(vrb::Vector(0.0f, 0.0f, 1.0f)) == aB.MultiplyDirection(vrb::Vector(0.0f, 0.0f, 1.0f));
+}
+
+// True when the controller ray can not produce an inside hit on a widget with the
+// given bounding sphere that is closer than aMaxDistance. The ray is tested as a
+// line because Quad::TestIntersection also reports hits behind the start point.
+bool
+CanSkipHitTest(const vrb::Vector& aStart, const vrb::Vector& aDirection, const vrb::Vector& aCenter,
+               const float aRadius, const float aMaxDistance) {
+  const vrb::Vector toCenter = aCenter - aStart;
+  const float centerDistance2 = toCenter.Dot(toCenter);
+  const float reach = aMaxDistance + aRadius;
+  if (centerDistance2 >= reach * reach) {
+    return true;
+  }
+  const float length2 = aDirection.Dot(aDirection);
+  if (length2 <= 0.0f) {
+    return false;
+  }
+  const float along = toCenter.Dot(aDirection);
+  return centerDistance2 - (along * along / length2) > aRadius * aRadius;
+}
 
 class SurfaceObserver;
 typedef std::shared_ptr<SurfaceObserver> SurfaceObserverPtr;
@@ -146,6 +188,9 @@ namespace crow {
 struct BrowserWorld::State {
   BrowserWorldWeakPtr self;
   std::vector<WidgetPtr> widgets;
+  // Handle lookup for widgets. The vector above keeps insertion order for iteration.
+  std::unordered_map<int32_t, WidgetPtr> widgetsByHandle;
+  WidgetHierarchyPtr hierarchy;
   SurfaceObserverPtr surfaceObserver;
   DeviceDelegatePtr device;
   bool paused;
@@ -173,6 +218,11 @@ struct BrowserWorld::State {
   GestureDelegateConstPtr gestures;
   ExternalVRPtr externalVR;
   ExternalBlitterPtr blitter;
+  FramePacerPtr framePacer;
+  std::vector<ExternalVR::FrameLayer> overlayLayers;
+  // Stereo compositor layer WebXR frames are drawn into, when the device has one.
+  // Otherwise they are drawn into the eye buffers.
+  VRLayerProjectionPtr immersiveLayer;
   bool windowsInitialized;
   SkyboxPtr skybox;
   FadeAnimationPtr fadeAnimation;
@@ -184,7 +234,71 @@ struct BrowserWorld::State {
   PerformanceMonitorPtr monitor;
   WidgetMoverPtr movingWidget;
   WidgetResizerPtr widgetResizer;
-  std::unordered_map<vrb::Node*, std::pair<Widget*, float>> depthSorting;
+  struct DepthSortEntry {
+    Widget* widget;
+    PointerPtr pointer;
+    bool resizer;
+    Widget* target;
+    float z;
+    size_t rank;
+    DepthSortEntry() : widget(nullptr), resizer(false), target(nullptr), z(1.0f), rank(0) {}
+  };
+  struct WidgetDepth {
+    vrb::Vector position;
+    vrb::Vector right;
+    vrb::Vector forward;
+    float worldWidth;
+    float worldHeight;
+    bool cylinder;
+    float z;
+  };
+  // Transparent nodes in draw order, bound to the widget or pointer they belong to.
+  std::vector<vrb::NodePtr> depthOrder;
+  std::unordered_map<vrb::Node*, DepthSortEntry> depthSorting;
+  std::unordered_map<const Widget*, WidgetDepth> widgetDepths;
+  vrb::Vector depthSortHeadPosition;
+  vrb::Vector depthSortHeadDirection;
+  vrb::Vector depthSortReorientPosition;
+  vrb::Vector depthSortReorientDirection;
+  bool depthSortDirty = true;
+  uint64_t depthSortFrames = 0;
+  uint64_t depthSortSkippedFrames = 0;
+  // Layout dirty flags by widget handle, consumed by UpdateDirtyWidgets().
+  std::unordered_map<int32_t, uint8_t> dirtyWidgets;
+  uint64_t layoutPasses = 0;
+  uint64_t layoutWidgetsTouched = 0;
+  // Widget changes queued by Begin/CommitWidgetTransaction, applied by StartFrame.
+  // Call replays a resize, move or visibility update made while changes were queued.
+  enum class WidgetChange { Add, Update, Remove, Call };
+  struct PendingWidgetChange {
+    WidgetChange change;
+    int32_t handle;
+    WidgetPlacementPtr placement;
+    bool dropped;
+    std::function<void()> call;
+  };
+  std::vector<PendingWidgetChange> pendingChanges;
+  std::unordered_map<int32_t, size_t> pendingChangesByHandle;
+  int32_t transactionDepth = 0;
+  bool transactionReady = false;
+  bool applyingTransaction = false;
+  uint64_t transactionCommits = 0;
+  uint64_t transactionQueued = 0;
+  uint64_t transactionApplied = 0;
+  // Widget bounding spheres for the controller hit test broadphase, parallel to widgets.
+  // Plain quads are tested together in quadHits instead, at batchIndex.
+  struct HitBounds {
+    vrb::Vector center;
+    float radius;
+    bool valid;
+    int32_t batchIndex;
+  };
+  std::vector<HitBounds> hitBounds;
+  QuadHitBatchPtr quadHits;
+  std::vector<float> quadHitDistances;
+  uint64_t hitTestsExact = 0;
+  uint64_t hitTestsSkipped = 0;
+  uint64_t hitTestsBatched = 0;
   std::function<void(device::Eye)> drawHandler;
   std::function<void()> frameEndHandler;
   bool wasInGazeMode = false;
@@ -197,6 +311,8 @@ struct BrowserWorld::State {
     create = context->GetRenderThreadCreationContext();
     loader = ModelLoaderAndroid::Create(context);
     context->GetProgramFactory()->SetLoaderThread(loader);
+    hierarchy = WidgetHierarchy::Create();
+    quadHits = QuadHitBatch::Create();
     rootOpaque = Transform::Create(create);
     rootTransparent = Transform::Create(create);
     rootController = Group::Create(create);
@@ -211,6 +327,7 @@ struct BrowserWorld::State {
     controllers = ControllerContainer::Create(create, rootTransparent);
     externalVR = ExternalVR::Create();
     blitter = ExternalBlitter::Create(create);
+    framePacer = FramePacer::Create();
     fadeAnimation = FadeAnimation::Create(create);
     splashAnimation = SplashAnimation::Create(create);
     monitor = PerformanceMonitor::Create(create);
@@ -228,14 +345,21 @@ struct BrowserWorld::State {
   void ChangeControllerFocus(const Controller& aController);
   void UpdateGazeModeState();
   void UpdateControllers(bool& aRelayoutWidgets);
+  void UpdateHitBounds();
+  void SetRootTransform(const vrb::TransformPtr& aRoot, const vrb::Matrix& aTransform);
   void ClearWebXRControllerData();
   WidgetPtr GetWidget(int32_t aHandle) const;
   WidgetPtr FindWidget(const std::function<bool(const WidgetPtr&)>& aCondition) const;
   bool IsParent(const Widget& aChild, const Widget& aParent) const;
   int ParentCount(const WidgetPtr& aWidget) const;
   float ComputeNormalizedZ(const Widget& aWidget) const;
+  float GetDepthKey(const Widget& aWidget);
+  void BindTransparentNodes();
+  bool DrawsBefore(const DepthSortEntry& aFirst, const DepthSortEntry& aSecond) const;
   void SortWidgets();
   void UpdateWidgetCylinder(const WidgetPtr& aWidget, const float aDensity);
+  bool QueueWidgetChange(const WidgetChange aChange, const int32_t aHandle, const WidgetPlacementPtr& aPlacement);
+  bool QueueWidgetCall(const std::function<void()>& aCall);
 };
 
 void
@@ -369,9 +493,46 @@ BrowserWorld::State::UpdateGazeModeState() {
   }
 }
 
+void
+BrowserWorld::State::UpdateHitBounds() {
+  hitBounds.resize(widgets.size());
+  quadHits->Clear();
+  for (size_t i = 0; i < widgets.size(); i++) {
+    const WidgetPtr& widget = widgets[i];
+    HitBounds& bounds = hitBounds[i];
+    bounds.valid = widget->GetBoundingSphere(bounds.center, bounds.radius);
+    bounds.batchIndex = -1;
+    // Resize handles extend past the quad and the moved widget may change while
+    // iterating the controllers, so those always get the exact test.
+    QuadPtr quad = widget->GetQuad();
+    if (!bounds.valid || !quad || widget->IsResizing() || (movingWidget && movingWidget->GetWidget() == widget)) {
+      continue;
+    }
+    vrb::Matrix inverse;
+    vrb::Vector point, normal, min, max;
+    if (quad->GetHitPlane(inverse, point, normal)) {
+      quad->GetHitBounds(min, max);
+      bounds.batchIndex = (int32_t)quadHits->Add(inverse, point, normal, min, max);
+    }
+  }
+}
+
+// Widgets cache their world transforms, so they must be told when a scene root moves.
+void
+BrowserWorld::State::SetRootTransform(const vrb::TransformPtr& aRoot, const vrb::Matrix& aTransform) {
+  if (SameTransform(aRoot->GetTransform(), aTransform)) {
+    return;
+  }
+  aRoot->SetTransform(aTransform);
+  for (const WidgetPtr& widget: widgets) {
+    widget->InvalidateTransformCache();
+  }
+}
+
 void
 BrowserWorld::State::UpdateControllers(bool& aRelayoutWidgets) {
   EnsureControllerFocused();
+  bool hitBoundsReady = false;
   for (Controller& controller: controllers->GetControllers()) {
     if (!controller.enabled || (controller.index < 0)) {
       continue;
@@ -425,7 +586,19 @@ BrowserWorld::State::UpdateControllers(bool& aRelayoutWidgets) {
         hitNormal = normal;
       }
     } else {
-      for (const WidgetPtr& widget: widgets) {
+      if (!hitBoundsReady) {
+        UpdateHitBounds();
+        hitBoundsReady = true;
+      }
+      if (quadHits->GetCount() > 0) {
+        quadHits->Intersect(start, direction, quadHitDistances);
+      }
+      // Batched hits are kept apart from exact ones, so the closest exact hit still
+      // stands if the batched winner misses its exact test.
+      WidgetPtr batchedWidget;
+      float batchedDistance = farClip;
+      for (size_t i = 0; i < widgets.size(); i++) {
+        const WidgetPtr& widget = widgets[i];
         if (controller.focused) {
           if (isResizing && resizingWidget != widget) {
             // Don't interact with other widgets when resizing gesture is active.
@@ -436,10 +609,26 @@ BrowserWorld::State::UpdateControllers(bool& aRelayoutWidgets) {
             continue;
           }
         }
+        const HitBounds& bounds = hitBounds[i];
+        if (bounds.batchIndex >= 0) {
+          hitTestsBatched++;
+          const float distance = quadHitDistances[bounds.batchIndex];
+          if ((distance >= 0.0f) && (distance < batchedDistance)) {
+            batchedWidget = widget;
+            batchedDistance = distance;
+          }
+          continue;
+        }
         vrb::Vector result;
         vrb::Vector normal;
         float distance = 0.0f;
         bool isInWidget = false;
+        if (bounds.valid && !widget->IsResizing() && (!movingWidget || movingWidget->GetWidget() != widget) &&
+            CanSkipHitTest(start, direction, bounds.center, bounds.radius, hitDistance)) {
+          hitTestsSkipped++;
+          continue;
+        }
+        hitTestsExact++;
         const bool clamp = !widget->IsResizing() && !movingWidget;
         if (widget->TestControllerIntersection(start, direction, result, normal, clamp, isInWidget, distance)) {
           if (isInWidget && (distance < hitDistance)) {
@@ -450,6 +639,20 @@ BrowserWorld::State::UpdateControllers(bool& aRelayoutWidgets) {
           }
         }
       }
+      if (batchedWidget && (batchedDistance < hitDistance)) {
+        // The batch only reports distances, run the exact test once for the pointer.
+        vrb::Vector result;
+        vrb::Vector normal;
+        float distance = 0.0f;
+        bool isInWidget = false;
+        if (batchedWidget->TestControllerIntersection(start, direction, result, normal, !movingWidget,
+                                                      isInWidget, distance) && isInWidget) {
+          hitWidget = batchedWidget;
+          hitDistance = distance;
+          hitPoint = result;
+          hitNormal = normal;
+        }
+      }
     }
 
     if (controller.focused && (!hitWidget || !hitWidget->IsResizing()) && resizingWidget) {
@@ -476,6 +679,8 @@ BrowserWorld::State::UpdateControllers(bool& aRelayoutWidgets) {
         WidgetPlacementPtr updatedPlacement = movingWidget->HandleMove(start, direction);
         if (updatedPlacement) {
           movingWidget->GetWidget()->SetPlacement(updatedPlacement);
+          hierarchy->SetParent(movingWidget->GetWidget()->GetHandle(), updatedPlacement->parentHandle);
+          dirtyWidgets[movingWidget->GetWidget()->GetHandle()] |= kDirtyTransform;
           aRelayoutWidgets = true;
         }
       }
@@ -485,6 +690,7 @@ BrowserWorld::State::UpdateControllers(bool& aRelayoutWidgets) {
 
       resizingWidget = hitWidget;
       if (aResized) {
+        dirtyWidgets[hitWidget->GetHandle()] |= kDirtySize;
         aRelayoutWidgets = true;
 
         std::shared_ptr<BrowserWorld> world = self.lock();
@@ -600,9 +806,11 @@ BrowserWorld::State::ClearWebXRControllerData() {
 
 WidgetPtr
 BrowserWorld::State::GetWidget(int32_t aHandle) const {
-  return FindWidget([=](const WidgetPtr& aWidget){
-    return aWidget->GetHandle() == aHandle;
-  });
+  auto it = widgetsByHandle.find(aHandle);
+  if (it != widgetsByHandle.end()) {
+    return it->second;
+  }
+  return {};
 }
 
 WidgetPtr
@@ -617,31 +825,12 @@ BrowserWorld::State::FindWidget(const std::function<bool(const WidgetPtr&)>& aCo
 
 bool
 BrowserWorld::State::IsParent(const Widget& aChild, const Widget& aParent) const {
-  if (aChild.GetPlacement()->parentHandle == aParent.GetHandle()) {
-    return true;
-  }
-
-  if (aChild.GetPlacement()->parentHandle > 0) {
-    WidgetPtr next = GetWidget(aChild.GetPlacement()->parentHandle);
-    if (next) {
-      return IsParent(*next, aParent);
-    }
-  }
-
-  return false;
+  return hierarchy->IsAncestor(aParent.GetHandle(), aChild.GetHandle());
 }
 
 int
 BrowserWorld::State::ParentCount(const WidgetPtr& aWidget) const {
-  int result = 0;
-  WidgetPtr current = aWidget;
-  while (current && current->GetPlacement()->parentHandle > 0) {
-    current = GetWidget(current->GetPlacement()->parentHandle);
-    if (current) {
-      result++;
-    }
-  }
-  return result;
+  return hierarchy->GetDepth(aWidget->GetHandle());
 }
 
 float
@@ -668,64 +857,161 @@ BrowserWorld::State::ComputeNormalizedZ(const Widget& aWidget) const {
   return ndc.z();
 }
 
+float
+BrowserWorld::State::GetDepthKey(const Widget& aWidget) {
+  const vrb::Matrix transform = aWidget.GetTransform();
+  WidgetDepth current;
+  current.position = transform.GetTranslation();
+  current.right = transform.MultiplyDirection(vrb::Vector(1.0f, 0.0f, 0.0f));
+  current.forward = transform.MultiplyDirection(vrb::Vector(0.0f, 0.0f, 1.0f));
+  aWidget.GetWorldSize(current.worldWidth, current.worldHeight);
+  current.cylinder = aWidget.GetCylinder() != nullptr;
+
+  auto it = widgetDepths.find(&aWidget);
+  if (it != widgetDepths.end()) {
+    const WidgetDepth& cached = it->second;
+    if ((current.position - cached.position).Magnitude() <= kDepthSortPositionThreshold &&
+        current.right.Dot(cached.right) >= kDepthSortDirectionThreshold &&
+        current.forward.Dot(cached.forward) >= kDepthSortDirectionThreshold &&
+        current.worldWidth == cached.worldWidth && current.worldHeight == cached.worldHeight &&
+        current.cylinder == cached.cylinder) {
+      return cached.z;
+    }
+  }
+
+  current.z = ComputeNormalizedZ(aWidget);
+  widgetDepths[&aWidget] = current;
+  return current.z;
+}
+
 void
-BrowserWorld::State::SortWidgets() {
+BrowserWorld::State::BindTransparentNodes() {
+  depthOrder.clear();
   depthSorting.clear();
-
-  // Compute normalized z for each widget
+  widgetDepths.clear();
   for (int i = 0; i < rootTransparent->GetNodeCount(); ++i) {
     vrb::NodePtr node = rootTransparent->GetNode(i);
-    Widget * target = nullptr;
-    float zDelta = 0.0f;
+    DepthSortEntry entry;
     for (const auto & widget: widgets) {
       if (widget->GetRoot() == node) {
-        target = widget.get();
+        entry.widget = widget.get();
         break;
       }
     }
-    if (!target) {
+    if (!entry.widget) {
       for (Controller& controller: controllers->GetControllers()) {
         if (controller.pointer && controller.pointer->GetRoot() == node) {
-          target = controller.pointer->GetHitWidget().get();
-          zDelta = 0.02f;
+          entry.pointer = controller.pointer;
           break;
         }
       }
     }
+    if (!entry.widget && !entry.pointer && widgetResizer && widgetResizer->GetRoot() == node) {
+      entry.resizer = true;
+    }
+    depthSorting[node.get()] = entry;
+    depthOrder.push_back(std::move(node));
+  }
+  depthSortDirty = false;
+}
 
-    if (!target && widgetResizer && widgetResizer->GetRoot() == node) {
-      target = widgetResizer->GetWidget();
-      zDelta = 0.01f;
+bool
+BrowserWorld::State::DrawsBefore(const DepthSortEntry& aFirst, const DepthSortEntry& aSecond) const {
+  Widget* wa = aFirst.target;
+  Widget* wb = aSecond.target;
+
+  // Parenting sort
+  if (wa && wb && wa->IsVisible() && wb->IsVisible()) {
+    if (IsParent(*wa, *wb)) {
+      return true;
+    } else if (IsParent(*wb, *wa)) {
+      return false;
     }
+  }
 
-    if (!target || !target->IsVisible()) {
-      depthSorting.emplace(node.get(), std::make_pair(target, 1.0f));
-      continue;
+  // Depth sort
+  return aFirst.z < aSecond.z;
+}
+
+void
+BrowserWorld::State::SortWidgets() {
+  depthSortFrames++;
+  bool changed = false;
+  if (depthSortDirty || rootTransparent->GetNodeCount() != (int)depthOrder.size()) {
+    BindTransparentNodes();
+    changed = true;
+  }
+
+  // Depth keys only depend on the head ray and the widget transforms, so they
+  // are kept until the head or the reorient transform moves noticeably.
+  const vrb::Matrix& head = device->GetHeadTransform();
+  const vrb::Matrix& reorient = device->GetReorientTransform();
+  const vrb::Vector headPosition = head.GetTranslation();
+  const vrb::Vector headDirection = head.MultiplyDirection(vrb::Vector(0.0f, 0.0f, -1.0f));
+  const vrb::Vector reorientPosition = reorient.GetTranslation();
+  const vrb::Vector reorientDirection = reorient.MultiplyDirection(vrb::Vector(0.0f, 0.0f, -1.0f));
+  if ((headPosition - depthSortHeadPosition).Magnitude() > kDepthSortPositionThreshold ||
+      headDirection.Dot(depthSortHeadDirection) < kDepthSortDirectionThreshold ||
+      (reorientPosition - depthSortReorientPosition).Magnitude() > kDepthSortPositionThreshold ||
+      reorientDirection.Dot(depthSortReorientDirection) < kDepthSortDirectionThreshold) {
+    widgetDepths.clear();
+    depthSortHeadPosition = headPosition;
+    depthSortHeadDirection = headDirection;
+    depthSortReorientPosition = reorientPosition;
+    depthSortReorientDirection = reorientDirection;
+  }
+
+  for (const vrb::NodePtr& node: depthOrder) {
+    DepthSortEntry& entry = depthSorting[node.get()];
+    Widget* target = entry.widget;
+    float zDelta = 0.0f;
+    if (entry.pointer) {
+      target = entry.pointer->GetHitWidget().get();
+      zDelta = 0.02f;
+    } else if (entry.resizer) {
+      target = widgetResizer ? widgetResizer->GetWidget() : nullptr;
+      zDelta = 0.01f;
     }
 
-    const float z = ComputeNormalizedZ(*target) - zDelta;
+    float z = 1.0f;
+    if (target && target->IsVisible()) {
+      z = GetDepthKey(*target) - zDelta;
+    }
+    if (z != entry.z || target != entry.target) {
+      changed = true;
+    }
+    entry.target = target;
+    entry.z = z;
+  }
 
-    depthSorting.emplace(node.get(), std::make_pair(target, z));
+  if (!changed) {
+    depthSortSkippedFrames++;
+    return;
   }
 
-  // Sort nodes based on cached depth values
-  rootTransparent->SortNodes([=](const NodePtr& a, const NodePtr& b) {
-    auto da = depthSorting.find(a.get());
-    auto db = depthSorting.find(b.get());
-    Widget* wa = da->second.first;
-    Widget* wb = db->second.first;
-
-    // Parenting sort
-    if (wa && wb && wa->IsVisible() && wb->IsVisible()) {
-      if (IsParent(*wa, *wb)) {
-        return true;
-      } else if (IsParent(*wb, *wa)) {
-        return false;
+  // The order rarely changes between frames, so an insertion sort over the
+  // previous order is close to linear.
+  bool moved = false;
+  for (size_t i = 1; i < depthOrder.size(); ++i) {
+    for (size_t j = i; j > 0; --j) {
+      if (!DrawsBefore(depthSorting[depthOrder[j].get()], depthSorting[depthOrder[j - 1].get()])) {
+        break;
       }
+      std::swap(depthOrder[j], depthOrder[j - 1]);
+      moved = true;
     }
+  }
+
+  if (!moved) {
+    depthSortSkippedFrames++;
+    return;
+  }
 
-    // Depth sort
-    return da->second.second < db->second.second;
+  for (size_t i = 0; i < depthOrder.size(); ++i) {
+    depthSorting[depthOrder[i].get()].rank = i;
+  }
+  rootTransparent->SortNodes([=](const NodePtr& a, const NodePtr& b) {
+    return depthSorting.find(a.get())->second.rank < depthSorting.find(b.get())->second.rank;
   });
 }
 
@@ -750,6 +1036,54 @@ BrowserWorld::State::UpdateWidgetCylinder(const WidgetPtr& aWidget, const float
   }
 }
 
+bool
+BrowserWorld::State::QueueWidgetChange(const WidgetChange aChange, const int32_t aHandle, const WidgetPlacementPtr& aPlacement) {
+  // Once a transaction is pending, later changes are queued too so that they keep their order.
+  if (applyingTransaction || (transactionDepth == 0 && pendingChanges.empty())) {
+    return false;
+  }
+  transactionQueued++;
+  auto it = pendingChangesByHandle.find(aHandle);
+  PendingWidgetChange* last = it != pendingChangesByHandle.end() ? &pendingChanges[it->second] : nullptr;
+  if (last && !last->dropped) {
+    if (aChange != WidgetChange::Remove && last->change != WidgetChange::Remove) {
+      // A later add or update only replaces the placement of the queued one. An add
+      // queued after an update of a widget not yet in the world still has to create it.
+      if (aChange == WidgetChange::Add && !GetWidget(aHandle)) {
+        last->change = WidgetChange::Add;
+      }
+      last->placement = aPlacement;
+      return true;
+    }
+    if (aChange == WidgetChange::Remove && last->change == WidgetChange::Remove) {
+      return true;
+    }
+    if (aChange == WidgetChange::Remove) {
+      last->dropped = true;
+      if (last->change == WidgetChange::Add && !GetWidget(aHandle)) {
+        // The widget never reaches the world.
+        pendingChangesByHandle.erase(it);
+        return true;
+      }
+    }
+  }
+  pendingChangesByHandle[aHandle] = pendingChanges.size();
+  pendingChanges.push_back({aChange, aHandle, aPlacement, false});
+  return true;
+}
+
+bool
+BrowserWorld::State::QueueWidgetCall(const std::function<void()>& aCall) {
+  if (applyingTransaction || (transactionDepth == 0 && pendingChanges.empty())) {
+    return false;
+  }
+  transactionQueued++;
+  // Later changes must not be merged into ones queued before the call.
+  pendingChangesByHandle.clear();
+  pendingChanges.push_back({WidgetChange::Call, 0, nullptr, false, aCall});
+  return true;
+}
+
 static BrowserWorldPtr sWorldInstance;
 
 BrowserWorld&
@@ -881,6 +1215,8 @@ BrowserWorld::InitializeGL() {
       VRB_GL_CHECK(glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA));
       VRB_GL_CHECK(glEnable(GL_DEPTH_TEST));
       VRB_GL_CHECK(glEnable(GL_CULL_FACE));
+      m.blitter->SetEnabledCapabilities(true, true);
+      m.blitter->SetBlendFunction(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
       if (!m.glInitialized) {
         return;
       }
@@ -954,6 +1290,9 @@ BrowserWorld::StartFrame() {
       m.loader->InitializeGL();
     }
   }
+  if (m.transactionReady && m.transactionDepth == 0) {
+    ApplyWidgetTransaction();
+  }
 
   m.device->ProcessEvents();
   m.context->Update();
@@ -970,11 +1309,16 @@ BrowserWorld::StartFrame() {
     m.CheckBackButton();
     TickImmersive();
   } else {
+    m.framePacer->Reset();
+    if (m.immersiveLayer) {
+      m.device->DeleteLayer(m.immersiveLayer);
+      m.immersiveLayer = nullptr;
+    }
     bool relayoutWidgets = false;
     m.UpdateGazeModeState();
     m.UpdateControllers(relayoutWidgets);
     if (relayoutWidgets) {
-      UpdateVisibleWidgets();
+      UpdateDirtyWidgets();
     }
     TickWorld();
     m.externalVR->PushSystemState();
@@ -1068,6 +1412,9 @@ BrowserWorld::SetSurfaceTexture(const std::string& aName, jobject& aSurface) {
 void
 BrowserWorld::AddWidget(int32_t aHandle, const WidgetPlacementPtr& aPlacement) {
   ASSERT_ON_RENDER_THREAD();
+  if (m.QueueWidgetChange(State::WidgetChange::Add, aHandle, aPlacement)) {
+    return;
+  }
   if (m.GetWidget(aHandle)) {
     VRB_LOG("Widget with handle %d already added, updating it.", aHandle);
     UpdateWidget(aHandle, aPlacement);
@@ -1114,6 +1461,8 @@ BrowserWorld::AddWidget(int32_t aHandle, const WidgetPlacementPtr& aPlacement) {
   }
 
   m.widgets.push_back(widget);
+  m.widgetsByHandle[aHandle] = widget;
+  m.depthSortDirty = true;
   UpdateWidget(widget->GetHandle(), aPlacement);
 }
 
@@ -1134,6 +1483,7 @@ BrowserWorld::UpdateWidget(int32_t aHandle, const WidgetPlacementPtr& aPlacement
   }
 
   widget->SetPlacement(aPlacement);
+  m.hierarchy->SetParent(aHandle, aPlacement->parentHandle);
   m.UpdateWidgetCylinder(widget, m.cylinderDensity);
   widget->ToggleWidget(aPlacement->visible);
   widget->SetSurfaceTextureSize(aPlacement->GetTextureWidth(), aPlacement->GetTextureHeight());
@@ -1155,8 +1505,38 @@ BrowserWorld::UpdateWidget(int32_t aHandle, const WidgetPlacementPtr& aPlacement
   LayoutWidget(aHandle);
 }
 
+void
+BrowserWorld::UpdateWidgets(const uint8_t* aData, const size_t aSize) {
+  ASSERT_ON_RENDER_THREAD();
+  size_t offset = 0;
+  if (!aData || aSize < 2 * sizeof(int32_t)) {
+    VRB_ERROR("Packed widget placements too small: %zu bytes", aSize);
+    return;
+  }
+  int32_t version = 0, count = 0;
+  memcpy(&version, aData, sizeof(int32_t));
+  memcpy(&count, aData + sizeof(int32_t), sizeof(int32_t));
+  offset += 2 * sizeof(int32_t);
+  if (version != WidgetPlacement::kPackedVersion) {
+    VRB_ERROR("Unsupported packed widget placement version: %d", version);
+    return;
+  }
+  for (int32_t i = 0; i < count; i++) {
+    int32_t handle = 0;
+    WidgetPlacementPtr placement = WidgetPlacement::FromBuffer(aData, aSize, offset, handle);
+    if (!placement) {
+      VRB_ERROR("Truncated packed widget placement %d of %d", i, count);
+      return;
+    }
+    UpdateWidgetRecursive(handle, placement);
+  }
+}
+
 void
 BrowserWorld::UpdateWidgetRecursive(int32_t aHandle, const WidgetPlacementPtr& aPlacement) {
+  if (m.QueueWidgetChange(State::WidgetChange::Update, aHandle, aPlacement)) {
+    return;
+  }
   UpdateWidget(aHandle, aPlacement);
   for (WidgetPtr& widget: m.widgets) {
     if (widget->GetPlacement() && widget->GetPlacement()->parentHandle == aHandle) {
@@ -1168,6 +1548,9 @@ BrowserWorld::UpdateWidgetRecursive(int32_t aHandle, const WidgetPlacementPtr& a
 void
 BrowserWorld::RemoveWidget(int32_t aHandle) {
   ASSERT_ON_RENDER_THREAD();
+  if (m.QueueWidgetChange(State::WidgetChange::Remove, aHandle, nullptr)) {
+    return;
+  }
   WidgetPtr widget = m.GetWidget(aHandle);
   if (widget) {
     widget->ResetFirstDraw();
@@ -1176,6 +1559,10 @@ BrowserWorld::RemoveWidget(int32_t aHandle) {
     if (it != m.widgets.end()) {
       m.widgets.erase(it);
     }
+    m.widgetsByHandle.erase(aHandle);
+    m.hierarchy->Remove(aHandle);
+    m.dirtyWidgets.erase(aHandle);
+    m.depthSortDirty = true;
     if (widget->GetLayer()) {
       m.device->DeleteLayer(widget->GetLayer());
     }
@@ -1185,16 +1572,23 @@ BrowserWorld::RemoveWidget(int32_t aHandle) {
 void
 BrowserWorld::StartWidgetResize(int32_t aHandle, const vrb::Vector& aMaxSize, const vrb::Vector& aMinSize) {
   ASSERT_ON_RENDER_THREAD();
+  if (m.QueueWidgetCall([=]() { StartWidgetResize(aHandle, aMaxSize, aMinSize); })) {
+    return;
+  }
   WidgetPtr widget = m.GetWidget(aHandle);
   if (widget) {
     m.widgetResizer = widget->StartResize(aMaxSize, aMinSize);
     m.rootTransparent->AddNode(m.widgetResizer->GetRoot());
+    m.depthSortDirty = true;
   }
 }
 
 void
 BrowserWorld::FinishWidgetResize(int32_t aHandle) {
   ASSERT_ON_RENDER_THREAD();
+  if (m.QueueWidgetCall([=]() { FinishWidgetResize(aHandle); })) {
+    return;
+  }
   WidgetPtr widget = m.GetWidget(aHandle);
   if (!widget) {
     return;
@@ -1203,12 +1597,16 @@ BrowserWorld::FinishWidgetResize(int32_t aHandle) {
   if (m.widgetResizer) {
     m.widgetResizer->GetRoot()->RemoveFromParents();
     m.widgetResizer = nullptr;
+    m.depthSortDirty = true;
   }
 }
 
 void
 BrowserWorld::StartWidgetMove(int32_t aHandle, int32_t aMoveBehavour) {
   ASSERT_ON_RENDER_THREAD();
+  if (m.QueueWidgetCall([=]() { StartWidgetMove(aHandle, aMoveBehavour); })) {
+    return;
+  }
   WidgetPtr widget = m.GetWidget(aHandle);
   if (!widget) {
     return;
@@ -1251,32 +1649,133 @@ BrowserWorld::StartWidgetMove(int32_t aHandle, int32_t aMoveBehavour) {
 void
 BrowserWorld::FinishWidgetMove() {
   ASSERT_ON_RENDER_THREAD();
+  if (m.QueueWidgetCall([=]() { FinishWidgetMove(); })) {
+    return;
+  }
   if (m.movingWidget) {
     m.movingWidget->EndMoving();
   }
   m.movingWidget = nullptr;
 }
 
+void
+BrowserWorld::BeginWidgetTransaction() {
+  ASSERT_ON_RENDER_THREAD();
+  m.transactionDepth++;
+}
+
+void
+BrowserWorld::CommitWidgetTransaction() {
+  ASSERT_ON_RENDER_THREAD();
+  if (m.transactionDepth <= 0) {
+    VRB_ERROR("CommitWidgetTransaction called without BeginWidgetTransaction");
+    return;
+  }
+  m.transactionDepth--;
+  if (m.transactionDepth == 0) {
+    m.transactionCommits++;
+    m.transactionReady = !m.pendingChanges.empty();
+  }
+}
+
+void
+BrowserWorld::GetWidgetTransactionStats(uint64_t& aCommits, uint64_t& aQueued, uint64_t& aApplied) const {
+  aCommits = m.transactionCommits;
+  aQueued = m.transactionQueued;
+  aApplied = m.transactionApplied;
+}
+
+bool
+BrowserWorld::HasWidget(int32_t aHandle) const {
+  return m.GetWidget(aHandle) != nullptr;
+}
+
+void
+BrowserWorld::ApplyWidgetTransaction() {
+  m.applyingTransaction = true;
+  std::vector<State::PendingWidgetChange> changes;
+  changes.swap(m.pendingChanges);
+  m.pendingChangesByHandle.clear();
+  for (const State::PendingWidgetChange& pending: changes) {
+    if (pending.dropped) {
+      continue;
+    }
+    m.transactionApplied++;
+    switch (pending.change) {
+      case State::WidgetChange::Add:
+        AddWidget(pending.handle, pending.placement);
+        break;
+      case State::WidgetChange::Update:
+        UpdateWidgetRecursive(pending.handle, pending.placement);
+        break;
+      case State::WidgetChange::Remove:
+        RemoveWidget(pending.handle);
+        break;
+      case State::WidgetChange::Call:
+        pending.call();
+        break;
+    }
+  }
+  m.applyingTransaction = false;
+  m.transactionReady = false;
+}
+
 void
 BrowserWorld::UpdateVisibleWidgets() {
   ASSERT_ON_RENDER_THREAD();
+  if (m.QueueWidgetCall([=]() { UpdateVisibleWidgets(); })) {
+    return;
+  }
+  for (const WidgetPtr& widget: m.widgets) {
+    m.dirtyWidgets[widget->GetHandle()] |= kDirtyPlacement;
+  }
+  UpdateDirtyWidgets();
+}
 
-  std::vector<WidgetPtr> widgets = m.widgets;
-  // Sort by parent before updating.
-  std::sort(widgets.begin(), widgets.end(), [=](const WidgetPtr& a, const WidgetPtr& b) {
-    int parentsA = m.ParentCount(a);
-    int parentsB = m.ParentCount(b);
-    if (parentsA != parentsB) {
-      return parentsA < parentsB;
+void
+BrowserWorld::UpdateDirtyWidgets() {
+  if (m.dirtyWidgets.empty()) {
+    return;
+  }
+
+  std::vector<std::pair<WidgetPtr, uint8_t>> touched;
+  for (const WidgetPtr& widget: m.widgets) {
+    const int32_t handle = widget->GetHandle();
+    uint8_t flags = 0;
+    auto it = m.dirtyWidgets.find(handle);
+    if (it != m.dirtyWidgets.end()) {
+      flags = it->second;
+    }
+    if (!(flags & kDirtyTransform)) {
+      for (const auto& dirty: m.dirtyWidgets) {
+        if (m.hierarchy->IsAncestor(dirty.first, handle)) {
+          flags |= kDirtyTransform;
+          break;
+        }
+      }
+    }
+    if (flags && widget->IsVisible() && !widget->IsResizing()) {
+      touched.emplace_back(widget, flags);
     }
-    return m.IsParent(*b, *a);
+  }
+  m.dirtyWidgets.clear();
+
+  // Parents are laid out before their children.
+  std::stable_sort(touched.begin(), touched.end(), [=](const std::pair<WidgetPtr, uint8_t>& a,
+                                                       const std::pair<WidgetPtr, uint8_t>& b) {
+    return m.ParentCount(a.first) < m.ParentCount(b.first);
   });
 
-  for (const WidgetPtr& widget: widgets) {
-    if (widget->IsVisible() && !widget->IsResizing()) {
+  for (const auto& entry: touched) {
+    const WidgetPtr& widget = entry.first;
+    if (entry.second & (kDirtyPlacement | kDirtySize)) {
       UpdateWidget(widget->GetHandle(), widget->GetPlacement());
+    } else {
+      LayoutWidget(widget->GetHandle());
     }
   }
+  m.layoutPasses++;
+  m.layoutWidgetsTouched += touched.size();
 }
 
 void
@@ -1420,6 +1919,37 @@ BrowserWorld::SetIsServo(const bool aIsServo) {
   m.externalVR->SetSourceBrowser(aIsServo ? ExternalVR::VRBrowserType::Servo : ExternalVR::VRBrowserType::Gecko);
 }
 
+void
+BrowserWorld::GetLayoutStats(uint64_t& aPasses, uint64_t& aWidgetsTouched) const {
+  aPasses = m.layoutPasses;
+  aWidgetsTouched = m.layoutWidgetsTouched;
+}
+
+void
+BrowserWorld::GetHitTestStats(uint64_t& aExact, uint64_t& aSkipped, uint64_t& aBatched) const {
+  aExact = m.hitTestsExact;
+  aSkipped = m.hitTestsSkipped;
+  aBatched = m.hitTestsBatched;
+}
+
+void
+BrowserWorld::GetTransformCacheStats(uint64_t& aHits, uint64_t& aMisses) const {
+  aHits = 0;
+  aMisses = 0;
+  for (const WidgetPtr& widget: m.widgets) {
+    uint64_t hits = 0, misses = 0;
+    widget->GetTransformCacheStats(hits, misses);
+    aHits += hits;
+    aMisses += misses;
+  }
+}
+
+void
+BrowserWorld::GetDepthSortStats(uint64_t& aFrames, uint64_t& aSkippedFrames) const {
+  aFrames = m.depthSortFrames;
+  aSkippedFrames = m.depthSortSkippedFrames;
+}
+
 JNIEnv*
 BrowserWorld::GetJNIEnv() const {
   ASSERT_ON_RENDER_THREAD(nullptr);
@@ -1452,8 +1982,8 @@ BrowserWorld::TickWorld() {
 
   m.SortWidgets();
   m.device->StartFrame();
-  m.rootOpaque->SetTransform(m.device->GetReorientTransform());
-  m.rootTransparent->SetTransform(m.device->GetReorientTransform());
+  m.SetRootTransform(m.rootOpaque, m.device->GetReorientTransform());
+  m.SetRootTransform(m.rootTransparent, m.device->GetReorientTransform());
 
   m.drawHandler = [=](device::Eye aEye) {
     DrawWorld(aEye);
@@ -1487,12 +2017,25 @@ void
 BrowserWorld::TickImmersive() {
   m.externalVR->SetCompositorEnabled(false);
   m.device->SetRenderMode(device::RenderMode::Immersive);
+  m.externalVR->SetPosePredictionFrames(m.device->GetPosePredictionFrames());
 
   const bool supportsFrameAhead = m.device->SupportsFramePrediction(DeviceDelegate::FramePrediction::ONE_FRAME_AHEAD);
-  auto framePrediction = DeviceDelegate::FramePrediction::ONE_FRAME_AHEAD;
-  if (!supportsFrameAhead || (m.externalVR->GetVRState() != ExternalVR::VRState::Rendering) || m.webXRInterstialState != WebXRInterstialState::HIDDEN) {
-      // Do not use one frame ahead prediction if not supported or we are rendering the spinner.
-      framePrediction = DeviceDelegate::FramePrediction::NO_FRAME_AHEAD;
+  // Do not use frame ahead prediction if not supported or we are rendering the spinner.
+  const bool paceFrames = supportsFrameAhead && (m.externalVR->GetVRState() == ExternalVR::VRState::Rendering) &&
+                          m.webXRInterstialState == WebXRInterstialState::HIDDEN;
+  auto framePrediction = DeviceDelegate::FramePrediction::NO_FRAME_AHEAD;
+  if (paceFrames) {
+    m.framePacer->SetMaxPrediction(
+        m.device->SupportsFramePrediction(DeviceDelegate::FramePrediction::TWO_FRAMES_AHEAD) ?
+        DeviceDelegate::FramePrediction::TWO_FRAMES_AHEAD : DeviceDelegate::FramePrediction::ONE_FRAME_AHEAD);
+    m.framePacer->StartFrame();
+    framePrediction = m.framePacer->GetPrediction();
+    m.externalVR->SetFrameWaitTimeout(m.framePacer->GetWaitBudget());
+  } else {
+    m.externalVR->SetFrameWaitTimeout(kUnpacedFrameWaitTimeout);
+  }
+  if (framePrediction == DeviceDelegate::FramePrediction::NO_FRAME_AHEAD) {
+      // Push this frame's poses and wait for Gecko to render them.
       m.device->StartFrame(framePrediction);
       if (m.webXRInterstialState != WebXRInterstialState::HIDDEN) {
           // Hide controller input until the interstitial is hidden.
@@ -1500,32 +2043,65 @@ BrowserWorld::TickImmersive() {
       }
       m.externalVR->PushFramePoses(m.device->GetHeadTransform(), m.controllers->GetControllers(),
                                    m.context->GetTimestamp());
+      m.device->SetFramePoseId(m.externalVR->GetInputFrameId());
   }
   int32_t surfaceHandle, textureWidth, textureHeight = 0;
   device::EyeRect leftEye, rightEye;
   bool aDiscardFrame = !m.externalVR->WaitFrameResult();
+  if (paceFrames) {
+    m.framePacer->FrameArrived(aDiscardFrame);
+  }
   m.externalVR->GetFrameResult(surfaceHandle, textureWidth, textureHeight, leftEye, rightEye);
+  // Gecko tags the submitted frame with the inputFrameID of the poses it rendered with.
+  const uint64_t submittedFrameId = m.externalVR->GetFrameId();
   ExternalVR::VRState state = m.externalVR->GetVRState();
   if (supportsFrameAhead) {
-      if (framePrediction != DeviceDelegate::FramePrediction::ONE_FRAME_AHEAD) {
-          // StartFrame() has been already called to render the spinner, do not call it again.
-          // Instead, repeat the XR frame and render the spinner while we transition
-          // to one frame ahead prediction.
-          state = ExternalVR::VRState::Loading;
+      // The pacer may have changed the depth for the next frame.
+      const auto nextPrediction = paceFrames ? m.framePacer->GetPrediction() : DeviceDelegate::FramePrediction::ONE_FRAME_AHEAD;
+      if (framePrediction == DeviceDelegate::FramePrediction::NO_FRAME_AHEAD) {
+          if (!paceFrames) {
+              // StartFrame() has been already called to render the spinner, do not call it again.
+              // Instead, repeat the XR frame and render the spinner while we transition
+              // to frame ahead prediction.
+              state = ExternalVR::VRState::Loading;
+          }
       } else {
-          // Predict poses for one frame ahead and push the data to shmem so Gecko
-          // can start the next XR RAF ASAP.
-          m.device->StartFrame(framePrediction);
+          m.device->StartFrame(nextPrediction);
+      }
+      // Predict poses one or two frames ahead and push the data to shmem so Gecko
+      // can start the next XR RAF ASAP. Without frame ahead the next frame pushes its own poses,
+      // pushing here too would keep Gecko a frame ahead.
+      if (nextPrediction != DeviceDelegate::FramePrediction::NO_FRAME_AHEAD) {
+          m.externalVR->PushFramePoses(m.device->GetHeadTransform(), m.controllers->GetControllers(),
+                  m.context->GetTimestamp());
+          m.device->SetFramePoseId(m.externalVR->GetInputFrameId());
       }
-      m.externalVR->PushFramePoses(m.device->GetHeadTransform(), m.controllers->GetControllers(),
-              m.context->GetTimestamp());
   }
+  const bool reprojectFrames = m.device->NeedsFrameReprojection();
+  bool reprojected = false;
   if (state == ExternalVR::VRState::Rendering) {
+    // Extra layers are composited over the main one, also over a reprojected frame.
+    m.externalVR->GetOverlayLayers(m.overlayLayers);
+    m.blitter->SetOverlayLayers(m.overlayLayers);
     if (!aDiscardFrame) {
       if (textureWidth > 0 && textureHeight > 0) {
         m.device->SetImmersiveSize((uint32_t) textureWidth/2, (uint32_t) textureHeight);
+        if (m.immersiveLayer) {
+          m.immersiveLayer->Resize(textureWidth, textureHeight);
+        } else {
+          m.immersiveLayer = m.device->CreateLayerProjection(textureWidth, textureHeight);
+        }
       }
       m.blitter->StartFrame(surfaceHandle, leftEye, rightEye);
+      if (reprojectFrames) {
+        vrb::Matrix renderHeadTransform;
+        double renderTimestamp = 0.0;
+        if (m.externalVR->GetFramePose(submittedFrameId, renderHeadTransform, renderTimestamp)) {
+          m.blitter->KeepFrame(renderHeadTransform, textureWidth, textureHeight);
+        } else {
+          m.blitter->ClearKeptFrame();
+        }
+      }
       if (m.webXRInterstialState != WebXRInterstialState::HIDDEN) {
         TickWebXRInterstitial();
       } else {
@@ -1538,9 +2114,26 @@ BrowserWorld::TickImmersive() {
             DrawImmersive(aEye);
         };
       }
+    } else if (reprojectFrames && m.webXRInterstialState == WebXRInterstialState::HIDDEN) {
+      // Give the display a fresh image by rotating the last WebXR frame to the current head pose.
+      reprojected = m.blitter->StartReprojectedFrame(m.device->GetHeadTransform(),
+                                                     m.device->GetCamera(device::Eye::Left)->GetPerspective(),
+                                                     m.device->GetCamera(device::Eye::Right)->GetPerspective());
+      if (reprojected) {
+        m.drawHandler = [=](device::Eye aEye) {
+            DrawImmersive(aEye);
+        };
+      }
     }
     m.frameEndHandler = [=]() {
-      m.device->EndFrame(aDiscardFrame ? DeviceDelegate::FrameEndMode::DISCARD : DeviceDelegate::FrameEndMode::APPLY);
+      if (!aDiscardFrame) {
+        m.device->UseFramePose(submittedFrameId);
+      }
+      const bool discard = aDiscardFrame && !reprojected;
+      m.externalVR->RecordFrameOutcome(!aDiscardFrame ? ExternalVR::FrameOutcome::Presented :
+                                       reprojected ? ExternalVR::FrameOutcome::Reprojected :
+                                       ExternalVR::FrameOutcome::Discarded, framePrediction);
+      m.device->EndFrame(discard ? DeviceDelegate::FrameEndMode::DISCARD : DeviceDelegate::FrameEndMode::APPLY);
       m.blitter->EndFrame();
     };
   } else {
@@ -1553,13 +2146,23 @@ BrowserWorld::TickImmersive() {
 
 void
 BrowserWorld::DrawImmersive(device::Eye aEye) {
+  if (m.immersiveLayer) {
+    // Both eyes are drawn into the layer at once, the eye buffers are not used.
+    if (aEye == device::Eye::Left) {
+      m.immersiveLayer->Bind();
+      m.blitter->DrawStereo(m.immersiveLayer->GetWidth(), m.immersiveLayer->GetHeight());
+      m.immersiveLayer->Unbind();
+      m.immersiveLayer->RequestDraw();
+    }
+    return;
+  }
   m.device->BindEye(aEye);
   m.blitter->Draw(aEye);
 }
 
 void
 BrowserWorld::TickWebXRInterstitial() {
-  m.rootWebXRInterstitial->SetTransform(m.device->GetReorientTransform());
+  m.SetRootTransform(m.rootWebXRInterstitial, m.device->GetReorientTransform());
   m.drawHandler = [=](device::Eye eye) {
       DrawWebXRInterstitial(eye);
   };
@@ -1662,12 +2265,25 @@ JNI_METHOD(void, addWidgetNative)
   }
 }
 
-JNI_METHOD(void, updateWidgetNative)
-(JNIEnv* aEnv, jobject, jint aHandle, jobject aPlacement) {
-  crow::WidgetPlacementPtr placement = crow::WidgetPlacement::FromJava(aEnv, aPlacement);
-  if (placement) {
-    crow::BrowserWorld::Instance().UpdateWidgetRecursive(aHandle, placement);
+JNI_METHOD(void, updateWidgetsNative)
+(JNIEnv* aEnv, jobject, jobject aBuffer, jint aSize) {
+  const uint8_t* data = (const uint8_t*)aEnv->GetDirectBufferAddress(aBuffer);
+  const jlong capacity = aEnv->GetDirectBufferCapacity(aBuffer);
+  if (!data || capacity < aSize) {
+    VRB_ERROR("updateWidgetsNative requires a direct ByteBuffer");
+    return;
   }
+  crow::BrowserWorld::Instance().UpdateWidgets(data, (size_t)aSize);
+}
+
+JNI_METHOD(void, beginWidgetTransactionNative)
+(JNIEnv*, jobject) {
+  crow::BrowserWorld::Instance().BeginWidgetTransaction();
+}
+
+JNI_METHOD(void, commitWidgetTransactionNative)
+(JNIEnv*, jobject) {
+  crow::BrowserWorld::Instance().CommitWidgetTransaction();
 }
 
 JNI_METHOD(void, updateVisibleWidgetsNative)
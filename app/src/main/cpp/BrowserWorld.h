@@ -53,11 +53,20 @@ public:
   void AddWidget(int32_t aHandle, const WidgetPlacementPtr& placement);
   void UpdateWidget(int32_t aHandle, const WidgetPlacementPtr& aPlacement);
   void UpdateWidgetRecursive(int32_t aHandle, const WidgetPlacementPtr& aPlacement);
+  // Applies a versioned batch of packed placements, see WidgetPlacement.packInto().
+  void UpdateWidgets(const uint8_t* aData, const size_t aSize);
   void RemoveWidget(int32_t aHandle);
   void StartWidgetResize(int32_t aHandle, const vrb::Vector& aMaxSize, const vrb::Vector& aMinSize);
   void FinishWidgetResize(int32_t aHandle);
   void StartWidgetMove(int32_t aHandle, const int32_t aMoveBehavour);
   void FinishWidgetMove();
+  // Add, update and remove calls made inside a transaction are queued, coalesced
+  // by handle and applied at the start of the first frame after the commit.
+  void BeginWidgetTransaction();
+  void CommitWidgetTransaction();
+  void GetWidgetTransactionStats(uint64_t& aCommits, uint64_t& aQueued, uint64_t& aApplied) const;
+  // Whether the widget is in the world, queued changes are not applied yet.
+  bool HasWidget(int32_t aHandle) const;
   void UpdateVisibleWidgets();
   void LayoutWidget(int32_t aHandle);
   void SetBrightness(const float aBrightness);
@@ -72,12 +81,23 @@ public:
   void SetIsServo(const bool aIsServo);
   void SetCPULevel(const device::CPULevel aLevel);
   JNIEnv* GetJNIEnv() const;
+  // Frames that ran SortWidgets and frames where the full node sort was skipped.
+  void GetDepthSortStats(uint64_t& aFrames, uint64_t& aSkippedFrames) const;
+  // Relayout passes run and the total number of widgets they updated.
+  void GetLayoutStats(uint64_t& aPasses, uint64_t& aWidgetsTouched) const;
+  // Controller widget hit tests that ran exactly, ones rejected by bounding spheres
+  // and ones answered by the batched quad kernel.
+  void GetHitTestStats(uint64_t& aExact, uint64_t& aSkipped, uint64_t& aBatched) const;
+  // Widget world transform cache lookups, summed over the current widgets.
+  void GetTransformCacheStats(uint64_t& aHits, uint64_t& aMisses) const;
 protected:
   struct State;
   static BrowserWorldPtr Create();
   BrowserWorld(State& aState);
   ~BrowserWorld() = default;
   void TickWorld();
+  void UpdateDirtyWidgets();
+  void ApplyWidgetTransaction();
   void TickImmersive();
   void TickSplashAnimation();
   void TickWebXRInterstitial();
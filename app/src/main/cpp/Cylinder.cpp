@@ -5,6 +5,7 @@
 
 #include "Cylinder.h"
 #include "Quad.h"
+#include "TransformCache.h"
 #include "VRLayer.h"
 #include "VRLayerNode.h"
 #include "vrb/ConcreteClass.h"
@@ -23,6 +24,8 @@
 #include "vrb/Vector.h"
 #include "vrb/VertexArray.h"
 
+#include <algorithm>
+
 namespace crow {
 
 // Ratio between world size and cylinder surface size.
@@ -38,6 +41,7 @@ struct Cylinder::State {
   int32_t textureHeight;
   vrb::TogglePtr root;
   vrb::TransformPtr transform;
+  TransformCachePtr transformCache;
   vrb::GeometryPtr geometry;
   float radius;
   float height;
@@ -62,6 +66,7 @@ struct Cylinder::State {
   void Initialize() {
     vrb::CreationContextPtr create = context.lock();
     transform = vrb::Transform::Create(create);
+    transformCache = TransformCache::Create(transform);
     if (layer) {
       textureWidth = layer->GetWidth();
       textureHeight = layer->GetHeight();
@@ -365,9 +370,15 @@ Cylinder::GetTransformNode() const {
   return m.transform;
 }
 
+const TransformCachePtr&
+Cylinder::GetTransformCache() const {
+  return m.transformCache;
+}
+
 void
 Cylinder::SetTransform(const vrb::Matrix& aTransform) {
   m.transform->SetTransform(aTransform);
+  m.transformCache->Invalidate();
 }
 
 static const float kEpsilon = 0.00000001f;
@@ -379,8 +390,8 @@ Cylinder::TestIntersection(const vrb::Vector& aStartPoint, const vrb::Vector& aD
     return false;
   }
 
-  vrb::Matrix worldTransform = m.transform->GetWorldTransform();
-  vrb::Matrix modelView = worldTransform.AfineInverse();
+  const vrb::Matrix& worldTransform = m.transformCache->GetWorldTransform();
+  const vrb::Matrix& modelView = m.transformCache->GetInverseWorldTransform();
   vrb::Vector start = modelView.MultiplyPosition(aStartPoint);
   vrb::Vector direction = modelView.MultiplyDirection(aDirection);
   if (vrb::Vector(start.x(), 0.0f, start.z()).Magnitude() <= m.radius) {
@@ -448,9 +459,20 @@ Cylinder::TestIntersection(const vrb::Vector& aStartPoint, const vrb::Vector& aD
   return true;
 }
 
+void
+Cylinder::GetHitBounds(vrb::Vector& aMin, vrb::Vector& aMax) const {
+  // Inside hits are on the front facing arc (z <= 0) within theta, and no
+  // further than the radius from the center vertically.
+  const float halfHeight = std::min(m.height * 0.5f, m.radius);
+  const float halfTheta = std::min(m.theta, (float)M_PI) * 0.5f;
+  const float maxX = m.radius * sinf(halfTheta);
+  aMin = vrb::Vector(-maxX, -halfHeight, -m.radius);
+  aMax = vrb::Vector(maxX, halfHeight, -m.radius * cosf(halfTheta));
+}
+
 void
 Cylinder::ConvertToQuadCoordinates(const vrb::Vector& point, float& aX, float& aY, bool aClamp) const {
-  const vrb::Vector intersection = m.transform->GetWorldTransform().AfineInverse().MultiplyPosition(point);
+  const vrb::Vector intersection = m.transformCache->GetInverseWorldTransform().MultiplyPosition(point);
   const float radius = GetCylinderRadius();
   float ratioY;
   if (intersection.y() > 0.0f) {
@@ -515,7 +537,7 @@ Cylinder::ConvertFromQuadCoordinates(const float aX, const float aY, vrb::Vector
   vrb::Vector targetPoint(x, y, z);
   aNormal = (vrb::Vector(0.0f, y, 0.0f) - targetPoint).Normalize();
 
-  aWorldPoint = m.transform->GetWorldTransform().MultiplyPosition(targetPoint);
+  aWorldPoint = m.transformCache->GetWorldTransform().MultiplyPosition(targetPoint);
 }
 
 float Cylinder::DistanceToBackPlane(const vrb::Vector &aStartPoint, const vrb::Vector &aDirection) const {
@@ -523,8 +545,8 @@ float Cylinder::DistanceToBackPlane(const vrb::Vector &aStartPoint, const vrb::V
   if (!m.root->IsEnabled(*m.transform)) {
     return result;
   }
-  vrb::Matrix worldTransform = m.transform->GetWorldTransform();
-  vrb::Matrix modelView = worldTransform.AfineInverse();
+  const vrb::Matrix& worldTransform = m.transformCache->GetWorldTransform();
+  const vrb::Matrix& modelView = m.transformCache->GetInverseWorldTransform();
   vrb::Vector point = modelView.MultiplyPosition(aStartPoint);
   vrb::Vector direction = modelView.MultiplyDirection(aDirection);
 
@@ -564,7 +586,7 @@ Cylinder::ProjectPointToQuad(const vrb::Vector& aWorldPoint, const float aAnchor
   // For cylinders we want to map the position in the cylinder to the position it would have on a quad.
   // This way we can reuse the same resize logic between quads and cylinders.
   // First Convert to world point to local point in the cylinder.
-  vrb::Matrix modelView = GetTransformNode()->GetWorldTransform().AfineInverse();
+  const vrb::Matrix& modelView = m.transformCache->GetInverseWorldTransform();
   vrb::Vector localPoint = modelView.MultiplyPosition(aWorldPoint);
   const float pointAngle = GetCylinderAngle(localPoint);
 
@@ -17,6 +17,9 @@
 
 namespace crow {
 
+class TransformCache;
+typedef std::shared_ptr<TransformCache> TransformCachePtr;
+
 
 class VRLayerCylinder;
 typedef std::shared_ptr<VRLayerCylinder> VRLayerCylinderPtr;
@@ -47,8 +50,11 @@ public:
   vrb::NodePtr GetRoot() const;
   VRLayerCylinderPtr GetLayer() const;
   vrb::TransformPtr GetTransformNode() const;
+  const TransformCachePtr& GetTransformCache() const;
   void SetTransform(const vrb::Matrix& aTransform);
   bool TestIntersection(const vrb::Vector& aStartPoint, const vrb::Vector& aDirection, vrb::Vector& aResult, vrb::Vector& aNormal, bool aClamp, bool& aIsInside, float& aDistance) const;
+  // Local space box holding every point TestIntersection reports as inside.
+  void GetHitBounds(vrb::Vector& aMin, vrb::Vector& aMax) const;
   void ConvertToQuadCoordinates(const vrb::Vector& point, float& aX, float& aY, bool aClamp) const;
   void ConvertFromQuadCoordinates(const float aX, const float aY, vrb::Vector& aWorldPoint, vrb::Vector& aNormal);
   float DistanceToBackPlane(const vrb::Vector& aStartPoint, const vrb::Vector& aDirection) const;
@@ -49,6 +49,7 @@ public:
   enum class FramePrediction {
       NO_FRAME_AHEAD,
       ONE_FRAME_AHEAD,
+      TWO_FRAMES_AHEAD,
   };
   enum class FrameEndMode {
       APPLY,
@@ -78,6 +79,16 @@ public:
   virtual void StartFrame(const FramePrediction aPrediction = FramePrediction::NO_FRAME_AHEAD) = 0;
   virtual void BindEye(const device::Eye aWhich) = 0;
   virtual void EndFrame(const FrameEndMode aMode = FrameEndMode::APPLY) = 0;
+  // Tags the pose predicted by the last StartFrame with the WebXR input frame ID it was published as.
+  virtual void SetFramePoseId(const uint64_t aInputFrameId) {}
+  // Ends the current frame with the pose tagged aInputFrameId, the pose the submitted WebXR frame was rendered with.
+  virtual void UseFramePose(const uint64_t aInputFrameId) {}
+  // Display frames between the poses read in StartFrame and the display of the frame rendered
+  // with them. Devices whose runtime already predicts poses to the display time return 0.
+  virtual float GetPosePredictionFrames() const { return 0.0f; }
+  // True if the runtime shows the previous frame unchanged when a frame ends with DISCARD,
+  // so late WebXR frames should be reprojected by the browser instead.
+  virtual bool NeedsFrameReprojection() const { return false; }
   virtual bool IsInGazeMode() const { return false; };
   virtual int32_t GazeModeIndex() const { return -1; };
   virtual VRLayerQuadPtr CreateLayerQuad(int32_t aWidth, int32_t aHeight,
@@ -86,6 +97,9 @@ public:
   virtual VRLayerCylinderPtr CreateLayerCylinder(int32_t aWidth, int32_t aHeight,
                                                 VRLayerSurface::SurfaceType aSurfaceType) { return nullptr; }
   virtual VRLayerCylinderPtr CreateLayerCylinder(const VRLayerSurfacePtr& aMoveLayer) { return nullptr; }
+  // Stereo layer the runtime composites instead of the eye buffers, nullptr if the device
+  // can not. Drawn through VRLayerSurface::Bind() and submitted when a draw is requested.
+  virtual VRLayerProjectionPtr CreateLayerProjection(int32_t aWidth, int32_t aHeight) { return nullptr; }
   virtual VRLayerCubePtr CreateLayerCube(int32_t aWidth, int32_t aHeight, GLint aInternalFormat) { return nullptr; }
   virtual VRLayerEquirectPtr CreateLayerEquirect(const VRLayerPtr &aSource) { return nullptr; }
   virtual void DeleteLayer(const VRLayerPtr& aLayer) {};
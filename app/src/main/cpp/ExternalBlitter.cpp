@@ -10,9 +10,14 @@
 #include "vrb/gl.h"
 #include "vrb/GLError.h"
 #include "vrb/Logger.h"
+#include "vrb/Matrix.h"
+#include "vrb/Quaternion.h"
 #include "vrb/ShaderUtil.h"
 
+#include <cstddef>
+#include <list>
 #include <map>
+#include <vector>
 
 namespace {
 const char* sVertexShader = R"SHADER(
@@ -38,11 +43,185 @@ void main() {
 }
 )SHADER";
 
-const GLfloat sVerticies[] = {
-    -1.0f, 1.0f, 0.0f,
-    -1.0f, -1.0f, 0.0f,
-    1.0f, 1.0f, 0.0f,
-    1.0f, -1.0f, 0.0f
+// Reprojects the kept frame. Clip space of the current view maps to the kept frame's clip
+// space through a homography, so interpolating its homogeneous result is exact. Each
+// vertex carries its eye, so both eyes of a side by side target are drawn at once.
+const char* sReprojectionVertexShader = R"SHADER(
+attribute vec4 a_position;
+attribute vec4 a_eyePosition;
+attribute float a_eye;
+uniform mat4 u_reprojection[2];
+uniform vec4 u_uvTransform[2];
+varying vec3 v_clip;
+varying vec4 v_uvTransform;
+void main(void) {
+  bool right = a_eye > 0.5;
+  vec4 clip = (right ? u_reprojection[1] : u_reprojection[0]) * a_eyePosition;
+  v_clip = clip.xyw;
+  v_uvTransform = right ? u_uvTransform[1] : u_uvTransform[0];
+  gl_Position = a_position;
+}
+)SHADER";
+
+const char* sReprojectionFragmentShader = R"SHADER(
+precision mediump float;
+
+uniform sampler2D u_texture0;
+
+varying vec3 v_clip;
+varying vec4 v_uvTransform;
+
+void main() {
+  vec2 uv = (v_clip.xy / v_clip.z) * 0.5 + 0.5;
+  if (v_clip.z <= 0.0 || any(lessThan(uv, vec2(0.0))) || any(greaterThan(uv, vec2(1.0)))) {
+    gl_FragColor = vec4(0.0, 0.0, 0.0, 1.0);
+  } else {
+    gl_FragColor = texture2D(u_texture0, uv * v_uvTransform.xy + v_uvTransform.zw);
+  }
+}
+)SHADER";
+
+struct Vertex {
+  GLfloat position[2];
+  // Position within the viewport of the vertex's eye, which the reprojection works in.
+  GLfloat eyePosition[2];
+  GLfloat uv[2];
+  GLfloat eye;
+};
+
+// First vertex and count of a triangle strip in sVertices.
+struct VertexRange {
+  GLint first;
+  GLsizei count;
+};
+
+// Uploaded once into the blitter's vertex buffer.
+const Vertex sVertices[] = {
+    // Left eye filling the viewport.
+    {{-1.0f, 1.0f}, {-1.0f, 1.0f}, {0.0f, 0.0f}, 0.0f},
+    {{-1.0f, -1.0f}, {-1.0f, -1.0f}, {0.0f, 1.0f}, 0.0f},
+    {{1.0f, 1.0f}, {1.0f, 1.0f}, {0.5f, 0.0f}, 0.0f},
+    {{1.0f, -1.0f}, {1.0f, -1.0f}, {0.5f, 1.0f}, 0.0f},
+    // Right eye filling the viewport.
+    {{-1.0f, 1.0f}, {-1.0f, 1.0f}, {0.5f, 0.0f}, 1.0f},
+    {{-1.0f, -1.0f}, {-1.0f, -1.0f}, {0.5f, 1.0f}, 1.0f},
+    {{1.0f, 1.0f}, {1.0f, 1.0f}, {1.0f, 0.0f}, 1.0f},
+    {{1.0f, -1.0f}, {1.0f, -1.0f}, {1.0f, 1.0f}, 1.0f},
+    // Copies the whole side by side frame upright, so the kept texture is indexed like clip space.
+    {{-1.0f, 1.0f}, {-1.0f, 1.0f}, {0.0f, 0.0f}, 0.0f},
+    {{-1.0f, -1.0f}, {-1.0f, -1.0f}, {0.0f, 1.0f}, 0.0f},
+    {{1.0f, 1.0f}, {1.0f, 1.0f}, {1.0f, 0.0f}, 0.0f},
+    {{1.0f, -1.0f}, {1.0f, -1.0f}, {1.0f, 1.0f}, 0.0f},
+    // Both eyes side by side. They share the inner edge, so joining them in one strip
+    // only adds degenerate triangles.
+    {{-1.0f, 1.0f}, {-1.0f, 1.0f}, {0.0f, 0.0f}, 0.0f},
+    {{-1.0f, -1.0f}, {-1.0f, -1.0f}, {0.0f, 1.0f}, 0.0f},
+    {{0.0f, 1.0f}, {1.0f, 1.0f}, {0.5f, 0.0f}, 0.0f},
+    {{0.0f, -1.0f}, {1.0f, -1.0f}, {0.5f, 1.0f}, 0.0f},
+    {{0.0f, 1.0f}, {-1.0f, 1.0f}, {0.5f, 0.0f}, 1.0f},
+    {{0.0f, -1.0f}, {-1.0f, -1.0f}, {0.5f, 1.0f}, 1.0f},
+    {{1.0f, 1.0f}, {1.0f, 1.0f}, {1.0f, 0.0f}, 1.0f},
+    {{1.0f, -1.0f}, {1.0f, -1.0f}, {1.0f, 1.0f}, 1.0f},
+};
+
+const VertexRange kLeftEyeRange = {0, 4};
+const VertexRange kRightEyeRange = {4, 4};
+const VertexRange kCopyRange = {8, 4};
+const VertexRange kStereoRange = {12, 8};
+
+// Scale and offset from the [0, 1] range of an eye to its half of the kept texture.
+const GLfloat sEyeUVTransforms[crow::device::EyeCount][4] = {
+    {0.5f, 1.0f, 0.0f, 0.0f},
+    {0.5f, 1.0f, 0.5f, 0.0f}
+};
+
+void
+SetVertexAttribute(const GLint aLocation, const GLint aSize, const size_t aOffset) {
+  if (aLocation < 0) {
+    return;
+  }
+  VRB_GL_CHECK(glVertexAttribPointer((GLuint)aLocation, aSize, GL_FLOAT, GL_FALSE, sizeof(Vertex),
+                                     (const GLvoid*)aOffset));
+  VRB_GL_CHECK(glEnableVertexAttribArray((GLuint)aLocation));
+}
+
+// Gecko rotates each WebXR layer through a few SurfaceTextures. This covers all
+// of them for every layer, handles of resized or re-created canvases age out.
+const size_t kSurfacePoolSize = 24;
+
+// Texture with a framebuffer to copy a SurfaceTexture into.
+struct RenderTarget {
+  GLuint texture = 0;
+  GLuint fbo = 0;
+  int32_t width = 0;
+  int32_t height = 0;
+
+  // aRestoreFBO is bound again once the framebuffer is set up.
+  bool Create(const int32_t aWidth, const int32_t aHeight, const GLuint aRestoreFBO) {
+    if (fbo && width == aWidth && height == aHeight) {
+      return true;
+    }
+    Delete();
+    VRB_GL_CHECK(glGenTextures(1, &texture));
+    VRB_GL_CHECK(glBindTexture(GL_TEXTURE_2D, texture));
+    VRB_GL_CHECK(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, aWidth, aHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr));
+    VRB_GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
+    VRB_GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+    VRB_GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+    VRB_GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+    VRB_GL_CHECK(glBindTexture(GL_TEXTURE_2D, 0));
+
+    VRB_GL_CHECK(glGenFramebuffers(1, &fbo));
+    VRB_GL_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, fbo));
+    VRB_GL_CHECK(glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0));
+    const GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    VRB_GL_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, aRestoreFBO));
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+      VRB_ERROR("ExternalBlitter copy FBO incomplete: 0x%X", status);
+      Delete();
+      return false;
+    }
+    width = aWidth;
+    height = aHeight;
+    return true;
+  }
+
+  void Delete() {
+    if (fbo) {
+      VRB_GL_CHECK(glDeleteFramebuffers(1, &fbo));
+      fbo = 0;
+    }
+    if (texture) {
+      VRB_GL_CHECK(glDeleteTextures(1, &texture));
+      texture = 0;
+    }
+    width = 0;
+    height = 0;
+  }
+};
+
+// Gecko eye rects are normalized and top down, copies are upright.
+void
+SetUVTransform(const crow::device::EyeRect& aRect, const GLfloat* aFallback, GLfloat* aResult) {
+  if (aRect.mWidth <= 0.0f || aRect.mHeight <= 0.0f) {
+    memcpy(aResult, aFallback, 4 * sizeof(GLfloat));
+    return;
+  }
+  aResult[0] = aRect.mWidth;
+  aResult[1] = aRect.mHeight;
+  aResult[2] = aRect.mX;
+  aResult[3] = 1.0f - aRect.mY - aRect.mHeight;
+}
+
+// A stereo layer composited over the main WebXR layer. It is copied when Gecko
+// submits a new frame for it and drawn from the copy until the next one. The copy
+// belongs to the layer slot, so it is reused whichever surface the frame came in.
+struct OverlayLayer {
+  int32_t slot = -1;
+  int32_t surfaceHandle = 0;
+  uint64_t frameId = 0;
+  RenderTarget copy;
+  GLfloat uvTransform[crow::device::EyeCount][4];
 };
 
 }
@@ -56,11 +235,42 @@ struct ExternalBlitter::State : public vrb::ResourceGL::State {
   GLint aPosition;
   GLint aUV;
   GLint uTexture0;
+  GLuint vertexBuffer;
+  GLuint vertexArray;
   device::EyeRect eyes[device::EyeCount];
   GeckoSurfaceTexturePtr surface;
-  GLfloat leftUV[8];
-  GLfloat rightUV[8];
-  std::map<const int32_t, GeckoSurfaceTexturePtr> surfaceMap;
+  // Surfaces attached to the context, most recently used first.
+  typedef std::list<std::pair<int32_t, GeckoSurfaceTexturePtr>> SurfaceList;
+  SurfaceList surfacePool;
+  std::map<int32_t, SurfaceList::iterator> surfaceIndex;
+  uint64_t surfaceHits;
+  uint64_t surfaceMisses;
+  uint64_t surfaceEvictions;
+  GLuint reprojectionVertexShader;
+  GLuint reprojectionFragmentShader;
+  GLuint reprojectionProgram;
+  GLint aReprojectionPosition;
+  GLint aEyePosition;
+  GLint aEye;
+  GLint uReprojection;
+  GLint uReprojectionTexture0;
+  GLint uUVTransform;
+  GLuint reprojectionVertexArray;
+  // GL state of the caller, see SetEnabledCapabilities(), SetBlendFunction() and
+  // SetFramebuffer(). Passed in because querying it stalls the pipeline on some drivers.
+  bool depthTest;
+  bool blend;
+  GLenum blendSource;
+  GLenum blendDestination;
+  GLuint framebuffer;
+  GLint viewport[4];
+  RenderTarget kept;
+  bool hasKeptFrame;
+  bool reprojecting;
+  vrb::Matrix keptHeadTransform;
+  vrb::Matrix reprojection[device::EyeCount];
+  vrb::Matrix noReprojection[device::EyeCount];
+  std::vector<OverlayLayer> overlays;
   State()
       : vertexShader(0)
       , fragmentShader(0)
@@ -68,38 +278,223 @@ struct ExternalBlitter::State : public vrb::ResourceGL::State {
       , aPosition(0)
       , aUV(0)
       , uTexture0(0)
-      , leftUV{0.0f, 0.0f, 0.0f, 1.0f, 0.5f, 0.0f, 0.5f, 1.0f}
-      , rightUV{0.5f, 0.0f, 0.5f, 1.0f, 1.0f, 0.0f, 1.0f, 1.0f}
-  {}
+      , vertexBuffer(0)
+      , vertexArray(0)
+      , surfaceHits(0)
+      , surfaceMisses(0)
+      , surfaceEvictions(0)
+      , reprojectionVertexShader(0)
+      , reprojectionFragmentShader(0)
+      , reprojectionProgram(0)
+      , aReprojectionPosition(0)
+      , aEyePosition(0)
+      , aEye(0)
+      , uReprojection(0)
+      , uReprojectionTexture0(0)
+      , uUVTransform(0)
+      , reprojectionVertexArray(0)
+      , depthTest(false)
+      , blend(false)
+      , blendSource(GL_ONE)
+      , blendDestination(GL_ZERO)
+      , framebuffer(0)
+      , viewport{0, 0, 0, 0}
+      , hasKeptFrame(false)
+      , reprojecting(false)
+      , keptHeadTransform(vrb::Matrix::Identity())
+  {
+    for (vrb::Matrix& matrix: noReprojection) {
+      matrix = vrb::Matrix::Identity();
+    }
+  }
+
+  GeckoSurfaceTexturePtr GetSurface(const int32_t aSurfaceHandle);
+  void ClearSurfaces();
+  void DisableDepthTest();
+  void RestoreDepthTest();
+  void SetBlend(const bool aEnabled);
+  void CopySurface(const GeckoSurfaceTexturePtr& aSurface, RenderTarget& aTarget);
+  void DrawFrame(const VertexRange& aRange);
+  void DrawCopy(const GLuint aTexture, const vrb::Matrix (&aReprojection)[device::EyeCount],
+                const GLfloat (&aUVTransform)[device::EyeCount][4], const VertexRange& aRange);
+  void DrawOverlays(const VertexRange& aRange, const vrb::Matrix (&aReprojection)[device::EyeCount]);
+  void DeleteKeptTarget();
+  void DeleteOverlays();
 };
 
-ExternalBlitterPtr
-ExternalBlitter::Create(vrb::CreationContextPtr& aContext) {
-  return std::make_shared<vrb::ConcreteClass<ExternalBlitter, ExternalBlitter::State> >(aContext);
+GeckoSurfaceTexturePtr
+ExternalBlitter::State::GetSurface(const int32_t aSurfaceHandle) {
+  GeckoSurfaceTexturePtr result;
+  std::map<int32_t, SurfaceList::iterator>::iterator iter = surfaceIndex.find(aSurfaceHandle);
+  if (iter != surfaceIndex.end()) {
+    surfaceHits++;
+    surfacePool.splice(surfacePool.begin(), surfacePool, iter->second);
+    result = iter->second->second;
+  } else {
+    surfaceMisses++;
+    VRB_LOG("Creating GeckoSurfaceTexture for handle: %d", aSurfaceHandle);
+    result = GeckoSurfaceTexture::Create(aSurfaceHandle);
+    // Failed lookups are cached too, so a stale handle is not looked up every frame.
+    surfacePool.emplace_front(aSurfaceHandle, result);
+    surfaceIndex[aSurfaceHandle] = surfacePool.begin();
+    while (surfacePool.size() > kSurfacePoolSize) {
+      // Dropping the last reference releases the surface, detaches it from the context and
+      // deletes its texture. Surfaces drawn this frame are at the front and never evicted.
+      surfaceEvictions++;
+      surfaceIndex.erase(surfacePool.back().first);
+      surfacePool.pop_back();
+    }
+  }
+
+  if (!result) {
+    VRB_ERROR("Failed to find GeckoSurfaceTexture for handle: %d", aSurfaceHandle);
+    return nullptr;
+  }
+
+  EGLContext  ctx = eglGetCurrentContext();
+  if (!result->IsAttachedToGLContext(ctx)) {
+    result->AttachToGLContext(ctx);
+  }
+  return result;
 }
 
 void
-ExternalBlitter::StartFrame(const int32_t aSurfaceHandle, const device::EyeRect& aLeftEye,
-                            const device::EyeRect& aRightEye) {
-  std::map<const int32_t, GeckoSurfaceTexturePtr>::iterator iter = m.surfaceMap.find(aSurfaceHandle);
+ExternalBlitter::State::CopySurface(const GeckoSurfaceTexturePtr& aSurface, RenderTarget& aTarget) {
+  DisableDepthTest();
+  // Copies are exact, blending would apply the alpha of overlays twice.
+  SetBlend(false);
+  VRB_GL_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, aTarget.fbo));
+  VRB_GL_CHECK(glViewport(0, 0, aTarget.width, aTarget.height));
+  VRB_GL_CHECK(glUseProgram(program));
+  VRB_GL_CHECK(glActiveTexture(GL_TEXTURE0));
+  VRB_GL_CHECK(glBindTexture(GL_TEXTURE_EXTERNAL_OES, aSurface->GetTextureName()));
+  VRB_GL_CHECK(glUniform1i(uTexture0, 0));
+  VRB_GL_CHECK(glBindVertexArray(vertexArray));
+  VRB_GL_CHECK(glDrawArrays(GL_TRIANGLE_STRIP, kCopyRange.first, kCopyRange.count));
+  VRB_GL_CHECK(glBindVertexArray(0));
+  VRB_GL_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, framebuffer));
+  if (viewport[2] > 0 && viewport[3] > 0) {
+    VRB_GL_CHECK(glViewport(viewport[0], viewport[1], viewport[2], viewport[3]));
+  }
+  SetBlend(blend);
+  RestoreDepthTest();
+}
 
-  if (iter == m.surfaceMap.end()) {
-    VRB_LOG("Creating GeckoSurfaceTexture for handle: %d", aSurfaceHandle);
-    m.surface = GeckoSurfaceTexture::Create(aSurfaceHandle);
-    m.surfaceMap[aSurfaceHandle] = m.surface;
+void
+ExternalBlitter::State::DisableDepthTest() {
+  if (depthTest) {
+    VRB_GL_CHECK(glDisable(GL_DEPTH_TEST));
+  }
+}
+
+void
+ExternalBlitter::State::RestoreDepthTest() {
+  if (depthTest) {
+    VRB_GL_CHECK(glEnable(GL_DEPTH_TEST));
+  }
+}
+
+void
+ExternalBlitter::State::SetBlend(const bool aEnabled) {
+  if (aEnabled) {
+    VRB_GL_CHECK(glEnable(GL_BLEND));
   } else {
-    m.surface = iter->second;
+    VRB_GL_CHECK(glDisable(GL_BLEND));
   }
+}
 
-  if (!m.surface) {
-    VRB_ERROR("Failed to find GeckoSurfaceTexture for handle: %d", aSurfaceHandle);
+void
+ExternalBlitter::State::DrawFrame(const VertexRange& aRange) {
+  if (reprojecting) {
+    DrawCopy(kept.texture, reprojection, sEyeUVTransforms, aRange);
+    DrawOverlays(aRange, reprojection);
+    return;
+  }
+  if (!program || !surface) {
+    VRB_ERROR("ExternalBlitter::Draw FAILED!");
+    return;
+  }
+  VRB_GL_CHECK(glUseProgram(program));
+  VRB_GL_CHECK(glActiveTexture(GL_TEXTURE0));
+  VRB_GL_CHECK(glBindTexture(GL_TEXTURE_EXTERNAL_OES, surface->GetTextureName()));
+  VRB_GL_CHECK(glUniform1i(uTexture0, 0));
+  VRB_GL_CHECK(glBindVertexArray(vertexArray));
+  VRB_GL_CHECK(glDrawArrays(GL_TRIANGLE_STRIP, aRange.first, aRange.count));
+  VRB_GL_CHECK(glBindVertexArray(0));
+  DrawOverlays(aRange, noReprojection);
+}
+
+void
+ExternalBlitter::State::DrawCopy(const GLuint aTexture, const vrb::Matrix (&aReprojection)[device::EyeCount],
+                                 const GLfloat (&aUVTransform)[device::EyeCount][4], const VertexRange& aRange) {
+  GLfloat matrices[device::EyeCount][16];
+  for (int i = 0; i < device::EyeCount; i++) {
+    memcpy(matrices[i], aReprojection[i].Data(), sizeof(matrices[i]));
+  }
+  VRB_GL_CHECK(glUseProgram(reprojectionProgram));
+  VRB_GL_CHECK(glActiveTexture(GL_TEXTURE0));
+  VRB_GL_CHECK(glBindTexture(GL_TEXTURE_2D, aTexture));
+  VRB_GL_CHECK(glUniform1i(uReprojectionTexture0, 0));
+  VRB_GL_CHECK(glUniformMatrix4fv(uReprojection, device::EyeCount, GL_FALSE, &matrices[0][0]));
+  VRB_GL_CHECK(glUniform4fv(uUVTransform, device::EyeCount, &aUVTransform[0][0]));
+  VRB_GL_CHECK(glBindVertexArray(reprojectionVertexArray));
+  VRB_GL_CHECK(glDrawArrays(GL_TRIANGLE_STRIP, aRange.first, aRange.count));
+  VRB_GL_CHECK(glBindVertexArray(0));
+}
+
+void
+ExternalBlitter::State::DrawOverlays(const VertexRange& aRange, const vrb::Matrix (&aReprojection)[device::EyeCount]) {
+  if (overlays.empty() || !reprojectionProgram) {
     return;
   }
+  // WebGL output is premultiplied.
+  SetBlend(true);
+  VRB_GL_CHECK(glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA));
+  for (const OverlayLayer& overlay: overlays) {
+    if (overlay.copy.texture) {
+      DrawCopy(overlay.copy.texture, aReprojection, overlay.uvTransform, aRange);
+    }
+  }
+  VRB_GL_CHECK(glBlendFunc(blendSource, blendDestination));
+  SetBlend(blend);
+}
 
+void
+ExternalBlitter::State::ClearSurfaces() {
+  if (surfaceHits || surfaceMisses) {
+    VRB_LOG("ExternalBlitter surface pool: hits=%llu misses=%llu evictions=%llu, GeckoSurfaceTexture JNI calls=%llu",
+            (unsigned long long)surfaceHits, (unsigned long long)surfaceMisses,
+            (unsigned long long)surfaceEvictions, (unsigned long long)GeckoSurfaceTexture::GetJNICallCount());
+  }
+  surfaceIndex.clear();
+  surfacePool.clear();
+}
 
-  EGLContext  ctx = eglGetCurrentContext();
-  if (!m.surface->IsAttachedToGLContext(ctx)) {
-    m.surface->AttachToGLContext(ctx);
+void
+ExternalBlitter::State::DeleteKeptTarget() {
+  kept.Delete();
+  hasKeptFrame = false;
+}
+
+void
+ExternalBlitter::State::DeleteOverlays() {
+  for (OverlayLayer& overlay: overlays) {
+    overlay.copy.Delete();
+  }
+  overlays.clear();
+}
+
+ExternalBlitterPtr
+ExternalBlitter::Create(vrb::CreationContextPtr& aContext) {
+  return std::make_shared<vrb::ConcreteClass<ExternalBlitter, ExternalBlitter::State> >(aContext);
+}
+
+void
+ExternalBlitter::StartFrame(const int32_t aSurfaceHandle, const device::EyeRect& aLeftEye,
+                            const device::EyeRect& aRightEye) {
+  m.surface = m.GetSurface(aSurfaceHandle);
+  if (!m.surface) {
+    return;
   }
 
   m.surface->UpdateTexImage();
@@ -107,34 +502,46 @@ ExternalBlitter::StartFrame(const int32_t aSurfaceHandle, const device::EyeRect&
   m.eyes[device::EyeIndex(device::Eye::Right)] = aRightEye;
 }
 
+void
+ExternalBlitter::SetEnabledCapabilities(const bool aDepthTest, const bool aBlend) {
+  m.depthTest = aDepthTest;
+  m.blend = aBlend;
+}
+
+void
+ExternalBlitter::SetBlendFunction(const GLenum aSource, const GLenum aDestination) {
+  m.blendSource = aSource;
+  m.blendDestination = aDestination;
+}
+
+void
+ExternalBlitter::SetFramebuffer(const GLuint aFramebuffer, const GLint aX, const GLint aY, const GLsizei aWidth,
+                                const GLsizei aHeight) {
+  m.framebuffer = aFramebuffer;
+  m.viewport[0] = aX;
+  m.viewport[1] = aY;
+  m.viewport[2] = aWidth;
+  m.viewport[3] = aHeight;
+}
+
 void
 ExternalBlitter::Draw(const device::Eye aEye) {
-  if (!m.program || !m.surface) {
-    VRB_ERROR("ExternalBlitter::Draw FAILED!");
-    return;
-  }
-  const GLboolean enabled = glIsEnabled(GL_DEPTH_TEST);
-  if (enabled) {
-    VRB_GL_CHECK(glDisable(GL_DEPTH_TEST));
-  }
-  VRB_GL_CHECK(glUseProgram(m.program));
-  VRB_GL_CHECK(glActiveTexture(GL_TEXTURE0));
-  VRB_GL_CHECK(glBindTexture(GL_TEXTURE_EXTERNAL_OES, m.surface->GetTextureName()));
-  //m.defaultT->Bind();
-  VRB_GL_CHECK(glUniform1i(m.uTexture0, 0));
-  VRB_GL_CHECK(glVertexAttribPointer((GLuint)m.aPosition, 3, GL_FLOAT, GL_FALSE, 0, sVerticies));
-  VRB_GL_CHECK(glEnableVertexAttribArray((GLuint)m.aPosition));
-  GLfloat* data = (aEye == device::Eye::Left ? &m.leftUV[0] : &m.rightUV[0]);
-  VRB_GL_CHECK(glVertexAttribPointer((GLuint)m.aUV, 2, GL_FLOAT, GL_FALSE, 0, data));
-  VRB_GL_CHECK(glEnableVertexAttribArray((GLuint)m.aUV));
-  VRB_GL_CHECK(glDrawArrays(GL_TRIANGLE_STRIP, 0, 4));
-  if (enabled) {
-    VRB_GL_CHECK(glEnable(GL_DEPTH_TEST));
-  }
+  m.DisableDepthTest();
+  m.DrawFrame(aEye == device::Eye::Left ? kLeftEyeRange : kRightEyeRange);
+  m.RestoreDepthTest();
+}
+
+void
+ExternalBlitter::DrawStereo(const int32_t aWidth, const int32_t aHeight) {
+  VRB_GL_CHECK(glViewport(0, 0, aWidth, aHeight));
+  m.DisableDepthTest();
+  m.DrawFrame(kStereoRange);
+  m.RestoreDepthTest();
 }
 
 void
 ExternalBlitter::EndFrame() {
+  m.reprojecting = false;
   if (m.surface) {
     // We need to detach the SurfaceTexture to prevent the Gecko WebGL compositor from getting blocked.
     m.surface->ReleaseTexImage();
@@ -149,28 +556,108 @@ ExternalBlitter::StopPresenting() {
     m.surface->ReleaseTexImage();
     m.surface = nullptr;
   }
-  m.surfaceMap.clear();
+  m.ClearSurfaces();
+  m.reprojecting = false;
+  // The kept frame is as large as the WebXR framebuffer, do not hold on to it outside of WebXR.
+  m.DeleteKeptTarget();
+  m.DeleteOverlays();
 }
 
 void
 ExternalBlitter::CancelFrame(const int32_t aSurfaceHandle) {
-  GeckoSurfaceTexturePtr surface;
-  auto iter = m.surfaceMap.find(aSurfaceHandle);
-  if (iter != m.surfaceMap.end()) {
-    surface = iter->second;
-  } else {
-    surface = GeckoSurfaceTexture::Create(aSurfaceHandle);
-    m.surfaceMap[aSurfaceHandle] = surface;
+  GeckoSurfaceTexturePtr surface = m.GetSurface(aSurfaceHandle);
+  if (surface) {
+    surface->UpdateAndReleaseTexImage();
   }
+}
 
-  if (surface) {
-    EGLContext ctx = eglGetCurrentContext();
-    if (!surface->IsAttachedToGLContext(ctx)) {
-      surface->AttachToGLContext(ctx);
+void
+ExternalBlitter::SetOverlayLayers(const std::vector<ExternalVR::FrameLayer>& aLayers) {
+  std::vector<OverlayLayer> overlays;
+  overlays.reserve(aLayers.size());
+  for (const ExternalVR::FrameLayer& layer: aLayers) {
+    OverlayLayer overlay;
+    for (OverlayLayer& previous: m.overlays) {
+      if (previous.slot == layer.slot) {
+        overlay = previous;
+        // The copy moves to the new list.
+        previous.copy = RenderTarget();
+        break;
+      }
     }
-    surface->UpdateTexImage();
-    surface->ReleaseTexImage();
+    overlay.slot = layer.slot;
+    if (overlay.frameId != layer.frameId || overlay.surfaceHandle != layer.surfaceHandle || !overlay.copy.texture) {
+      // Only layers Gecko submitted a new frame for are copied, static ones are drawn from the last copy.
+      GeckoSurfaceTexturePtr surface = m.GetSurface(layer.surfaceHandle);
+      if (!surface || !m.program || !overlay.copy.Create(layer.textureWidth, layer.textureHeight, m.framebuffer)) {
+        overlay.copy.Delete();
+        continue;
+      }
+      surface->UpdateTexImage();
+      m.CopySurface(surface, overlay.copy);
+      surface->ReleaseTexImage();
+      overlay.surfaceHandle = layer.surfaceHandle;
+      overlay.frameId = layer.frameId;
+    }
+    SetUVTransform(layer.leftEye, sEyeUVTransforms[device::EyeIndex(device::Eye::Left)],
+                   overlay.uvTransform[device::EyeIndex(device::Eye::Left)]);
+    SetUVTransform(layer.rightEye, sEyeUVTransforms[device::EyeIndex(device::Eye::Right)],
+                   overlay.uvTransform[device::EyeIndex(device::Eye::Right)]);
+    overlays.push_back(overlay);
+  }
+  // Layers Gecko stopped submitting.
+  for (OverlayLayer& previous: m.overlays) {
+    previous.copy.Delete();
+  }
+  m.overlays.swap(overlays);
+}
+
+void
+ExternalBlitter::KeepFrame(const vrb::Matrix& aRenderHeadTransform, const int32_t aWidth, const int32_t aHeight) {
+  m.hasKeptFrame = false;
+  if (!m.program || !m.surface || aWidth <= 0 || aHeight <= 0 || !m.kept.Create(aWidth, aHeight, m.framebuffer)) {
+    return;
+  }
+  m.CopySurface(m.surface, m.kept);
+  m.keptHeadTransform = aRenderHeadTransform;
+  m.hasKeptFrame = true;
+}
+
+void
+ExternalBlitter::ClearKeptFrame() {
+  m.hasKeptFrame = false;
+}
+
+bool
+ExternalBlitter::StartReprojectedFrame(const vrb::Matrix& aHeadTransform, const vrb::Matrix& aLeftProjection,
+                                       const vrb::Matrix& aRightProjection) {
+  if (!m.hasKeptFrame || !m.reprojectionProgram) {
+    return false;
   }
+  m.reprojection[device::EyeIndex(device::Eye::Left)] =
+      GetReprojectionMatrix(aLeftProjection, m.keptHeadTransform, aHeadTransform);
+  m.reprojection[device::EyeIndex(device::Eye::Right)] =
+      GetReprojectionMatrix(aRightProjection, m.keptHeadTransform, aHeadTransform);
+  m.reprojecting = true;
+  return true;
+}
+
+vrb::Matrix
+ExternalBlitter::GetReprojectionMatrix(const vrb::Matrix& aProjection, const vrb::Matrix& aRenderHeadTransform,
+                                       const vrb::Matrix& aHeadTransform) {
+  // Eye offsets are translations, so both eyes share the head rotation.
+  const vrb::Matrix renderRotation = vrb::Matrix::Rotation(vrb::Quaternion(aRenderHeadTransform));
+  const vrb::Matrix rotation = vrb::Matrix::Rotation(vrb::Quaternion(aHeadTransform));
+  return aProjection.PostMultiply(renderRotation.AfineInverse())
+                    .PostMultiply(rotation)
+                    .PostMultiply(aProjection.Inverse());
+}
+
+void
+ExternalBlitter::GetSurfacePoolStats(uint64_t& aHits, uint64_t& aMisses, uint64_t& aEvictions) const {
+  aHits = m.surfaceHits;
+  aMisses = m.surfaceMisses;
+  aEvictions = m.surfaceEvictions;
 }
 
 ExternalBlitter::ExternalBlitter(State& aState, vrb::CreationContextPtr& aContext)
@@ -190,6 +677,40 @@ ExternalBlitter::InitializeGL() {
     m.aUV = vrb::GetAttributeLocation(m.program, "a_uv");
     m.uTexture0 = vrb::GetUniformLocation(m.program, "u_texture0");
   }
+  m.reprojectionVertexShader = vrb::LoadShader(GL_VERTEX_SHADER, sReprojectionVertexShader);
+  m.reprojectionFragmentShader = vrb::LoadShader(GL_FRAGMENT_SHADER, sReprojectionFragmentShader);
+  if (m.reprojectionVertexShader && m.reprojectionFragmentShader) {
+    m.reprojectionProgram = vrb::CreateProgram(m.reprojectionVertexShader, m.reprojectionFragmentShader);
+  }
+  if (m.reprojectionProgram) {
+    m.aReprojectionPosition = vrb::GetAttributeLocation(m.reprojectionProgram, "a_position");
+    m.aEyePosition = vrb::GetAttributeLocation(m.reprojectionProgram, "a_eyePosition");
+    m.aEye = vrb::GetAttributeLocation(m.reprojectionProgram, "a_eye");
+    m.uReprojection = vrb::GetUniformLocation(m.reprojectionProgram, "u_reprojection");
+    m.uReprojectionTexture0 = vrb::GetUniformLocation(m.reprojectionProgram, "u_texture0");
+    m.uUVTransform = vrb::GetUniformLocation(m.reprojectionProgram, "u_uvTransform");
+  }
+
+  // Quads are drawn from a static buffer through one vertex array per program, so no
+  // client side arrays are set up per draw.
+  VRB_GL_CHECK(glGenBuffers(1, &m.vertexBuffer));
+  VRB_GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, m.vertexBuffer));
+  VRB_GL_CHECK(glBufferData(GL_ARRAY_BUFFER, sizeof(sVertices), sVertices, GL_STATIC_DRAW));
+  if (m.program) {
+    VRB_GL_CHECK(glGenVertexArrays(1, &m.vertexArray));
+    VRB_GL_CHECK(glBindVertexArray(m.vertexArray));
+    SetVertexAttribute(m.aPosition, 2, offsetof(Vertex, position));
+    SetVertexAttribute(m.aUV, 2, offsetof(Vertex, uv));
+  }
+  if (m.reprojectionProgram) {
+    VRB_GL_CHECK(glGenVertexArrays(1, &m.reprojectionVertexArray));
+    VRB_GL_CHECK(glBindVertexArray(m.reprojectionVertexArray));
+    SetVertexAttribute(m.aReprojectionPosition, 2, offsetof(Vertex, position));
+    SetVertexAttribute(m.aEyePosition, 2, offsetof(Vertex, eyePosition));
+    SetVertexAttribute(m.aEye, 1, offsetof(Vertex, eye));
+  }
+  VRB_GL_CHECK(glBindVertexArray(0));
+  VRB_GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, 0));
 }
 
 void
@@ -206,6 +727,32 @@ ExternalBlitter::ShutdownGL() {
     VRB_GL_CHECK(glDeleteShader(m.fragmentShader));
     m.fragmentShader = 0;
   }
+  if (m.reprojectionProgram) {
+    VRB_GL_CHECK(glDeleteProgram(m.reprojectionProgram));
+    m.reprojectionProgram = 0;
+  }
+  if (m.reprojectionVertexShader) {
+    VRB_GL_CHECK(glDeleteShader(m.reprojectionVertexShader));
+    m.reprojectionVertexShader = 0;
+  }
+  if (m.reprojectionFragmentShader) {
+    VRB_GL_CHECK(glDeleteShader(m.reprojectionFragmentShader));
+    m.reprojectionFragmentShader = 0;
+  }
+  if (m.vertexArray) {
+    VRB_GL_CHECK(glDeleteVertexArrays(1, &m.vertexArray));
+    m.vertexArray = 0;
+  }
+  if (m.reprojectionVertexArray) {
+    VRB_GL_CHECK(glDeleteVertexArrays(1, &m.reprojectionVertexArray));
+    m.reprojectionVertexArray = 0;
+  }
+  if (m.vertexBuffer) {
+    VRB_GL_CHECK(glDeleteBuffers(1, &m.vertexBuffer));
+    m.vertexBuffer = 0;
+  }
+  m.DeleteKeptTarget();
+  m.DeleteOverlays();
 }
 
 } // namespace crow
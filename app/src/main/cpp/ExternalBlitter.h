@@ -9,9 +9,11 @@
 #include "vrb/MacroUtils.h"
 #include "vrb/Forward.h"
 #include "vrb/ResourceGL.h"
+#include "vrb/gl.h"
 #include "Device.h"
 #include "ExternalVR.h"
 #include <memory>
+#include <vector>
 
 namespace crow {
 
@@ -22,10 +24,40 @@ class ExternalBlitter : protected vrb::ResourceGL {
 public:
   static ExternalBlitterPtr Create(vrb::CreationContextPtr& aContext);
   void StartFrame(const int32_t aSurfaceHandle, const device::EyeRect& aLeftEye, const device::EyeRect& aRightEye);
+  // Whether the caller keeps GL_DEPTH_TEST and GL_BLEND enabled around Draw() and
+  // DrawStereo(). The blitter turns them off where it needs to and restores them from
+  // these flags, glIsEnabled() stalls the pipeline on some drivers. Both default to off.
+  void SetEnabledCapabilities(const bool aDepthTest, const bool aBlend);
+  // The caller's glBlendFunc(), restored after overlays are blended. GL_ONE, GL_ZERO by default.
+  void SetBlendFunction(const GLenum aSource, const GLenum aDestination);
+  // Framebuffer and viewport bound again after SetOverlayLayers() or KeepFrame() copy a
+  // surface. Framebuffer 0 by default, an empty viewport is left as the copy set it.
+  void SetFramebuffer(const GLuint aFramebuffer, const GLint aX, const GLint aY, const GLsizei aWidth,
+                      const GLsizei aHeight);
   void Draw(const device::Eye aEye);
+  // Draws both eyes side by side into the bound framebuffer of aWidth x aHeight with one
+  // draw call per layer.
+  void DrawStereo(const int32_t aWidth, const int32_t aHeight);
   void EndFrame();
   void StopPresenting();
   void CancelFrame(const int32_t aSurfaceHandle);
+  // Surface lookups served from the pool of attached surfaces, lookups that created a
+  // surface, and least recently used surfaces released to stay within the pool size.
+  void GetSurfacePoolStats(uint64_t& aHits, uint64_t& aMisses, uint64_t& aEvictions) const;
+  // Layers drawn over the main one. Each is copied when its frame ID changes and kept
+  // until it is no longer submitted, so slow layers such as a HUD cost nothing between updates.
+  void SetOverlayLayers(const std::vector<ExternalVR::FrameLayer>& aLayers);
+  // Copies the frame started with StartFrame() so it can be reprojected if the next one is late.
+  void KeepFrame(const vrb::Matrix& aRenderHeadTransform, const int32_t aWidth, const int32_t aHeight);
+  void ClearKeptFrame();
+  // Draws the kept frame rotated to aHeadTransform instead of a new frame. Returns false if
+  // there is no kept frame.
+  bool StartReprojectedFrame(const vrb::Matrix& aHeadTransform, const vrb::Matrix& aLeftProjection,
+                             const vrb::Matrix& aRightProjection);
+  // Maps clip space positions of a view at aHeadTransform to the clip space of a frame
+  // rendered at aRenderHeadTransform. Only the rotation of the head poses is used.
+  static vrb::Matrix GetReprojectionMatrix(const vrb::Matrix& aProjection, const vrb::Matrix& aRenderHeadTransform,
+                                           const vrb::Matrix& aHeadTransform);
 protected:
   struct State;
   ExternalBlitter(State& aState, vrb::CreationContextPtr& aContext);
@@ -4,20 +4,117 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 
 #include "ExternalVR.h"
+#include "PosePredictor.h"
+#include "PoseRing.h"
 #include "VRBrowser.h"
 
 #include "vrb/Matrix.h"
 #include "vrb/Quaternion.h"
 #include "vrb/Vector.h"
 #include "moz_external_vr.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <cstddef>
+#include <iterator>
 #include <pthread.h>
+#include <sched.h>
+#include <time.h>
 #include <unistd.h>
 
 namespace {
 
 const float SecondsToNanoseconds = 1e9f;
 const int SecondsToNanosecondsI32 = int(1e9);
-const int MicrosecondsToNanoseconds = 1000;
+// Poses in flight with two frames ahead prediction, plus one of slack.
+const size_t kFramePoseCount = 4;
+// PosePredictor device of the head, controller i is kHeadPoseDevice + 1 + i.
+const uint32_t kHeadPoseDevice = 0;
+// sharedDirtyControllers with every controller entry set.
+const uint32_t kAllControllers = (1u << mozilla::gfx::kVRControllerMaxCount) - 1;
+// Recent frame arrival times used to size the WaitFrameResult spin window.
+const size_t kFrameArrivalCount = 32;
+// Longest spin before WaitFrameResult blocks on the condition variable, in seconds.
+const float kFrameWaitMaxSpin = 0.001f;
+// Upper bounds of the frame wait histogram buckets, in milliseconds. The last bucket is open ended.
+const float kFrameWaitBucketLimits[] = {0.05f, 0.1f, 0.25f, 0.5f, 1.0f, 2.0f, 4.0f, 8.0f, 16.0f, 33.0f, 100.0f};
+const size_t kFrameWaitBucketCount = sizeof(kFrameWaitBucketLimits) / sizeof(kFrameWaitBucketLimits[0]) + 1;
+// Largest change of a published velocity (m/s, rad/s) and acceleration (m/s^2, rad/s^2)
+// that does not republish a controller pose. The smoothed rates of a resting controller
+// keep decaying towards zero and would otherwise dirty the pose every frame.
+const float kVelocityTolerance = 1e-3f;
+const float kAccelerationTolerance = 1e-2f;
+
+// Frame timing of the current WebXR session, logged when it ends.
+struct SessionTelemetry {
+  uint64_t framesPresented = 0;
+  uint64_t framesReprojected = 0;
+  uint64_t framesDiscarded = 0;
+  uint64_t waitTimeouts = 0;
+  // WaitFrameResult durations in seconds, including waits that timed out.
+  double meanWait = 0.0;
+  double maxWait = 0.0;
+  // Frames ended at each DeviceDelegate::FramePrediction depth, indexed by its value.
+  uint64_t framesAtPrediction[3] = {};
+};
+
+double
+MonotonicSeconds() {
+  struct timespec ts = {};
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec / (double)SecondsToNanosecondsI32;
+}
+
+// Condition variables that we wait on use CLOCK_MONOTONIC deadlines so wall clock changes can't stall them.
+void
+InitMonotonicCond(pthread_cond_t* aCond) {
+  pthread_condattr_t attributes;
+  pthread_condattr_init(&attributes);
+  pthread_condattr_setclock(&attributes, CLOCK_MONOTONIC);
+  pthread_cond_init(aCond, &attributes);
+  pthread_condattr_destroy(&attributes);
+}
+
+bool
+SameMatrix(const vrb::Matrix& aFirst, const vrb::Matrix& aSecond) {
+  return memcmp(aFirst.Data(), aSecond.Data(), 16 * sizeof(float)) == 0;
+}
+
+bool
+CloseVector(const vrb::Vector& aFirst, const vrb::Vector& aSecond, const float aTolerance) {
+  return fabsf(aFirst.x() - aSecond.x()) <= aTolerance && fabsf(aFirst.y() - aSecond.y()) <= aTolerance &&
+         fabsf(aFirst.z() - aSecond.z()) <= aTolerance;
+}
+
+bool
+CloseMotion(const crow::PosePredictor::Motion& aFirst, const crow::PosePredictor::Motion& aSecond) {
+  return CloseVector(aFirst.linearVelocity, aSecond.linearVelocity, kVelocityTolerance) &&
+         CloseVector(aFirst.linearAcceleration, aSecond.linearAcceleration, kAccelerationTolerance) &&
+         CloseVector(aFirst.angularVelocity, aSecond.angularVelocity, kVelocityTolerance) &&
+         CloseVector(aFirst.angularAcceleration, aSecond.angularAcceleration, kAccelerationTolerance);
+}
+
+void
+CopyVector(float* aOut, const vrb::Vector& aVector) {
+  aOut[0] = aVector.x();
+  aOut[1] = aVector.y();
+  aOut[2] = aVector.z();
+}
+
+vrb::Vector
+Cross(const vrb::Vector& a, const vrb::Vector& b) {
+  return vrb::Vector(a.y() * b.z() - a.z() * b.y(), a.z() * b.x() - a.x() * b.z(), a.x() * b.y() - a.y() * b.x());
+}
+
+// Fills the rates of a VRPose from the predicted motion of its device.
+void
+CopyMotion(mozilla::gfx::VRPose& aPose, const crow::PosePredictor::Motion& aMotion) {
+  CopyVector(aPose.linearVelocity, aMotion.linearVelocity);
+  CopyVector(aPose.linearAcceleration, aMotion.linearAcceleration);
+  CopyVector(aPose.angularVelocity, aMotion.angularVelocity);
+  CopyVector(aPose.angularAcceleration, aMotion.angularAcceleration);
+}
 
 class Lock {
   pthread_mutex_t* mMutex;
@@ -69,13 +166,13 @@ public:
       if (aWait == 0.0f) {
         return pthread_cond_wait(mCond, mMutex) == 0;
       } else {
+        // mCond must have been created with InitMonotonicCond.
         float sec = 0;
         float nsec = modff(aWait, &sec);
-        struct timeval tv = {};
         struct timespec ts = {};
-        gettimeofday(&tv, nullptr);
-        ts.tv_sec = tv.tv_sec + int(sec);
-        ts.tv_nsec = (tv.tv_usec * MicrosecondsToNanoseconds) + int(SecondsToNanoseconds * nsec);
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        ts.tv_sec += int(sec);
+        ts.tv_nsec += int(SecondsToNanoseconds * nsec);
         if (ts.tv_nsec >= SecondsToNanosecondsI32) {
           ts.tv_nsec -= SecondsToNanosecondsI32;
           ts.tv_sec++;
@@ -115,14 +212,88 @@ private:
 
 namespace crow {
 
+mozilla::gfx::VRControllerType GetVRControllerTypeByDevice(device::DeviceType aType);
+
 struct ExternalVR::State {
+  enum ControllerDirty {
+    DirtyIdentity = 1 << 0,
+    DirtyPose = 1 << 1,
+    DirtyButtons = 1 << 2,
+    DirtyAxes = 1 << 3,
+    DirtyHaptics = 1 << 4,
+    DirtyAll = DirtyIdentity | DirtyPose | DirtyButtons | DirtyAxes | DirtyHaptics
+  };
+
+  // Controller inputs the published entry was last built from.
+  struct ControllerCache {
+    bool active = false;
+    std::string name;
+    device::DeviceType type = device::UnknownType;
+    device::TargetRayMode targetRayMode = device::TargetRayMode::TrackedPointer;
+    bool leftHanded = false;
+    uint16_t flags = 0;
+    vrb::Matrix transform;
+    vrb::Matrix beamTransform;
+    PosePredictor::Motion motion;
+    uint32_t numButtons = 0;
+    uint64_t pressed = 0;
+    uint64_t touched = 0;
+    float triggers[kControllerMaxButtonCount] = {};
+    uint64_t selectActionStartFrameId = 0;
+    uint64_t selectActionStopFrameId = 0;
+    uint64_t squeezeActionStartFrameId = 0;
+    uint64_t squeezeActionStopFrameId = 0;
+    uint32_t numAxes = 0;
+    float axes[kControllerMaxAxes] = {};
+    uint32_t numHaptics = 0;
+  };
+
+  struct FramePose {
+    vrb::Matrix headTransform;
+    double timestamp = 0.0;
+  };
+
   static ExternalVR::State* sState;
   pthread_mutex_t* browserMutex = nullptr;
   pthread_cond_t* browserCond = nullptr;
   mozilla::gfx::VRBrowserState* sourceBrowserState = nullptr;
   mozilla::gfx::VRExternalShmem data = {};
+#if !defined(__ANDROID__)
+  // Only the Android shmem layout has room for the locks, host builds share no
+  // memory with Gecko and keep them here instead.
+  pthread_mutex_t hostMutexes[3];
+  pthread_cond_t hostConds[3];
+#endif
+  pthread_mutex_t* systemMutex = nullptr;
+  pthread_mutex_t* geckoMutex = nullptr;
+  pthread_mutex_t* servoMutex = nullptr;
+  pthread_cond_t* systemCond = nullptr;
+  pthread_cond_t* geckoCond = nullptr;
+  pthread_cond_t* servoCond = nullptr;
   mozilla::gfx::VRSystemState system = {};
   mozilla::gfx::VRBrowserState browser = {};
+  ControllerCache controllers[mozilla::gfx::kVRControllerMaxCount];
+  // Controller entries changed since the last copy into the shared memory.
+  uint32_t sharedDirtyControllers = 0;
+  uint64_t controllerBytesWritten = 0;
+  uint64_t systemBytesPublished = 0;
+  // browser.hapticState entry for each controller, -1 if it has no active pulse.
+  int32_t controllerHaptics[mozilla::gfx::kVRControllerMaxCount];
+  PoseRing<FramePose, kFramePoseCount> framePoses;
+  PosePredictorPtr posePredictor;
+  float posePredictionFrames = 0.0f;
+  float frameWaitTimeout = 0.1f;
+  float frameArrivals[kFrameArrivalCount] = {};
+  size_t frameArrivalCount = 0;
+  size_t frameArrivalIndex = 0;
+  float frameWaitSpinWindow = 0.0f;
+  uint32_t frameWaitHistogram[kFrameWaitBucketCount] = {};
+  uint32_t frameWaitSpinHits = 0;
+  uint32_t frameWaitBlocks = 0;
+  uint32_t frameWaitTimeouts = 0;
+  SessionTelemetry telemetry;
+  double telemetryWaitSum = 0.0;
+  uint64_t telemetryWaits = 0;
   // device::CapabilityFlags deviceCapabilities = 0;
   vrb::Vector eyeOffsets[device::EyeCount];
   uint64_t lastFrameId = 0;
@@ -131,31 +302,54 @@ struct ExternalVR::State {
   bool waitingForExit = false;
 
   State() {
-    pthread_mutex_init(&data.systemMutex, nullptr);
-    pthread_mutex_init(&data.geckoMutex, nullptr);
-    pthread_mutex_init(&data.servoMutex, nullptr);
-    pthread_cond_init(&data.systemCond, nullptr);
-    pthread_cond_init(&data.geckoCond, nullptr);
-    pthread_cond_init(&data.servoCond, nullptr);
+#if defined(__ANDROID__)
+    systemMutex = &data.systemMutex;
+    geckoMutex = &data.geckoMutex;
+    servoMutex = &data.servoMutex;
+    systemCond = &data.systemCond;
+    geckoCond = &data.geckoCond;
+    servoCond = &data.servoCond;
+#else
+    systemMutex = &hostMutexes[0];
+    geckoMutex = &hostMutexes[1];
+    servoMutex = &hostMutexes[2];
+    systemCond = &hostConds[0];
+    geckoCond = &hostConds[1];
+    servoCond = &hostConds[2];
+#endif
+    pthread_mutex_init(systemMutex, nullptr);
+    pthread_mutex_init(geckoMutex, nullptr);
+    pthread_mutex_init(servoMutex, nullptr);
+    InitConditions();
+    posePredictor = PosePredictor::Create();
+  }
+
+  // Gecko waits on systemCond with its own deadlines, only the browser conditions we wait on are monotonic.
+  void InitConditions() {
+    pthread_cond_init(systemCond, nullptr);
+    InitMonotonicCond(geckoCond);
+    InitMonotonicCond(servoCond);
   }
 
   ~State() {
-    pthread_mutex_destroy(&(data.systemMutex));
-    pthread_mutex_destroy(&(data.geckoMutex));
-    pthread_mutex_destroy(&(data.servoMutex));
-    pthread_cond_destroy(&(data.systemCond));
-    pthread_cond_destroy(&(data.geckoCond));
-    pthread_cond_destroy(&(data.servoCond));
+    pthread_mutex_destroy(systemMutex);
+    pthread_mutex_destroy(geckoMutex);
+    pthread_mutex_destroy(servoMutex);
+    pthread_cond_destroy(systemCond);
+    pthread_cond_destroy(geckoCond);
+    pthread_cond_destroy(servoCond);
   }
 
   void Reset() {
     memset(&data, 0, sizeof(mozilla::gfx::VRExternalShmem));
+    InitConditions();
     memset(&system, 0, sizeof(mozilla::gfx::VRSystemState));
     memset(&browser, 0, sizeof(mozilla::gfx::VRBrowserState));
     data.version = mozilla::gfx::kVRExternalVersion;
     data.size = sizeof(mozilla::gfx::VRExternalShmem);
     system.displayState.isConnected = true;
     system.displayState.isMounted = true;
+    system.displayState.reportsDroppedFrames = true;
     const vrb::Matrix identity = vrb::Matrix::Identity();
     memcpy(&(system.sensorState.leftViewMatrix), identity.Data(), sizeof(system.sensorState.leftViewMatrix));
     memcpy(&(system.sensorState.rightViewMatrix), identity.Data(), sizeof(system.sensorState.rightViewMatrix));
@@ -163,6 +357,16 @@ struct ExternalVR::State {
     lastFrameId = 0;
     firstPresentingFrame = false;
     waitingForExit = false;
+    for (ControllerCache& controller: controllers) {
+      controller.active = false;
+    }
+    // The first copy after a reset rewrites every entry of the shared memory.
+    sharedDirtyControllers = kAllControllers;
+    controllerBytesWritten = 0;
+    systemBytesPublished = 0;
+    IndexHaptics();
+    framePoses.Clear();
+    posePredictor->Reset();
     SetSourceBrowser(VRBrowserType::Gecko);
   }
 
@@ -177,29 +381,312 @@ struct ExternalVR::State {
   void PullBrowserStateWhileLocked() {
     const bool wasPresenting = IsPresenting();
     memcpy(&browser, sourceBrowserState, sizeof(mozilla::gfx::VRBrowserState));
-
+    IndexHaptics();
 
     if ((!wasPresenting && IsPresenting()) || browser.navigationTransitionActive) {
       firstPresentingFrame = true;
     }
+    if (!wasPresenting && IsPresenting()) {
+      ResetTelemetry();
+    }
     if (wasPresenting && !IsPresenting()) {
       lastFrameId = browser.layerState[0].layer_stereo_immersive.frameId;
       waitingForExit = false;
+      LogTelemetry();
+    }
+  }
+
+  // The first active entry wins when Gecko lists several for a controller.
+  void IndexHaptics() {
+    for (int32_t& index: controllerHaptics) {
+      index = -1;
+    }
+    for (int32_t i = 0; i < mozilla::gfx::kVRHapticsMaxCount; ++i) {
+      const mozilla::gfx::VRHapticState& haptic = browser.hapticState[i];
+      if (haptic.inputFrameID && haptic.controllerIndex < mozilla::gfx::kVRControllerMaxCount &&
+          controllerHaptics[haptic.controllerIndex] < 0) {
+        controllerHaptics[haptic.controllerIndex] = i;
+      }
+    }
+  }
+
+  void ResetTelemetry() {
+    telemetry = SessionTelemetry();
+    telemetryWaitSum = 0.0;
+    telemetryWaits = 0;
+    system.displayState.droppedFrameCount = 0;
+    ResetFrameWaitStats();
+  }
+
+  void ResetFrameWaitStats() {
+    memset(frameWaitHistogram, 0, sizeof(frameWaitHistogram));
+    frameWaitSpinHits = 0;
+    frameWaitBlocks = 0;
+    frameWaitTimeouts = 0;
+  }
+
+  void LogTelemetry() const {
+    VRB_LOG("WebXR session telemetry: presented=%llu reprojected=%llu discarded=%llu timeouts=%llu "
+            "wait mean=%.2fms max=%.2fms prediction frames no/one/two=%llu/%llu/%llu",
+            (unsigned long long)telemetry.framesPresented, (unsigned long long)telemetry.framesReprojected,
+            (unsigned long long)telemetry.framesDiscarded, (unsigned long long)telemetry.waitTimeouts,
+            telemetry.meanWait * 1000.0, telemetry.maxWait * 1000.0,
+            (unsigned long long)telemetry.framesAtPrediction[0], (unsigned long long)telemetry.framesAtPrediction[1],
+            (unsigned long long)telemetry.framesAtPrediction[2]);
+    // Frame waits per bucket, labelled with the bucket's upper limit in milliseconds.
+    char histogram[256] = {};
+    size_t length = 0;
+    for (size_t i = 0; i < kFrameWaitBucketCount && length < sizeof(histogram); i++) {
+      const int written = i + 1 < kFrameWaitBucketCount ?
+          snprintf(histogram + length, sizeof(histogram) - length, " <%g:%u", kFrameWaitBucketLimits[i], frameWaitHistogram[i]) :
+          snprintf(histogram + length, sizeof(histogram) - length, " more:%u", frameWaitHistogram[i]);
+      if (written < 0) {
+        break;
+      }
+      length += (size_t)written;
     }
+    VRB_LOG("WebXR session frame waits: spin hits=%u blocks=%u timeouts=%u spin window=%.3fms histogram(ms)%s",
+            frameWaitSpinHits, frameWaitBlocks, frameWaitTimeouts, frameWaitSpinWindow * 1000.0f, histogram);
   }
 
   bool IsPresenting() const {
     return browser.presentationActive || browser.navigationTransitionActive || browser.layerState[0].type == mozilla::gfx::VRLayerType::LayerType_Stereo_Immersive;
   }
 
+  void CopySystemStateWhileLocked() {
+    // Controller entries are last in VRSystemState, only copy the ones that changed.
+    const size_t header = offsetof(mozilla::gfx::VRSystemState, controllerState);
+    memcpy(&(data.state), &system, header);
+    systemBytesPublished += header;
+    for (int i = 0; i < mozilla::gfx::kVRControllerMaxCount; ++i) {
+      if (sharedDirtyControllers & (1u << i)) {
+        memcpy(&(data.state.controllerState[i]), &(system.controllerState[i]), sizeof(mozilla::gfx::VRControllerState));
+        systemBytesPublished += sizeof(mozilla::gfx::VRControllerState);
+      }
+    }
+    sharedDirtyControllers = 0;
+    pthread_cond_signal(systemCond);
+  }
+
+  // Adds aTransform to the pose history of aDevice, then replaces it with the pose
+  // extrapolated by posePredictionFrames head sample intervals.
+  void PredictPose(const uint32_t aDevice, const double aTimestamp, vrb::Matrix& aTransform, PosePredictor::Motion& aMotion) {
+    posePredictor->AddSample(aDevice, aTimestamp, aTransform);
+    const double target = aTimestamp + posePredictionFrames * posePredictor->GetSampleInterval(kHeadPoseDevice);
+    vrb::Matrix predicted;
+    if (posePredictor->Predict(aDevice, target, predicted, aMotion) && posePredictionFrames > 0.0f) {
+      aTransform = predicted;
+    }
+  }
+
+  void MarkControllerChanged(const int aIndex) {
+    sharedDirtyControllers |= 1u << aIndex;
+  }
+
+  void ClearController(const int aIndex) {
+    if (!controllers[aIndex].active) {
+      return;
+    }
+    controllers[aIndex].active = false;
+    memset(&(system.controllerState[aIndex]), 0, sizeof(mozilla::gfx::VRControllerState));
+    controllerBytesWritten += sizeof(mozilla::gfx::VRControllerState);
+    MarkControllerChanged(aIndex);
+  }
+
+  uint32_t UpdateControllerCache(ControllerCache& aCache, const Controller& aController, const uint16_t aFlags,
+                                 const vrb::Matrix& aTransform, const PosePredictor::Motion& aMotion) {
+    uint32_t dirty = 0;
+    if (!aCache.active || aCache.name != aController.immersiveName || aCache.type != aController.type ||
+        aCache.targetRayMode != aController.targetRayMode || aCache.leftHanded != aController.leftHanded ||
+        aCache.flags != aFlags || aCache.numButtons != aController.numButtons || aCache.numAxes != aController.numAxes) {
+      dirty = DirtyAll;
+      aCache.active = true;
+      aCache.name = aController.immersiveName;
+      aCache.type = aController.type;
+      aCache.targetRayMode = aController.targetRayMode;
+      aCache.leftHanded = aController.leftHanded;
+      aCache.flags = aFlags;
+      aCache.numButtons = aController.numButtons;
+      aCache.numAxes = aController.numAxes;
+    }
+    if (!SameMatrix(aCache.transform, aTransform) ||
+        !SameMatrix(aCache.beamTransform, aController.immersiveBeamTransform) || !CloseMotion(aCache.motion, aMotion)) {
+      dirty |= DirtyPose;
+      aCache.transform = aTransform;
+      aCache.beamTransform = aController.immersiveBeamTransform;
+      aCache.motion = aMotion;
+    }
+    const size_t triggers = std::min<size_t>(aController.numButtons, kControllerMaxButtonCount) * sizeof(float);
+    if (aCache.pressed != aController.immersivePressedState || aCache.touched != aController.immersiveTouchedState ||
+        memcmp(aCache.triggers, aController.immersiveTriggerValues, triggers) != 0 ||
+        aCache.selectActionStartFrameId != aController.selectActionStartFrameId ||
+        aCache.selectActionStopFrameId != aController.selectActionStopFrameId ||
+        aCache.squeezeActionStartFrameId != aController.squeezeActionStartFrameId ||
+        aCache.squeezeActionStopFrameId != aController.squeezeActionStopFrameId) {
+      dirty |= DirtyButtons;
+      aCache.pressed = aController.immersivePressedState;
+      aCache.touched = aController.immersiveTouchedState;
+      memcpy(aCache.triggers, aController.immersiveTriggerValues, triggers);
+      aCache.selectActionStartFrameId = aController.selectActionStartFrameId;
+      aCache.selectActionStopFrameId = aController.selectActionStopFrameId;
+      aCache.squeezeActionStartFrameId = aController.squeezeActionStartFrameId;
+      aCache.squeezeActionStopFrameId = aController.squeezeActionStopFrameId;
+    }
+    const size_t axes = std::min<size_t>(aController.numAxes, kControllerMaxAxes) * sizeof(float);
+    if (memcmp(aCache.axes, aController.immersiveAxes, axes) != 0) {
+      dirty |= DirtyAxes;
+      memcpy(aCache.axes, aController.immersiveAxes, axes);
+    }
+    if (aCache.numHaptics != aController.numHaptics) {
+      dirty |= DirtyHaptics;
+      aCache.numHaptics = aController.numHaptics;
+    }
+    return dirty;
+  }
+
+  // Rewrites the parts of a controller entry whose inputs changed since the last push.
+  // aTransform and aMotion are the predicted grip pose and its rates.
+  void UpdateController(const int aIndex, const Controller& aController, const uint16_t aFlags,
+                        const vrb::Matrix& aTransform, const PosePredictor::Motion& aMotion) {
+    const uint32_t dirty = UpdateControllerCache(controllers[aIndex], aController, aFlags, aTransform, aMotion);
+    if (!dirty) {
+      return;
+    }
+    mozilla::gfx::VRControllerState& immersiveController = system.controllerState[aIndex];
+    size_t bytes = 0;
+    if (dirty & DirtyIdentity) {
+      memset(&immersiveController, 0, sizeof(mozilla::gfx::VRControllerState));
+      bytes += sizeof(mozilla::gfx::VRControllerState);
+      const size_t nameLength = std::min<size_t>(aController.immersiveName.size(), mozilla::gfx::kVRControllerNameMaxLen - 1);
+      memcpy(immersiveController.controllerName, aController.immersiveName.c_str(), nameLength);
+      immersiveController.numButtons = aController.numButtons;
+      immersiveController.numAxes = aController.numAxes;
+      immersiveController.hand = aController.leftHanded ? mozilla::gfx::ControllerHand::Left : mozilla::gfx::ControllerHand::Right;
+      immersiveController.type = GetVRControllerTypeByDevice(aController.type);
+      immersiveController.flags = static_cast<mozilla::gfx::ControllerCapabilityFlags>(aFlags);
+      // TODO:: We should add TargetRayMode::_end in moz_external_vr.h to help this check.
+      assert((uint8_t)mozilla::gfx::TargetRayMode::Screen == (uint8_t)device::TargetRayMode::Screen);
+      immersiveController.targetRayMode = (mozilla::gfx::TargetRayMode)aController.targetRayMode;
+      immersiveController.mappingType = mozilla::gfx::GamepadMappingType::XRStandard;
+    }
+    if (dirty & DirtyPose) {
+      WriteControllerPose(immersiveController, aController, aFlags, aTransform, aMotion);
+      if (!(dirty & DirtyIdentity)) {
+        bytes += sizeof(immersiveController.pose) + sizeof(immersiveController.targetRayPose) + 2 * sizeof(bool);
+      }
+    }
+    if (dirty & DirtyButtons) {
+      immersiveController.buttonPressed = aController.immersivePressedState;
+      immersiveController.buttonTouched = aController.immersiveTouchedState;
+      const uint32_t count = std::min<uint32_t>(aController.numButtons, kControllerMaxButtonCount);
+      for (uint32_t j = 0; j < count; ++j) {
+        immersiveController.triggerValue[j] = aController.immersiveTriggerValues[j];
+      }
+      immersiveController.selectActionStartFrameId = aController.selectActionStartFrameId;
+      immersiveController.selectActionStopFrameId = aController.selectActionStopFrameId;
+      immersiveController.squeezeActionStartFrameId = aController.squeezeActionStartFrameId;
+      immersiveController.squeezeActionStopFrameId = aController.squeezeActionStopFrameId;
+      if (!(dirty & DirtyIdentity)) {
+        bytes += 2 * sizeof(uint64_t) + count * sizeof(float) + 4 * sizeof(uint64_t);
+      }
+    }
+    if (dirty & DirtyAxes) {
+      const uint32_t count = std::min<uint32_t>(aController.numAxes, kControllerMaxAxes);
+      for (uint32_t j = 0; j < count; ++j) {
+        immersiveController.axisValue[j] = aController.immersiveAxes[j];
+      }
+      if (!(dirty & DirtyIdentity)) {
+        bytes += count * sizeof(float);
+      }
+    }
+    if (dirty & DirtyHaptics) {
+      immersiveController.numHaptics = aController.numHaptics;
+      if (!(dirty & DirtyIdentity)) {
+        bytes += sizeof(uint32_t);
+      }
+    }
+    controllerBytesWritten += bytes;
+    MarkControllerChanged(aIndex);
+  }
+
+  void WriteControllerPose(mozilla::gfx::VRControllerState& aState, const Controller& aController, const uint16_t aFlags,
+                           const vrb::Matrix& aTransform, const PosePredictor::Motion& aMotion) {
+    const vrb::Matrix beamTransform = aTransform.PostMultiply(aController.immersiveBeamTransform);
+    if (aFlags & static_cast<uint16_t>(mozilla::gfx::ControllerCapabilityFlags::Cap_Orientation)) {
+      aState.isOrientationValid = true;
+
+      vrb::Quaternion rotate;
+      if (aFlags & static_cast<uint16_t>(mozilla::gfx::ControllerCapabilityFlags::Cap_GripSpacePosition)) {
+        rotate = aTransform;
+        rotate = rotate.Inverse();
+        memcpy(&(aState.pose.orientation), rotate.Data(), sizeof(aState.pose.orientation));
+      }
+      rotate.SetFromRotationMatrix(beamTransform);
+      rotate = rotate.Inverse();
+      memcpy(&(aState.targetRayPose.orientation), rotate.Data(), sizeof(aState.targetRayPose.orientation));
+    }
+    if (aFlags & static_cast<uint16_t>(mozilla::gfx::ControllerCapabilityFlags::Cap_Position) ||
+      aFlags & static_cast<uint16_t>(mozilla::gfx::ControllerCapabilityFlags::Cap_PositionEmulated)) {
+      aState.isPositionValid = true;
+
+      vrb::Vector position;
+      if (aFlags & static_cast<uint16_t>(mozilla::gfx::ControllerCapabilityFlags::Cap_GripSpacePosition)) {
+        position = aTransform.GetTranslation();
+        memcpy(&(aState.pose.position), position.Data(), sizeof(aState.pose.position));
+      }
+      position = beamTransform.GetTranslation();
+      memcpy(&(aState.targetRayPose.position), position.Data(), sizeof(aState.targetRayPose.position));
+    }
+    // The target ray is rigidly attached to the grip, so it turns with it and its
+    // origin picks up the linear velocity of the lever arm between them.
+    CopyMotion(aState.pose, aMotion);
+    PosePredictor::Motion rayMotion = aMotion;
+    const vrb::Vector arm = beamTransform.GetTranslation() - aTransform.GetTranslation();
+    rayMotion.linearVelocity = aMotion.linearVelocity + Cross(aMotion.angularVelocity, arm);
+    CopyMotion(aState.targetRayPose, rayMotion);
+  }
+
+  void RecordFrameWait(const double aSeconds, const bool aArrived) {
+    const float milliseconds = (float)(aSeconds * 1000.0);
+    size_t bucket = 0;
+    while (bucket < kFrameWaitBucketCount - 1 && milliseconds > kFrameWaitBucketLimits[bucket]) {
+      bucket++;
+    }
+    frameWaitHistogram[bucket]++;
+    telemetryWaitSum += aSeconds;
+    telemetryWaits++;
+    telemetry.meanWait = telemetryWaitSum / (double)telemetryWaits;
+    telemetry.maxWait = std::max(telemetry.maxWait, aSeconds);
+    if (!aArrived) {
+      frameWaitTimeouts++;
+      telemetry.waitTimeouts++;
+      return;
+    }
+    frameArrivals[frameArrivalIndex] = (float)aSeconds;
+    frameArrivalIndex = (frameArrivalIndex + 1) % kFrameArrivalCount;
+    frameArrivalCount = std::min(frameArrivalCount + 1, kFrameArrivalCount);
+    UpdateSpinWindow();
+  }
+
+  // Spin just past where most recent frames arrived. If they mostly arrive later
+  // than kFrameWaitMaxSpin, spinning would only burn CPU, so block right away.
+  void UpdateSpinWindow() {
+    float sorted[kFrameArrivalCount];
+    std::copy(frameArrivals, frameArrivals + frameArrivalCount, sorted);
+    std::sort(sorted, sorted + frameArrivalCount);
+    const float typical = sorted[(frameArrivalCount * 3) / 4];
+    const float window = typical * 1.25f;
+    frameWaitSpinWindow = window <= kFrameWaitMaxSpin ? window : 0.0f;
+  }
+
   void SetSourceBrowser(VRBrowserType aBrowser) {
     if (aBrowser == VRBrowserType::Gecko) {
-      browserCond = &data.geckoCond;
-      browserMutex = &data.geckoMutex;
+      browserCond = geckoCond;
+      browserMutex = geckoMutex;
       sourceBrowserState = &data.geckoState;
     } else {
-      browserCond = &data.servoCond;
-      browserMutex = &data.servoMutex;
+      browserCond = servoCond;
+      browserMutex = servoMutex;
       sourceBrowserState = &data.servoState;
     }
   }
@@ -251,6 +738,11 @@ ExternalVR::GetSharedData() {
   return &(m.data);
 }
 
+pthread_mutex_t*
+ExternalVR::GetSystemMutex() {
+  return m.systemMutex;
+}
+
 void
 ExternalVR::SetDeviceName(const std::string& aName) {
   if (aName.length() == 0) {
@@ -346,13 +838,18 @@ ExternalVR::SetSittingToStandingTransform(const vrb::Matrix& aTransform) {
 
 void
 ExternalVR::PushSystemState() {
-  Lock lock(&(m.data.systemMutex));
+  Lock lock(m.systemMutex);
   if (lock.IsLocked()) {
-    memcpy(&(m.data.state), &(m.system), sizeof(mozilla::gfx::VRSystemState));
-    pthread_cond_signal(&m.data.systemCond);
+    m.CopySystemStateWhileLocked();
   }
 }
 
+void
+ExternalVR::GetControllerStateStats(uint64_t& aBytesWritten, uint64_t& aBytesPublished) const {
+  aBytesWritten = m.controllerBytesWritten;
+  aBytesPublished = m.systemBytesPublished;
+}
+
 void
 ExternalVR::PullBrowserState() {
   Lock lock(m.browserMutex);
@@ -371,6 +868,22 @@ ExternalVR::GetFrameId() const {
   return m.lastFrameId;
 }
 
+uint64_t
+ExternalVR::GetInputFrameId() const {
+  return m.system.sensorState.inputFrameID;
+}
+
+bool
+ExternalVR::GetFramePose(const uint64_t aFrameId, vrb::Matrix& aHeadTransform, double& aTimestamp) const {
+  State::FramePose framePose;
+  if (!m.framePoses.Get(aFrameId, framePose)) {
+    return false;
+  }
+  aHeadTransform = framePose.headTransform;
+  aTimestamp = framePose.timestamp;
+  return true;
+}
+
 void
 ExternalVR::SetCompositorEnabled(bool aEnabled) {
   if (aEnabled == m.compositorEnabled) {
@@ -444,13 +957,17 @@ ExternalVR::GetVRState() const {
 
 void
 ExternalVR::PushFramePoses(const vrb::Matrix& aHeadTransform, const std::vector<Controller>& aControllers, const double aTimestamp) {
-  const vrb::Matrix inverseHeadTransform = aHeadTransform.Inverse();
+  vrb::Matrix headTransform = aHeadTransform;
+  PosePredictor::Motion headMotion;
+  m.PredictPose(kHeadPoseDevice, aTimestamp, headTransform, headMotion);
+  const vrb::Matrix inverseHeadTransform = headTransform.Inverse();
   vrb::Quaternion quaternion(inverseHeadTransform);
-  vrb::Vector translation = aHeadTransform.GetTranslation();
+  vrb::Vector translation = headTransform.GetTranslation();
   memcpy(&(m.system.sensorState.pose.orientation), quaternion.Data(),
          sizeof(m.system.sensorState.pose.orientation));
   memcpy(&(m.system.sensorState.pose.position), translation.Data(),
          sizeof(m.system.sensorState.pose.position));
+  CopyMotion(m.system.sensorState.pose, headMotion);
   m.system.sensorState.inputFrameID++;
   m.system.displayState.lastSubmittedFrameId = m.lastFrameId;
 
@@ -462,73 +979,38 @@ ExternalVR::PushFramePoses(const vrb::Matrix& aHeadTransform, const std::vector<
          sizeof(m.system.sensorState.rightViewMatrix));
 
 
-  memset(m.system.controllerState, 0, sizeof(m.system.controllerState));
-  for (int i = 0; i < aControllers.size(); ++i) {
-    const Controller& controller = aControllers[i];
-    if (controller.immersiveName.empty() || !controller.enabled) {
+  for (int i = 0; i < mozilla::gfx::kVRControllerMaxCount; ++i) {
+    if (i >= aControllers.size() || aControllers[i].immersiveName.empty() || !aControllers[i].enabled) {
+      m.ClearController(i);
       continue;
     }
-    mozilla::gfx::VRControllerState& immersiveController = m.system.controllerState[i];
-    memcpy(immersiveController.controllerName, controller.immersiveName.c_str(), controller.immersiveName.size() + 1);
-    immersiveController.numButtons = controller.numButtons;
-    immersiveController.buttonPressed = controller.immersivePressedState;
-    immersiveController.buttonTouched = controller.immersiveTouchedState;
-    for (int j = 0; j < controller.numButtons; ++j) {
-      immersiveController.triggerValue[j] = controller.immersiveTriggerValues[j];
-    }
-    immersiveController.numAxes = controller.numAxes;
-    for (int j = 0; j < controller.numAxes; ++j) {
-      immersiveController.axisValue[j] = controller.immersiveAxes[j];
-    }
-    immersiveController.numHaptics = controller.numHaptics;
-    immersiveController.hand = controller.leftHanded ? mozilla::gfx::ControllerHand::Left : mozilla::gfx::ControllerHand::Right;
-    immersiveController.type = GetVRControllerTypeByDevice(controller.type);
-
-    const uint16_t flags = GetControllerCapabilityFlags(controller.deviceCapabilities);
-    immersiveController.flags = static_cast<mozilla::gfx::ControllerCapabilityFlags>(flags);
-    const vrb::Matrix beamTransform = controller.transformMatrix.PostMultiply(controller.immersiveBeamTransform);
-    if (flags & static_cast<uint16_t>(mozilla::gfx::ControllerCapabilityFlags::Cap_Orientation)) {
-      immersiveController.isOrientationValid = true;
-
-      vrb::Quaternion rotate;
-      if (flags & static_cast<uint16_t>(mozilla::gfx::ControllerCapabilityFlags::Cap_GripSpacePosition)) {
-        rotate = controller.transformMatrix;
-        rotate = rotate.Inverse();
-        memcpy(&(immersiveController.pose.orientation), rotate.Data(), sizeof(immersiveController.pose.orientation));
-      }
-      rotate.SetFromRotationMatrix(beamTransform);
-      rotate = rotate.Inverse();
-      memcpy(&(immersiveController.targetRayPose.orientation), rotate.Data(), sizeof(immersiveController.targetRayPose.orientation));
-    }
-    if (flags & static_cast<uint16_t>(mozilla::gfx::ControllerCapabilityFlags::Cap_Position) ||
-      flags & static_cast<uint16_t>(mozilla::gfx::ControllerCapabilityFlags::Cap_PositionEmulated)) {
-      immersiveController.isPositionValid = true;
-
-      vrb::Vector position;
-      if (flags & static_cast<uint16_t>(mozilla::gfx::ControllerCapabilityFlags::Cap_GripSpacePosition)) {
-        position = controller.transformMatrix.GetTranslation();
-        memcpy(&(immersiveController.pose.position), position.Data(), sizeof(immersiveController.pose.position));
-      }
-      position = beamTransform.GetTranslation();
-      memcpy(&(immersiveController.targetRayPose.position), position.Data(), sizeof(immersiveController.targetRayPose.position));
-    }
-    // TODO:: We should add TargetRayMode::_end in moz_external_vr.h to help this check.
-    assert((uint8_t)mozilla::gfx::TargetRayMode::Screen == (uint8_t)device::TargetRayMode::Screen);
-    immersiveController.targetRayMode = (mozilla::gfx::TargetRayMode)controller.targetRayMode;
-    immersiveController.mappingType = mozilla::gfx::GamepadMappingType::XRStandard;
-    immersiveController.selectActionStartFrameId = controller.selectActionStartFrameId;
-    immersiveController.selectActionStopFrameId = controller.selectActionStopFrameId;
-    immersiveController.squeezeActionStartFrameId = controller.squeezeActionStartFrameId;
-    immersiveController.squeezeActionStopFrameId = controller.squeezeActionStopFrameId;
+    const Controller& controller = aControllers[i];
+    vrb::Matrix transform = controller.transformMatrix;
+    PosePredictor::Motion motion;
+    m.PredictPose(kHeadPoseDevice + 1 + i, aTimestamp, transform, motion);
+    m.UpdateController(i, controller, GetControllerCapabilityFlags(controller.deviceCapabilities), transform, motion);
   }
 
   m.system.sensorState.timestamp = aTimestamp;
+  State::FramePose framePose;
+  framePose.headTransform = headTransform;
+  framePose.timestamp = aTimestamp;
+  m.framePoses.Put(m.system.sensorState.inputFrameID, framePose);
 
   PushSystemState();
 }
 
+void
+ExternalVR::SetPosePredictionFrames(const float aFrames) {
+  m.posePredictionFrames = aFrames;
+}
+
 bool
 ExternalVR::WaitFrameResult() {
+  const double start = MonotonicSeconds();
+  const double spinEnd = start + m.frameWaitSpinWindow;
+  bool spun = false;
+  bool blocked = false;
   Wait wait(m.browserMutex, m.browserCond);
   wait.Lock();
   // browserMutex is locked in wait.lock().
@@ -544,22 +1026,84 @@ ExternalVR::WaitFrameResult() {
     if (m.firstPresentingFrame || m.waitingForExit) {
       return true; // Do not block to show loading screen until the first frame arrives.
     }
-    // VRB_LOG("RequestFrame ABOUT TO WAIT FOR FRAME %llu %llu",m.browser.layerState[0].layer_stereo_immersive.frameId, m.lastFrameId);
-    const float kConditionTimeout = 0.1f;
-    // Wait causes the current thread to block until the condition variable is notified or the timeout happens.
-    // Waiting for the condition variable releases the mutex atomically. So GV can modify the browser data.
-    if (!wait.DoWait(kConditionTimeout)) {
-      return false;
+    const double now = MonotonicSeconds();
+    if (now < spinEnd) {
+      // Frames usually arrive within the spin window, so release the mutex for GV
+      // to publish the frame and look again instead of paying the wake up latency.
+      wait.Unlock();
+      sched_yield();
+      wait.Lock();
+      spun = true;
+    } else {
+      // VRB_LOG("RequestFrame ABOUT TO WAIT FOR FRAME %llu %llu",m.browser.layerState[0].layer_stereo_immersive.frameId, m.lastFrameId);
+      // Wait causes the current thread to block until the condition variable is notified or the timeout happens.
+      // Waiting for the condition variable releases the mutex atomically. So GV can modify the browser data.
+      const double remaining = start + m.frameWaitTimeout - now;
+      if ((float)remaining <= 0.0f || !wait.DoWait((float)remaining)) {
+        m.RecordFrameWait(MonotonicSeconds() - start, false);
+        return false;
+      }
+      blocked = true;
+      // VRB_LOG("RequestFrame DONE TO WAIT FOR FRAME");
     }
-    // VRB_LOG("RequestFrame DONE TO WAIT FOR FRAME");
 
     // browserMutex lock is reacquired again after the condition variable wait exits.
     m.PullBrowserStateWhileLocked();
   }
   m.lastFrameId = m.browser.layerState[0].layer_stereo_immersive.frameId;
+  if (!IsPresenting()) {
+    return true;
+  }
+  if (blocked) {
+    m.frameWaitBlocks++;
+  } else if (spun) {
+    m.frameWaitSpinHits++;
+  }
+  m.RecordFrameWait(MonotonicSeconds() - start, true);
   return true;
 }
 
+void
+ExternalVR::SetFrameWaitTimeout(const float aSeconds) {
+  m.frameWaitTimeout = aSeconds;
+}
+
+void
+ExternalVR::GetFrameWaitStats(FrameWaitStats& aStats) const {
+  aStats.bucketLimits.assign(std::begin(kFrameWaitBucketLimits), std::end(kFrameWaitBucketLimits));
+  aStats.counts.assign(std::begin(m.frameWaitHistogram), std::end(m.frameWaitHistogram));
+  aStats.spinHits = m.frameWaitSpinHits;
+  aStats.blocks = m.frameWaitBlocks;
+  aStats.timeouts = m.frameWaitTimeouts;
+  aStats.spinWindow = m.frameWaitSpinWindow;
+}
+
+void
+ExternalVR::ResetFrameWaitStats() {
+  m.ResetFrameWaitStats();
+}
+
+void
+ExternalVR::RecordFrameOutcome(const FrameOutcome aOutcome, const DeviceDelegate::FramePrediction aPrediction) {
+  switch (aOutcome) {
+    case FrameOutcome::Presented:
+      m.telemetry.framesPresented++;
+      break;
+    case FrameOutcome::Reprojected:
+      m.telemetry.framesReprojected++;
+      break;
+    case FrameOutcome::Discarded:
+      m.telemetry.framesDiscarded++;
+      break;
+  }
+  const size_t depth = (size_t)aPrediction;
+  if (depth < sizeof(m.telemetry.framesAtPrediction) / sizeof(m.telemetry.framesAtPrediction[0])) {
+    m.telemetry.framesAtPrediction[depth]++;
+  }
+  // Published with the next PushFramePoses.
+  m.system.displayState.droppedFrameCount = m.telemetry.framesReprojected + m.telemetry.framesDiscarded;
+}
+
 void
 ExternalVR::CompleteEnumeration()
 {
@@ -570,7 +1114,7 @@ ExternalVR::CompleteEnumeration()
 void
 ExternalVR::GetFrameResult(int32_t& aSurfaceHandle, int32_t& aTextureWidth, int32_t& aTextureHeight,
     device::EyeRect& aLeftEye, device::EyeRect& aRightEye) const {
-  aSurfaceHandle = (int32_t)m.browser.layerState[0].layer_stereo_immersive.textureHandle;
+  aSurfaceHandle = (int32_t)(intptr_t)m.browser.layerState[0].layer_stereo_immersive.textureHandle;
   mozilla::gfx::VRLayerEyeRect& left = m.browser.layerState[0].layer_stereo_immersive.leftEyeRect;
   mozilla::gfx::VRLayerEyeRect& right = m.browser.layerState[0].layer_stereo_immersive.rightEyeRect;
   aLeftEye = device::EyeRect(left.x, left.y, left.width, left.height);
@@ -579,23 +1123,55 @@ ExternalVR::GetFrameResult(int32_t& aSurfaceHandle, int32_t& aTextureWidth, int3
   aTextureHeight = (int32_t)m.browser.layerState[0].layer_stereo_immersive.textureSize.height;
 }
 
+void
+ExternalVR::GetOverlayLayers(std::vector<FrameLayer>& aLayers) const {
+  aLayers.clear();
+  for (int i = 1; i < mozilla::gfx::kVRLayerMaxCount; i++) {
+    const mozilla::gfx::VRLayerState& state = m.browser.layerState[i];
+    // 2D content layers have no placement in the immersive scene.
+    if (state.type != mozilla::gfx::VRLayerType::LayerType_Stereo_Immersive) {
+      continue;
+    }
+    const mozilla::gfx::VRLayer_Stereo_Immersive& layer = state.layer_stereo_immersive;
+    if (!layer.textureHandle || layer.textureSize.width <= 0 || layer.textureSize.height <= 0) {
+      continue;
+    }
+    FrameLayer result;
+    result.slot = i;
+    result.surfaceHandle = (int32_t)(intptr_t)layer.textureHandle;
+    result.frameId = layer.frameId;
+    result.textureWidth = (int32_t)layer.textureSize.width;
+    result.textureHeight = (int32_t)layer.textureSize.height;
+    result.leftEye = device::EyeRect(layer.leftEyeRect.x, layer.leftEyeRect.y, layer.leftEyeRect.width, layer.leftEyeRect.height);
+    result.rightEye = device::EyeRect(layer.rightEyeRect.x, layer.rightEyeRect.y, layer.rightEyeRect.width, layer.rightEyeRect.height);
+    aLayers.push_back(result);
+  }
+}
+
 void
 ExternalVR::SetHapticState(ControllerContainerPtr aControllerContainer) const {
-  const uint32_t count = aControllerContainer->GetControllerCount();
-  uint32_t i = 0, j = 0;
-  for (i = 0; i < count; ++i) {
-    for (j = 0; j < mozilla::gfx::kVRHapticsMaxCount; ++j) {
-      if (m.browser.hapticState[j].controllerIndex == i && m.browser.hapticState[j].inputFrameID) {
-        aControllerContainer->SetHapticFeedback(i, m.browser.hapticState[j].inputFrameID,
-                m.browser.hapticState[j].pulseDuration + m.browser.hapticState[j].pulseStart,
-                m.browser.hapticState[j].pulseIntensity);
-        break;
-      }
+  const int32_t count = std::min((int32_t)aControllerContainer->GetControllerCount(),
+                                 (int32_t)mozilla::gfx::kVRControllerMaxCount);
+  for (int32_t i = 0; i < count; ++i) {
+    uint64_t inputFrameID = 0;
+    float duration = 0.0f;
+    float intensity = 0.0f;
+    const int32_t index = m.controllerHaptics[i];
+    if (index >= 0) {
+      // All hapticState has already been reset to zero when the pulse ended, so no entry means no feedback.
+      const mozilla::gfx::VRHapticState& haptic = m.browser.hapticState[index];
+      inputFrameID = haptic.inputFrameID;
+      duration = haptic.pulseDuration + haptic.pulseStart;
+      intensity = haptic.pulseIntensity;
     }
-    // All hapticState has already been reset to zero, so it can't be match.
-    if (j == mozilla::gfx::kVRHapticsMaxCount) {
-      aControllerContainer->SetHapticFeedback(i, 0, 0.0f, 0.0f);
+    uint64_t currentFrameID = 0;
+    float currentDuration = 0.0f;
+    float currentIntensity = 0.0f;
+    aControllerContainer->GetHapticFeedback(i, currentFrameID, currentDuration, currentIntensity);
+    if (currentFrameID == inputFrameID && currentDuration == duration && currentIntensity == intensity) {
+      continue;
     }
+    aControllerContainer->SetHapticFeedback(i, inputFrameID, duration, intensity);
   }
 }
 
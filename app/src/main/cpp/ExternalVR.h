@@ -12,10 +12,11 @@
 #include "DeviceDelegate.h"
 #include "Device.h"
 #include <memory>
+#include <pthread.h>
 #include <string>
 #include <vector>
 
-namespace mozilla { namespace gfx { struct VRExternalShmem; } }
+namespace mozilla { namespace gfx { struct VRExternalShmem; struct VRSystemState; } }
 
 namespace crow {
 
@@ -34,8 +35,40 @@ public:
     Gecko,
     Servo
   };
+  // WaitFrameResult durations. counts has one more bucket than bucketLimits
+  // (milliseconds), for waits longer than the last limit.
+  struct FrameWaitStats {
+    std::vector<float> bucketLimits;
+    std::vector<uint32_t> counts;
+    // Frames that arrived while spinning, frames that needed a blocking wait, and waits that timed out.
+    uint32_t spinHits = 0;
+    uint32_t blocks = 0;
+    uint32_t timeouts = 0;
+    // Current spin window in seconds, sized from recent frame arrival times.
+    float spinWindow = 0.0f;
+  };
+  // How each immersive frame ended, see RecordFrameOutcome.
+  enum class FrameOutcome {
+    Presented,
+    Reprojected,
+    Discarded
+  };
+  // A stereo immersive layer submitted by Gecko in addition to the main one.
+  struct FrameLayer {
+    // Index in VRBrowserState::layerState. It stays the same while Gecko rotates the
+    // layer through its SurfaceTextures.
+    int32_t slot = 0;
+    int32_t surfaceHandle = 0;
+    uint64_t frameId = 0;
+    int32_t textureWidth = 0;
+    int32_t textureHeight = 0;
+    device::EyeRect leftEye;
+    device::EyeRect rightEye;
+  };
   static ExternalVRPtr Create();
   mozilla::gfx::VRExternalShmem* GetSharedData();
+  // Guards the system state in the shared data. Part of it on Android only.
+  pthread_mutex_t* GetSystemMutex();
   // DeviceDisplay interface
   void SetDeviceName(const std::string& aName) override;
   void SetCapabilityFlags(const device::CapabilityFlags aFlags) override;
@@ -50,23 +83,44 @@ public:
   void CompleteEnumeration() override;
   // ExternalVR interface
   void PushSystemState();
+  // Bytes of controller state rewritten by PushFramePoses, and bytes copied into the shared memory.
+  void GetControllerStateStats(uint64_t& aBytesWritten, uint64_t& aBytesPublished) const;
   void PullBrowserState();
   void SetCompositorEnabled(bool aEnabled);
   bool IsPresenting() const;
   VRState GetVRState() const;
   void PushFramePoses(const vrb::Matrix& aHeadTransform, const std::vector<Controller>& aControllers, const double aTimestamp);
+  // Display frames to extrapolate pushed poses forward, see DeviceDelegate::GetPosePredictionFrames.
+  void SetPosePredictionFrames(const float aFrames);
   bool WaitFrameResult();
+  // Total time WaitFrameResult waits before the frame is discarded, 0.1 seconds by default.
+  void SetFrameWaitTimeout(const float aSeconds);
+  // Also logged with the session telemetry when a WebXR session ends.
+  void GetFrameWaitStats(FrameWaitStats& aStats) const;
+  // Also done when a WebXR session starts.
+  void ResetFrameWaitStats();
+  // Counts an immersive frame towards the session telemetry. Reprojected and discarded
+  // frames are also published to Gecko as VRDisplayState::droppedFrameCount.
+  void RecordFrameOutcome(const FrameOutcome aOutcome, const DeviceDelegate::FramePrediction aPrediction);
   void GetFrameResult(int32_t& aSurfaceHandle,
                       int32_t& aTextureWidth,
                       int32_t& aTextureHeight,
                       device::EyeRect& aLeftEye,
                       device::EyeRect& aRightEye) const;
+  // Stereo immersive layers after the main one, back to front. Their frame IDs
+  // advance independently, a layer is only resubmitted when its content changes.
+  void GetOverlayLayers(std::vector<FrameLayer>& aLayers) const;
+  // Forwards Gecko haptic pulses to the controllers whose feedback changed since the last call.
   void SetHapticState(ControllerContainerPtr aControllerContainer) const;
   void StopPresenting();
   void SetSourceBrowser(VRBrowserType aBrowser);
   void OnPause();
   void OnResume();
   uint64_t GetFrameId() const;
+  // inputFrameID of the last poses pushed by PushFramePoses.
+  uint64_t GetInputFrameId() const;
+  // Head pose pushed as aFrameId, while it is still in the ring of recent poses.
+  bool GetFramePose(const uint64_t aFrameId, vrb::Matrix& aHeadTransform, double& aTimestamp) const;
   ExternalVR();
   ~ExternalVR() = default;
 protected:
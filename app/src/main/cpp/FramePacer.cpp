@@ -0,0 +1,253 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "FramePacer.h"
+#include "vrb/ConcreteClass.h"
+#include "vrb/Logger.h"
+
+#include <algorithm>
+#include <time.h>
+
+namespace {
+
+typedef crow::DeviceDelegate::FramePrediction FramePrediction;
+
+// Frames the depth decisions look back over.
+const size_t kWindowSize = 60;
+// Arrival times are fractions of the display frame interval, measured from the frame start.
+// Without frame ahead the blit still has to fit after the arrival, so past this it is late.
+const float kLateArrival = 0.7f;
+// Without frame ahead, content is reliably early while the mean arrival stays below this.
+const float kEarlyArrival = 0.5f;
+// With frame ahead, a frame arriving before this was already done when the frame started.
+const float kReadyArrival = 0.1f;
+// Late frames tolerated within the window without frame ahead.
+const uint32_t kLateLimit = 2;
+// Missed frames tolerated within the window before predicting one more frame ahead.
+const uint32_t kMissLimit = 3;
+// Frames before a shallower depth is probed. Doubles each time a probe fails.
+const uint32_t kMinProbeFrames = 120;
+const uint32_t kMaxProbeFrames = 3840;
+// Going deeper within this many frames of a probe means the probe failed.
+const uint32_t kProbeGraceFrames = 2 * kWindowSize;
+// Fraction of the frame interval the render thread waits for a WebXR frame.
+const float kNoFrameAheadWaitBudget = 0.6f;
+const float kFrameAheadWaitBudget = 0.75f;
+const float kMinWaitBudget = 0.004f;
+const float kMaxWaitBudget = 0.1f;
+// Display refresh rates this estimates the frame interval for.
+const double kMinFrameInterval = 1.0 / 150.0;
+const double kMaxFrameInterval = 1.0 / 20.0;
+const double kFrameIntervalSmoothing = 0.05;
+const size_t kTraceSize = 32;
+
+double
+MonotonicSeconds() {
+  struct timespec ts = {};
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1.0e-9;
+}
+
+const char*
+PredictionName(const FramePrediction aPrediction) {
+  switch (aPrediction) {
+    case FramePrediction::NO_FRAME_AHEAD: return "no frame ahead";
+    case FramePrediction::ONE_FRAME_AHEAD: return "one frame ahead";
+    case FramePrediction::TWO_FRAMES_AHEAD: return "two frames ahead";
+  }
+  return "unknown";
+}
+
+struct Sample {
+  float arrival;
+  bool missed;
+};
+
+} // namespace
+
+namespace crow {
+
+struct FramePacer::State {
+  FramePrediction maxPrediction = FramePrediction::ONE_FRAME_AHEAD;
+  FramePrediction prediction = FramePrediction::ONE_FRAME_AHEAD;
+  double frameStart = 0.0;
+  double interval = 0.0;
+  Sample samples[kWindowSize];
+  size_t sampleCount = 0;
+  size_t sampleIndex = 0;
+  uint32_t framesInMode = 0;
+  uint32_t probeFrames = kMinProbeFrames;
+  bool probing = false;
+  Decision trace[kTraceSize];
+  size_t traceCount = 0;
+  size_t traceIndex = 0;
+
+  void Reset() {
+    prediction = FramePrediction::ONE_FRAME_AHEAD;
+    frameStart = 0.0;
+    sampleCount = 0;
+    sampleIndex = 0;
+    framesInMode = 0;
+    probeFrames = kMinProbeFrames;
+    probing = false;
+  }
+
+  float WaitBudget() const {
+    if (interval <= 0.0) {
+      return kMaxWaitBudget;
+    }
+    const float fraction = prediction == FramePrediction::NO_FRAME_AHEAD ? kNoFrameAheadWaitBudget : kFrameAheadWaitBudget;
+    return std::min(std::max((float)interval * fraction, kMinWaitBudget), kMaxWaitBudget);
+  }
+
+  void Switch(const FramePrediction aPrediction, const char* aReason, const float aMeanArrival,
+              const uint32_t aLate, const uint32_t aMissed) {
+    const bool deeper = aPrediction > prediction;
+    if (deeper && probing) {
+      probeFrames = std::min(probeFrames * 2, kMaxProbeFrames);
+    }
+    probing = !deeper;
+
+    Decision& decision = trace[traceIndex];
+    decision.timestamp = frameStart;
+    decision.from = prediction;
+    decision.to = aPrediction;
+    decision.reason = aReason;
+    decision.meanArrival = aMeanArrival;
+    decision.lateRatio = sampleCount ? (float)aLate / (float)sampleCount : 0.0f;
+    decision.missRatio = sampleCount ? (float)aMissed / (float)sampleCount : 0.0f;
+    prediction = aPrediction;
+    decision.waitBudget = WaitBudget();
+    traceIndex = (traceIndex + 1) % kTraceSize;
+    traceCount = std::min(traceCount + 1, kTraceSize);
+    VRB_LOG("FramePacer: %s -> %s, %s (arrival %.2f late %.2f missed %.2f over %u frames, wait budget %.1fms, next probe in %u frames)",
+            PredictionName(decision.from), PredictionName(decision.to), aReason, aMeanArrival,
+            decision.lateRatio, decision.missRatio, (uint32_t)sampleCount, decision.waitBudget * 1000.0f, probeFrames);
+
+    sampleCount = 0;
+    sampleIndex = 0;
+    framesInMode = 0;
+  }
+
+  void Update() {
+    if (probing && framesInMode >= kProbeGraceFrames) {
+      probing = false;
+      probeFrames = kMinProbeFrames;
+    }
+    float arrivalSum = 0.0f;
+    uint32_t late = 0;
+    uint32_t missed = 0;
+    uint32_t ready = 0;
+    for (size_t i = 0; i < sampleCount; i++) {
+      arrivalSum += samples[i].arrival;
+      late += samples[i].arrival > kLateArrival ? 1 : 0;
+      missed += samples[i].missed ? 1 : 0;
+      ready += samples[i].arrival < kReadyArrival && !samples[i].missed ? 1 : 0;
+    }
+    const float meanArrival = sampleCount ? arrivalSum / (float)sampleCount : 0.0f;
+    const bool windowFull = sampleCount == kWindowSize;
+
+    if (prediction == FramePrediction::NO_FRAME_AHEAD) {
+      if (missed > 0) {
+        Switch(FramePrediction::ONE_FRAME_AHEAD, "missed a frame without frame ahead", meanArrival, late, missed);
+      } else if (late >= kLateLimit) {
+        Switch(FramePrediction::ONE_FRAME_AHEAD, "frames arriving close to vsync", meanArrival, late, missed);
+      } else if (windowFull && meanArrival > kEarlyArrival) {
+        Switch(FramePrediction::ONE_FRAME_AHEAD, "content no longer finishing early", meanArrival, late, missed);
+      }
+      return;
+    }
+
+    if (missed >= kMissLimit && prediction < maxPrediction) {
+      Switch(FramePrediction::TWO_FRAMES_AHEAD, "repeatedly missing frames", meanArrival, late, missed);
+      return;
+    }
+
+    if (windowFull && missed == 0 && ready == sampleCount && framesInMode >= probeFrames) {
+      if (prediction == FramePrediction::TWO_FRAMES_AHEAD) {
+        Switch(FramePrediction::ONE_FRAME_AHEAD, "frames ready at vsync, probing one frame ahead", meanArrival, late, missed);
+      } else {
+        Switch(FramePrediction::NO_FRAME_AHEAD, "frames ready at vsync, probing no frame ahead", meanArrival, late, missed);
+      }
+    }
+  }
+};
+
+FramePacerPtr
+FramePacer::Create() {
+  return std::make_shared<vrb::ConcreteClass<FramePacer, FramePacer::State> >();
+}
+
+void
+FramePacer::Reset() {
+  m.Reset();
+}
+
+void
+FramePacer::SetMaxPrediction(const DeviceDelegate::FramePrediction aPrediction) {
+  m.maxPrediction = std::max(aPrediction, FramePrediction::ONE_FRAME_AHEAD);
+  if (m.prediction > m.maxPrediction) {
+    m.prediction = m.maxPrediction;
+  }
+}
+
+void
+FramePacer::StartFrame() {
+  const double now = MonotonicSeconds();
+  if (m.frameStart > 0.0) {
+    const double elapsed = now - m.frameStart;
+    // Stalls and skipped frames say nothing about the refresh rate.
+    if (elapsed >= kMinFrameInterval && elapsed <= kMaxFrameInterval) {
+      if (m.interval <= 0.0) {
+        m.interval = elapsed;
+      } else if (elapsed < m.interval * 1.5) {
+        m.interval += (elapsed - m.interval) * kFrameIntervalSmoothing;
+      }
+    }
+  }
+  m.frameStart = now;
+}
+
+void
+FramePacer::FrameArrived(const bool aMissed) {
+  if (m.frameStart <= 0.0 || m.interval <= 0.0) {
+    return;
+  }
+  Sample& sample = m.samples[m.sampleIndex];
+  sample.arrival = (float)((MonotonicSeconds() - m.frameStart) / m.interval);
+  sample.missed = aMissed;
+  m.sampleIndex = (m.sampleIndex + 1) % kWindowSize;
+  m.sampleCount = std::min(m.sampleCount + 1, kWindowSize);
+  m.framesInMode++;
+  m.Update();
+}
+
+DeviceDelegate::FramePrediction
+FramePacer::GetPrediction() const {
+  return m.prediction;
+}
+
+float
+FramePacer::GetWaitBudget() const {
+  return m.WaitBudget();
+}
+
+double
+FramePacer::GetFrameInterval() const {
+  return m.interval;
+}
+
+void
+FramePacer::GetTrace(std::vector<Decision>& aTrace) const {
+  aTrace.clear();
+  const size_t start = (m.traceIndex + kTraceSize - m.traceCount) % kTraceSize;
+  for (size_t i = 0; i < m.traceCount; i++) {
+    aTrace.push_back(m.trace[(start + i) % kTraceSize]);
+  }
+}
+
+FramePacer::FramePacer(State& aState) : m(aState) {}
+
+} // namespace crow
@@ -0,0 +1,65 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef VRBROWSER_FRAME_PACER_H
+#define VRBROWSER_FRAME_PACER_H
+
+#include "DeviceDelegate.h"
+#include "vrb/MacroUtils.h"
+
+#include <memory>
+#include <vector>
+
+namespace crow {
+
+class FramePacer;
+typedef std::shared_ptr<FramePacer> FramePacerPtr;
+
+// Chooses how many frames ahead WebXR poses are predicted, and how long the render
+// thread waits for a WebXR frame, from when Gecko frames arrive within the display
+// frame. Drops to no frame ahead when content reliably finishes early, goes deeper
+// when it keeps missing. Moving to a shallower depth is a probe that backs off
+// exponentially each time it fails, so the depth does not flap.
+class FramePacer {
+public:
+  struct Decision {
+    double timestamp;
+    DeviceDelegate::FramePrediction from;
+    DeviceDelegate::FramePrediction to;
+    const char* reason;
+    // Over the window the decision was based on.
+    float meanArrival;
+    float lateRatio;
+    float missRatio;
+    float waitBudget;
+  };
+  static FramePacerPtr Create();
+  void Reset();
+  // Deepest prediction the device supports, ONE_FRAME_AHEAD or TWO_FRAMES_AHEAD.
+  void SetMaxPrediction(const DeviceDelegate::FramePrediction aPrediction);
+  // Called when the immersive frame starts, right after the display vsync.
+  void StartFrame();
+  // Called when the wait for the WebXR frame ends, aMissed if it timed out.
+  void FrameArrived(const bool aMissed);
+  DeviceDelegate::FramePrediction GetPrediction() const;
+  // Seconds to wait for the WebXR frame before the display frame is lost.
+  float GetWaitBudget() const;
+  // Estimated display frame interval in seconds.
+  double GetFrameInterval() const;
+  // Most recent decisions, oldest first.
+  void GetTrace(std::vector<Decision>& aTrace) const;
+protected:
+  struct State;
+  FramePacer(State& aState);
+  ~FramePacer() = default;
+private:
+  State& m;
+  FramePacer() = delete;
+  VRB_NO_DEFAULTS(FramePacer)
+};
+
+} // namespace crow
+
+#endif // VRBROWSER_FRAME_PACER_H
@@ -25,6 +25,9 @@ jmethodID sUpdateTexImage;
 jmethodID sReleaseTexImage;
 jmethodID sIncrementUse;
 jmethodID sDecrementUse;
+jclass sUtilsClass;
+jmethodID sUpdateAndReleaseTexImage;
+uint64_t sJNICalls;
 
 const char* kClassName = "org/mozilla/gecko/gfx/GeckoSurfaceTexture";
 const char* kLookupName = "lookup";
@@ -43,6 +46,9 @@ const char* kIncrementUseName = "incrementUse";
 const char* kIncrementUseSignature = "()V";
 const char* kDecrementUseName = "decrementUse";
 const char* kDecrementUseSignature = "()V";
+const char* kUtilsClassName = "org/mozilla/vrbrowser/utils/GeckoSurfaceTextureUtils";
+const char* kUpdateAndReleaseTexImageName = "updateAndReleaseTexImage";
+const char* kUpdateAndReleaseTexImageSignature = "(Landroid/graphics/SurfaceTexture;)V";
 
 }
 
@@ -51,8 +57,12 @@ namespace crow {
 struct GeckoSurfaceTexture::State {
   jobject surface;
   GLuint texture;
+  // Only the browser attaches the surface, so after the first query the context
+  // it is attached to is tracked here instead of asking Java every frame.
+  bool attachedContextKnown;
+  EGLContext attachedContext;
   State()
-      : surface(nullptr), texture(0)
+      : surface(nullptr), texture(0), attachedContextKnown(false), attachedContext(EGL_NO_CONTEXT)
   {}
   ~State() = default;
   void Shutdown() {
@@ -92,6 +102,14 @@ GeckoSurfaceTexture::InitializeJava(JNIEnv* aEnv, jobject aActivity) {
   sReleaseTexImage = FindJNIMethodID(sEnv, sGeckoSurfaceTextureClass, kReleaseTexImageName, kReleaseTexImageSignature);
   sIncrementUse = FindJNIMethodID(sEnv, sGeckoSurfaceTextureClass, kIncrementUseName, kIncrementUseSignature);
   sDecrementUse = FindJNIMethodID(sEnv, sGeckoSurfaceTextureClass, kDecrementUseName, kDecrementUseSignature);
+
+  jclass utilsClass = sClassLoader->FindClass(kUtilsClassName);
+  if (utilsClass) {
+    sUtilsClass = (jclass)sEnv->NewGlobalRef(utilsClass);
+    sEnv->DeleteLocalRef(utilsClass);
+    sUpdateAndReleaseTexImage = FindJNIMethodID(sEnv, sUtilsClass, kUpdateAndReleaseTexImageName,
+                                                kUpdateAndReleaseTexImageSignature, /*aIsStatic*/ true);
+  }
 }
 
 void
@@ -109,6 +127,11 @@ GeckoSurfaceTexture::ShutdownJava() {
       sEnv->DeleteGlobalRef(sGeckoSurfaceTextureClass);
       sGeckoSurfaceTextureClass = nullptr;
     }
+    if (sUtilsClass) {
+      sEnv->DeleteGlobalRef(sUtilsClass);
+      sUtilsClass = nullptr;
+    }
+    sUpdateAndReleaseTexImage = nullptr;
     sLookup = nullptr;
     sAttachToGLContext = nullptr;
     sReleaseTexImage = nullptr;
@@ -130,6 +153,7 @@ GeckoSurfaceTexture::Create(const int32_t aHandle) {
     VRB_ERROR("GeckoSurfaceTexture.lookup method missing");
     return result;
   }
+  sJNICalls++;
   jobject surface = sEnv->CallStaticObjectMethod(sGeckoSurfaceTextureClass, sLookup, aHandle);
   if (!surface) {
     VRB_ERROR("Unable to find GeckoSurfaceTexture with handle: %d", aHandle);
@@ -158,28 +182,44 @@ GeckoSurfaceTexture::AttachToGLContext(EGLContext aContext) {
     VRB_GL_CHECK(glTexParameteri(GL_TEXTURE_EXTERNAL_OES, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
     VRB_GL_CHECK(glTexParameteri(GL_TEXTURE_EXTERNAL_OES, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
   }
+  sJNICalls++;
   sEnv->CallVoidMethod(m.surface, sAttachToGLContext, (jlong)aContext, (jint)m.texture);
   CheckJNIException(sEnv, __FUNCTION__);
+  m.attachedContextKnown = true;
+  m.attachedContext = aContext;
 }
 
 bool
 GeckoSurfaceTexture::IsAttachedToGLContext(EGLContext aContext) const {
+  if (m.attachedContextKnown) {
+    return m.attachedContext == aContext;
+  }
   if (!ValidateMethodID(sEnv, m.surface, sIsAttachedToGLContext, __FUNCTION__)) { return false; }
+  sJNICalls++;
   bool result = sEnv->CallBooleanMethod(m.surface, sIsAttachedToGLContext, (jlong)aContext);
   CheckJNIException(sEnv, __FUNCTION__);
+  // Attached to some other context is not known, keep asking until this one attaches it.
+  if (result) {
+    m.attachedContextKnown = true;
+    m.attachedContext = aContext;
+  }
   return result;
 }
 
 void
 GeckoSurfaceTexture::DetachFromGLContext() {
   if (!ValidateMethodID(sEnv, m.surface, sDetachFromGLContext, __FUNCTION__)) { return; }
+  sJNICalls++;
   sEnv->CallVoidMethod(m.surface, sDetachFromGLContext);
   CheckJNIException(sEnv, __FUNCTION__);
+  m.attachedContextKnown = true;
+  m.attachedContext = EGL_NO_CONTEXT;
 }
 
 void
 GeckoSurfaceTexture::UpdateTexImage() {
   if (!ValidateMethodID(sEnv, m.surface, sUpdateTexImage, __FUNCTION__)) { return; }
+  sJNICalls++;
   sEnv->CallVoidMethod(m.surface, sUpdateTexImage);
   CheckJNIException(sEnv, __FUNCTION__);
 }
@@ -187,13 +227,28 @@ GeckoSurfaceTexture::UpdateTexImage() {
 void
 GeckoSurfaceTexture::ReleaseTexImage() {
   if (!ValidateMethodID(sEnv, m.surface, sReleaseTexImage, __FUNCTION__)) { return; }
+  sJNICalls++;
   sEnv->CallVoidMethod(m.surface, sReleaseTexImage);
   CheckJNIException(sEnv, __FUNCTION__);
 }
 
+void
+GeckoSurfaceTexture::UpdateAndReleaseTexImage() {
+  if (!m.surface || !sUpdateAndReleaseTexImage) {
+    UpdateTexImage();
+    ReleaseTexImage();
+    return;
+  }
+  if (!ValidateStaticMethodID(sEnv, sUtilsClass, sUpdateAndReleaseTexImage, __FUNCTION__)) { return; }
+  sJNICalls++;
+  sEnv->CallStaticVoidMethod(sUtilsClass, sUpdateAndReleaseTexImage, m.surface);
+  CheckJNIException(sEnv, __FUNCTION__);
+}
+
 void
 GeckoSurfaceTexture::IncrementUse() {
   if (!ValidateMethodID(sEnv, m.surface, sIncrementUse, __FUNCTION__)) { return; }
+  sJNICalls++;
   sEnv->CallVoidMethod(m.surface, sIncrementUse);
   CheckJNIException(sEnv, __FUNCTION__);
 }
@@ -201,10 +256,16 @@ GeckoSurfaceTexture::IncrementUse() {
 void
 GeckoSurfaceTexture::DecrementUse() {
   if (!ValidateMethodID(sEnv, m.surface, sDecrementUse, __FUNCTION__)) { return; }
+  sJNICalls++;
   sEnv->CallVoidMethod(m.surface, sDecrementUse);
   CheckJNIException(sEnv, __FUNCTION__);
 }
 
+uint64_t
+GeckoSurfaceTexture::GetJNICallCount() {
+  return sJNICalls;
+}
+
 GeckoSurfaceTexture::GeckoSurfaceTexture(State& aState) : m(aState) {}
 GeckoSurfaceTexture::~GeckoSurfaceTexture() {
   if (m.surface) {
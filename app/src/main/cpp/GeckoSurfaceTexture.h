@@ -23,12 +23,16 @@ public:
   static void InitializeJava(JNIEnv* aEnv, jobject aActivity);
   static void ShutdownJava();
   static GeckoSurfaceTexturePtr Create(const int32_t aHandle);
+  // Calls into Java made by all GeckoSurfaceTextures.
+  static uint64_t GetJNICallCount();
   GLuint GetTextureName();
   void AttachToGLContext(EGLContext aContext);
   bool IsAttachedToGLContext(EGLContext aContext) const;
   void DetachFromGLContext();
   void UpdateTexImage();
   void ReleaseTexImage();
+  // Skips the current image with a single call into Java.
+  void UpdateAndReleaseTexImage();
   void IncrementUse();
   void DecrementUse();
 
@@ -0,0 +1,152 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef VRBROWSER_LAYER_SCHEDULER_H
+#define VRBROWSER_LAYER_SCHEDULER_H
+
+#include "VRLayer.h"
+
+#include <algorithm>
+#include <stdint.h>
+#include <vector>
+
+namespace crow {
+
+// Keeps the compositor layers of a device in draw order, layers behind the eye buffers
+// first, each part ordered by VRLayer::ShouldDrawBefore(). T is the device's layer
+// pointer type, anything with GetLayer() returning the VRLayerPtr it composites.
+//
+// The order is fully sorted only when a layer is added or a priority or draw in front
+// flag changes. Otherwise only the draw indices of equal priority layers can change,
+// and those follow the order the world requests draws in, which is mostly the same
+// from frame to frame. An insertion pass puts them back in order in linear time.
+template <class T>
+class LayerScheduler {
+public:
+  LayerScheduler()
+      : sorted(true)
+      , orderChangeCount(VRLayer::GetOrderChangeCount())
+      , frontIndex(0)
+      , fullSorts(0)
+      , moves(0)
+  {}
+
+  void Add(const T& aLayer) {
+    entries.push_back(Entry(aLayer));
+    layers.push_back(aLayer);
+    sorted = false;
+  }
+
+  // Returns the removed layer, or an empty T if aLayer is not scheduled.
+  T Remove(const VRLayerPtr& aLayer) {
+    for (size_t i = 0; i < entries.size(); i++) {
+      if (entries[i].vrLayer == aLayer.get()) {
+        T result = layers[i];
+        // Erasing keeps the remaining layers in order.
+        entries.erase(entries.begin() + i);
+        layers.erase(layers.begin() + i);
+        if (i < frontIndex) {
+          frontIndex--;
+        }
+        return result;
+      }
+    }
+    return T();
+  }
+
+  T Find(const VRLayerPtr& aLayer) const {
+    for (size_t i = 0; i < entries.size(); i++) {
+      if (entries[i].vrLayer == aLayer.get()) {
+        return layers[i];
+      }
+    }
+    return T();
+  }
+
+  void Clear() {
+    entries.clear();
+    layers.clear();
+    frontIndex = 0;
+    sorted = true;
+  }
+
+  // Layers in draw order as of the last Update().
+  const std::vector<T>& GetLayers() const {
+    return layers;
+  }
+
+  // Index of the first layer drawn in front of the eye buffers.
+  size_t GetFrontIndex() const {
+    return frontIndex;
+  }
+
+  // Brings the order up to date, called once per frame before the layers are submitted.
+  void Update() {
+    const uint64_t changeCount = VRLayer::GetOrderChangeCount();
+    if (!sorted || changeCount != orderChangeCount) {
+      std::sort(entries.begin(), entries.end(), DrawsBefore);
+      sorted = true;
+      orderChangeCount = changeCount;
+      fullSorts++;
+      CopyLayers();
+    } else {
+      bool moved = false;
+      for (size_t i = 1; i < entries.size(); i++) {
+        for (size_t j = i; j > 0 && DrawsBefore(entries[j], entries[j - 1]); j--) {
+          std::swap(entries[j], entries[j - 1]);
+          moves++;
+          moved = true;
+        }
+      }
+      if (moved) {
+        CopyLayers();
+      }
+    }
+    frontIndex = 0;
+    while (frontIndex < entries.size() && !entries[frontIndex].vrLayer->GetDrawInFront()) {
+      frontIndex++;
+    }
+  }
+
+  // Updates that had to sort all layers, and layers moved by the insertion pass otherwise.
+  void GetStats(uint64_t& aFullSorts, uint64_t& aMoves) const {
+    aFullSorts = fullSorts;
+    aMoves = moves;
+  }
+
+private:
+  struct Entry {
+    T layer;
+    // Cached so comparisons do not copy the VRLayerPtr.
+    VRLayer* vrLayer;
+    explicit Entry(const T& aLayer) : layer(aLayer), vrLayer(aLayer->GetLayer().get()) {}
+  };
+
+  static bool DrawsBefore(const Entry& aFirst, const Entry& aSecond) {
+    const bool firstInFront = aFirst.vrLayer->GetDrawInFront();
+    if (firstInFront != aSecond.vrLayer->GetDrawInFront()) {
+      return !firstInFront;
+    }
+    return aFirst.vrLayer->ShouldDrawBefore(*aSecond.vrLayer);
+  }
+
+  void CopyLayers() {
+    for (size_t i = 0; i < entries.size(); i++) {
+      layers[i] = entries[i].layer;
+    }
+  }
+
+  std::vector<Entry> entries;
+  std::vector<T> layers;
+  bool sorted;
+  uint64_t orderChangeCount;
+  size_t frontIndex;
+  uint64_t fullSorts;
+  uint64_t moves;
+};
+
+} // namespace crow
+
+#endif // VRBROWSER_LAYER_SCHEDULER_H
@@ -0,0 +1,197 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "PosePredictor.h"
+#include "vrb/ConcreteClass.h"
+
+#include "vrb/Matrix.h"
+#include "vrb/Quaternion.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace {
+
+// Longest extrapolation, further than this the constant acceleration model diverges.
+const double kMaxPrediction = 0.1;
+// Samples closer together than this belong to the same frame.
+const double kMinSampleInterval = 0.0005;
+// Weight of the newest estimate in the exponential smoothing of each rate.
+const float kVelocitySmoothing = 0.7f;
+const float kAccelerationSmoothing = 0.3f;
+const double kIntervalSmoothing = 0.1;
+
+struct Rotation {
+  float x, y, z, w;
+};
+
+Rotation
+ToRotation(const vrb::Quaternion& aQuaternion) {
+  return Rotation{aQuaternion.x(), aQuaternion.y(), aQuaternion.z(), aQuaternion.w()};
+}
+
+Rotation
+Multiply(const Rotation& a, const Rotation& b) {
+  return Rotation{
+      a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y,
+      a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x,
+      a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w,
+      a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z};
+}
+
+Rotation
+Conjugate(const Rotation& a) {
+  return Rotation{-a.x, -a.y, -a.z, a.w};
+}
+
+Rotation
+Normalize(const Rotation& a) {
+  const float length = sqrtf(a.x * a.x + a.y * a.y + a.z * a.z + a.w * a.w);
+  if (length <= 0.0f) {
+    return Rotation{0.0f, 0.0f, 0.0f, 1.0f};
+  }
+  return Rotation{a.x / length, a.y / length, a.z / length, a.w / length};
+}
+
+// Axis scaled by angle, taking the shortest way around.
+vrb::Vector
+ToRotationVector(const Rotation& aRotation) {
+  const float sign = aRotation.w < 0.0f ? -1.0f : 1.0f;
+  const vrb::Vector axis(aRotation.x * sign, aRotation.y * sign, aRotation.z * sign);
+  const float sine = axis.Magnitude();
+  if (sine < 1e-7f) {
+    return axis * 2.0f;
+  }
+  const float angle = 2.0f * atan2f(sine, aRotation.w * sign);
+  return axis * (angle / sine);
+}
+
+Rotation
+FromRotationVector(const vrb::Vector& aVector) {
+  const float angle = aVector.Magnitude();
+  if (angle < 1e-7f) {
+    return Normalize(Rotation{aVector.x() * 0.5f, aVector.y() * 0.5f, aVector.z() * 0.5f, 1.0f});
+  }
+  const float scale = sinf(angle * 0.5f) / angle;
+  return Rotation{aVector.x() * scale, aVector.y() * scale, aVector.z() * scale, cosf(angle * 0.5f)};
+}
+
+vrb::Vector
+Lerp(const vrb::Vector& aFrom, const vrb::Vector& aTo, const float aWeight) {
+  return aFrom + (aTo - aFrom) * aWeight;
+}
+
+struct Sample {
+  double timestamp = 0.0;
+  vrb::Vector position;
+  Rotation rotation = {0.0f, 0.0f, 0.0f, 1.0f};
+};
+
+struct DeviceHistory {
+  bool hasSample = false;
+  bool hasMotion = false;
+  Sample last;
+  double interval = 0.0;
+  crow::PosePredictor::Motion motion;
+};
+
+} // namespace
+
+namespace crow {
+
+struct PosePredictor::State {
+  std::vector<DeviceHistory> devices;
+};
+
+PosePredictorPtr
+PosePredictor::Create() {
+  return std::make_shared<vrb::ConcreteClass<PosePredictor, PosePredictor::State> >();
+}
+
+void
+PosePredictor::Reset() {
+  m.devices.clear();
+}
+
+void
+PosePredictor::AddSample(const uint32_t aDevice, const double aTimestamp, const vrb::Matrix& aTransform) {
+  if (aDevice >= m.devices.size()) {
+    m.devices.resize(aDevice + 1);
+  }
+  DeviceHistory& device = m.devices[aDevice];
+  Sample sample;
+  sample.timestamp = aTimestamp;
+  sample.position = aTransform.GetTranslation();
+  sample.rotation = Normalize(ToRotation(vrb::Quaternion(aTransform)));
+  if (!device.hasSample || aTimestamp < device.last.timestamp) {
+    // First sample, or the clock went backwards.
+    device = DeviceHistory();
+    device.hasSample = true;
+    device.last = sample;
+    return;
+  }
+  const double elapsed = aTimestamp - device.last.timestamp;
+  if (elapsed < kMinSampleInterval) {
+    sample.timestamp = device.last.timestamp;
+    device.last = sample;
+    return;
+  }
+
+  const float inverse = (float)(1.0 / elapsed);
+  vrb::Vector velocity = (sample.position - device.last.position) * inverse;
+  vrb::Vector angularVelocity = ToRotationVector(Multiply(sample.rotation, Conjugate(device.last.rotation))) * inverse;
+  Motion& motion = device.motion;
+  if (device.hasMotion) {
+    velocity = Lerp(motion.linearVelocity, velocity, kVelocitySmoothing);
+    angularVelocity = Lerp(motion.angularVelocity, angularVelocity, kVelocitySmoothing);
+    motion.linearAcceleration = Lerp(motion.linearAcceleration, (velocity - motion.linearVelocity) * inverse,
+                                     kAccelerationSmoothing);
+    motion.angularAcceleration = Lerp(motion.angularAcceleration, (angularVelocity - motion.angularVelocity) * inverse,
+                                      kAccelerationSmoothing);
+    device.interval += (elapsed - device.interval) * kIntervalSmoothing;
+  } else {
+    device.interval = elapsed;
+    device.hasMotion = true;
+  }
+  motion.linearVelocity = velocity;
+  motion.angularVelocity = angularVelocity;
+  device.last = sample;
+}
+
+double
+PosePredictor::GetSampleInterval(const uint32_t aDevice) const {
+  if (aDevice >= m.devices.size() || !m.devices[aDevice].hasMotion) {
+    return 0.0;
+  }
+  return m.devices[aDevice].interval;
+}
+
+bool
+PosePredictor::Predict(const uint32_t aDevice, const double aTimestamp, vrb::Matrix& aTransform, Motion& aMotion) const {
+  if (aDevice >= m.devices.size() || !m.devices[aDevice].hasSample) {
+    return false;
+  }
+  const DeviceHistory& device = m.devices[aDevice];
+  const Motion& motion = device.motion;
+  const float time = (float)std::min(std::max(aTimestamp - device.last.timestamp, 0.0), kMaxPrediction);
+  const float halfSquare = 0.5f * time * time;
+  const vrb::Vector position = device.last.position + motion.linearVelocity * time +
+                               motion.linearAcceleration * halfSquare;
+  const vrb::Vector turn = motion.angularVelocity * time + motion.angularAcceleration * halfSquare;
+  const Rotation rotation = Normalize(Multiply(FromRotationVector(turn), device.last.rotation));
+
+  aTransform = vrb::Matrix::Rotation(vrb::Quaternion(rotation.x, rotation.y, rotation.z, rotation.w));
+  aTransform.TranslateInPlace(position);
+  aMotion.linearVelocity = motion.linearVelocity + motion.linearAcceleration * time;
+  aMotion.linearAcceleration = motion.linearAcceleration;
+  aMotion.angularVelocity = motion.angularVelocity + motion.angularAcceleration * time;
+  aMotion.angularAcceleration = motion.angularAcceleration;
+  return true;
+}
+
+PosePredictor::PosePredictor(State& aState) : m(aState) {}
+
+} // namespace crow
@@ -0,0 +1,54 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef VRBROWSER_POSE_PREDICTOR_H
+#define VRBROWSER_POSE_PREDICTOR_H
+
+#include "vrb/Forward.h"
+#include "vrb/MacroUtils.h"
+#include "vrb/Vector.h"
+
+#include <memory>
+#include <stdint.h>
+
+namespace crow {
+
+class PosePredictor;
+typedef std::shared_ptr<PosePredictor> PosePredictorPtr;
+
+// Estimates linear and angular velocity and acceleration of tracked devices
+// from their recent poses, and extrapolates the poses forward in time.
+// Devices are identified by small indices, e.g. 0 for the head.
+class PosePredictor {
+public:
+  // Per second rates in the space of the sampled transforms.
+  struct Motion {
+    vrb::Vector linearVelocity;
+    vrb::Vector linearAcceleration;
+    vrb::Vector angularVelocity;
+    vrb::Vector angularAcceleration;
+  };
+  static PosePredictorPtr Create();
+  void Reset();
+  // Samples with the same timestamp as the previous one replace it.
+  void AddSample(const uint32_t aDevice, const double aTimestamp, const vrb::Matrix& aTransform);
+  // Smoothed seconds between samples of aDevice, 0 until it has two samples.
+  double GetSampleInterval(const uint32_t aDevice) const;
+  // Extrapolates aDevice from its latest sample to aTimestamp, clamped to a
+  // short horizon. Returns false if aDevice has no samples.
+  bool Predict(const uint32_t aDevice, const double aTimestamp, vrb::Matrix& aTransform, Motion& aMotion) const;
+protected:
+  struct State;
+  PosePredictor(State& aState);
+  ~PosePredictor() = default;
+private:
+  State& m;
+  PosePredictor() = delete;
+  VRB_NO_DEFAULTS(PosePredictor)
+};
+
+} // namespace crow
+
+#endif // VRBROWSER_POSE_PREDICTOR_H
@@ -0,0 +1,58 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef VRBROWSER_POSE_RING_H
+#define VRBROWSER_POSE_RING_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace crow {
+
+// Fixed size ring of predicted poses keyed by the WebXR input frame ID they
+// were published as. Lets a frame rendered several frames after its pose was
+// predicted find that pose again.
+template<typename T, size_t N>
+class PoseRing {
+public:
+  static const size_t kCapacity = N;
+
+  PoseRing() { Clear(); }
+
+  void Clear() {
+    for (Slot& slot: mSlots) {
+      slot.valid = false;
+    }
+  }
+
+  void Put(const uint64_t aFrameId, const T& aPose) {
+    Slot& slot = mSlots[aFrameId % N];
+    slot.frameId = aFrameId;
+    slot.pose = aPose;
+    slot.valid = true;
+  }
+
+  // Returns false if the pose was never stored or has been overwritten.
+  bool Get(const uint64_t aFrameId, T& aPose) const {
+    const Slot& slot = mSlots[aFrameId % N];
+    if (!slot.valid || slot.frameId != aFrameId) {
+      return false;
+    }
+    aPose = slot.pose;
+    return true;
+  }
+
+private:
+  struct Slot {
+    uint64_t frameId = 0;
+    bool valid = false;
+    T pose;
+  };
+  Slot mSlots[N];
+};
+
+} // namespace crow
+
+#endif // VRBROWSER_POSE_RING_H
@@ -4,6 +4,7 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 
 #include "Quad.h"
+#include "TransformCache.h"
 #include "VRLayer.h"
 #include "VRLayerNode.h"
 #include "vrb/ConcreteClass.h"
@@ -32,6 +33,7 @@ struct Quad::State {
   int32_t textureHeight;
   vrb::TogglePtr root;
   vrb::TransformPtr transform;
+  TransformCachePtr transformCache;
   vrb::GeometryPtr geometry;
   Quad::ScaleMode scaleMode;
   vrb::Vector worldMin;
@@ -51,6 +53,7 @@ struct Quad::State {
   void Initialize() {
     vrb::CreationContextPtr create = context.lock();
     transform = vrb::Transform::Create(create);
+    transformCache = TransformCache::Create(transform);
     if (layer) {
       textureWidth = layer->GetWidth();
       textureHeight = layer->GetHeight();
@@ -425,6 +428,11 @@ Quad::GetTransformNode() const {
   return m.transform;
 }
 
+const TransformCachePtr&
+Quad::GetTransformCache() const {
+  return m.transformCache;
+}
+
 VRLayerQuadPtr
 Quad::GetLayer() const {
   return m.layer;
@@ -438,8 +446,8 @@ Quad::TestIntersection(const vrb::Vector& aStartPoint, const vrb::Vector& aDirec
   if (!m.root->IsEnabled(*m.transform)) {
     return false;
   }
-  vrb::Matrix worldTransform = m.transform->GetWorldTransform();
-  vrb::Matrix modelView = worldTransform.AfineInverse();
+  const vrb::Matrix& worldTransform = m.transformCache->GetWorldTransform();
+  const vrb::Matrix& modelView = m.transformCache->GetInverseWorldTransform();
   vrb::Vector point = modelView.MultiplyPosition(aStartPoint);
   vrb::Vector direction = modelView.MultiplyDirection(aDirection);
   vrb::Vector normal = GetNormal();
@@ -482,9 +490,26 @@ Quad::TestIntersection(const vrb::Vector& aStartPoint, const vrb::Vector& aDirec
   return true;
 }
 
+void
+Quad::GetHitBounds(vrb::Vector& aMin, vrb::Vector& aMax) const {
+  aMin = vrb::Vector(m.worldMin.x(), m.worldMin.y(), m.worldMin.z() - 0.1f);
+  aMax = vrb::Vector(m.worldMax.x(), m.worldMax.y(), m.worldMax.z() + 0.1f);
+}
+
+bool
+Quad::GetHitPlane(vrb::Matrix& aInverseWorld, vrb::Vector& aPoint, vrb::Vector& aNormal) const {
+  if (!m.root->IsEnabled(*m.transform)) {
+    return false;
+  }
+  aInverseWorld = m.transformCache->GetInverseWorldTransform();
+  aPoint = m.worldMin;
+  aNormal = GetNormal();
+  return true;
+}
+
 void
 Quad::ConvertToQuadCoordinates(const vrb::Vector& point, float& aX, float& aY, bool aClamp) const {
-  vrb::Vector value = m.transform->GetWorldTransform().AfineInverse().MultiplyPosition(point);
+  vrb::Vector value = m.transformCache->GetInverseWorldTransform().MultiplyPosition(point);
   // Clamp value to quad bounds.
   if (aClamp) {
     if (value.x() > m.worldMax.x()) { value.x() = m.worldMax.x(); }
@@ -17,6 +17,9 @@
 
 namespace crow {
 
+class TransformCache;
+typedef std::shared_ptr<TransformCache> TransformCachePtr;
+
 
 class VRLayerQuad;
 typedef std::shared_ptr<VRLayerQuad> VRLayerQuadPtr;
@@ -57,8 +60,13 @@ public:
   vrb::Vector GetNormal() const;
   vrb::NodePtr GetRoot() const;
   vrb::TransformPtr GetTransformNode() const;
+  const TransformCachePtr& GetTransformCache() const;
   VRLayerQuadPtr GetLayer() const;
   bool TestIntersection(const vrb::Vector& aStartPoint, const vrb::Vector& aDirection, vrb::Vector& aResult, vrb::Vector& aNormal, bool aClamp, bool& aIsInside, float& aDistance) const;
+  // Local space box holding every point TestIntersection reports as inside.
+  void GetHitBounds(vrb::Vector& aMin, vrb::Vector& aMax) const;
+  // Local space plane used by TestIntersection. Returns false when the quad is disabled.
+  bool GetHitPlane(vrb::Matrix& aInverseWorld, vrb::Vector& aPoint, vrb::Vector& aNormal) const;
   void ConvertToQuadCoordinates(const vrb::Vector& point, float& aX, float& aY, bool aClamp) const;
 protected:
   struct State;
@@ -0,0 +1,242 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "QuadHitBatch.h"
+#include "vrb/ConcreteClass.h"
+
+#include "vrb/Matrix.h"
+#include "vrb/Vector.h"
+
+#include <cmath>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define QUAD_HIT_BATCH_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define QUAD_HIT_BATCH_SSE 1
+#endif
+
+namespace crow {
+
+namespace {
+
+// Same tolerances as Quad::TestIntersection.
+const float kEpsilon = 0.00000001f;
+const size_t kLanes = 4;
+
+// Columns of the inverse world transform, then the local plane and inside bounds.
+enum Field {
+  C0X, C0Y, C0Z,
+  C1X, C1Y, C1Z,
+  C2X, C2Y, C2Z,
+  TX, TY, TZ,
+  NX, NY, NZ,
+  OX, OY, OZ,
+  MinX, MinY, MinZ,
+  MaxX, MaxY, MaxZ,
+  FieldCount
+};
+
+} // namespace
+
+struct QuadHitBatch::State {
+  // Padded to a multiple of kLanes. Padding has a zero normal so it never hits.
+  std::vector<float> fields[FieldCount];
+  size_t count;
+
+  State() : count(0) {}
+
+  const float* Data(const int aField) const {
+    return fields[aField].data();
+  }
+
+  size_t PaddedCount() const {
+    return fields[0].size();
+  }
+
+  void IntersectScalar(const vrb::Vector& aStart, const vrb::Vector& aDirection, const float aLength, float* aOut) const {
+    const float sx = aStart.x(), sy = aStart.y(), sz = aStart.z();
+    const float dx = aDirection.x(), dy = aDirection.y(), dz = aDirection.z();
+    for (size_t i = 0; i < count; i++) {
+      aOut[i] = -1.0f;
+      const float px = Data(C0X)[i] * sx + Data(C1X)[i] * sy + Data(C2X)[i] * sz + Data(TX)[i];
+      const float py = Data(C0Y)[i] * sx + Data(C1Y)[i] * sy + Data(C2Y)[i] * sz + Data(TY)[i];
+      const float pz = Data(C0Z)[i] * sx + Data(C1Z)[i] * sy + Data(C2Z)[i] * sz + Data(TZ)[i];
+      const float vx = Data(C0X)[i] * dx + Data(C1X)[i] * dy + Data(C2X)[i] * dz;
+      const float vy = Data(C0Y)[i] * dx + Data(C1Y)[i] * dy + Data(C2Y)[i] * dz;
+      const float vz = Data(C0Z)[i] * dx + Data(C1Z)[i] * dy + Data(C2Z)[i] * dz;
+      const float dotNormals = vx * Data(NX)[i] + vy * Data(NY)[i] + vz * Data(NZ)[i];
+      if (dotNormals > -kEpsilon) {
+        continue;
+      }
+      const float dotV = (Data(OX)[i] - px) * Data(NX)[i] + (Data(OY)[i] - py) * Data(NY)[i] +
+                         (Data(OZ)[i] - pz) * Data(NZ)[i];
+      if ((dotV < kEpsilon) && (dotV > -kEpsilon)) {
+        continue;
+      }
+      const float t = dotV / dotNormals;
+      const float rx = px + vx * t;
+      const float ry = py + vy * t;
+      const float rz = pz + vz * t;
+      if (rx >= Data(MinX)[i] && ry >= Data(MinY)[i] && rz >= Data(MinZ)[i] &&
+          rx <= Data(MaxX)[i] && ry <= Data(MaxY)[i] && rz <= Data(MaxZ)[i]) {
+        aOut[i] = fabsf(t) * aLength;
+      }
+    }
+  }
+
+#if defined(QUAD_HIT_BATCH_NEON)
+  void IntersectLanes(const vrb::Vector& aStart, const vrb::Vector& aDirection, const float aLength, float* aOut) const {
+    const float32x4_t sx = vdupq_n_f32(aStart.x()), sy = vdupq_n_f32(aStart.y()), sz = vdupq_n_f32(aStart.z());
+    const float32x4_t dx = vdupq_n_f32(aDirection.x()), dy = vdupq_n_f32(aDirection.y()), dz = vdupq_n_f32(aDirection.z());
+    const float32x4_t eps = vdupq_n_f32(kEpsilon);
+    const float32x4_t negEps = vdupq_n_f32(-kEpsilon);
+    const float32x4_t length = vdupq_n_f32(aLength);
+    const float32x4_t miss = vdupq_n_f32(-1.0f);
+    for (size_t i = 0; i < PaddedCount(); i += kLanes) {
+      const float32x4_t c0x = vld1q_f32(Data(C0X) + i), c0y = vld1q_f32(Data(C0Y) + i), c0z = vld1q_f32(Data(C0Z) + i);
+      const float32x4_t c1x = vld1q_f32(Data(C1X) + i), c1y = vld1q_f32(Data(C1Y) + i), c1z = vld1q_f32(Data(C1Z) + i);
+      const float32x4_t c2x = vld1q_f32(Data(C2X) + i), c2y = vld1q_f32(Data(C2Y) + i), c2z = vld1q_f32(Data(C2Z) + i);
+      const float32x4_t px = vmlaq_f32(vmlaq_f32(vmlaq_f32(vld1q_f32(Data(TX) + i), c0x, sx), c1x, sy), c2x, sz);
+      const float32x4_t py = vmlaq_f32(vmlaq_f32(vmlaq_f32(vld1q_f32(Data(TY) + i), c0y, sx), c1y, sy), c2y, sz);
+      const float32x4_t pz = vmlaq_f32(vmlaq_f32(vmlaq_f32(vld1q_f32(Data(TZ) + i), c0z, sx), c1z, sy), c2z, sz);
+      const float32x4_t vx = vmlaq_f32(vmlaq_f32(vmulq_f32(c0x, dx), c1x, dy), c2x, dz);
+      const float32x4_t vy = vmlaq_f32(vmlaq_f32(vmulq_f32(c0y, dx), c1y, dy), c2y, dz);
+      const float32x4_t vz = vmlaq_f32(vmlaq_f32(vmulq_f32(c0z, dx), c1z, dy), c2z, dz);
+      const float32x4_t nx = vld1q_f32(Data(NX) + i), ny = vld1q_f32(Data(NY) + i), nz = vld1q_f32(Data(NZ) + i);
+      const float32x4_t dotNormals = vmlaq_f32(vmlaq_f32(vmulq_f32(vx, nx), vy, ny), vz, nz);
+      const float32x4_t dotV = vmlaq_f32(vmlaq_f32(vmulq_f32(vsubq_f32(vld1q_f32(Data(OX) + i), px), nx),
+                                                   vsubq_f32(vld1q_f32(Data(OY) + i), py), ny),
+                                         vsubq_f32(vld1q_f32(Data(OZ) + i), pz), nz);
+      uint32x4_t mask = vcleq_f32(dotNormals, negEps);
+      mask = vandq_u32(mask, vorrq_u32(vcgeq_f32(dotV, eps), vcleq_f32(dotV, negEps)));
+#if defined(__aarch64__)
+      const float32x4_t t = vdivq_f32(dotV, dotNormals);
+#else
+      float32x4_t reciprocal = vrecpeq_f32(dotNormals);
+      reciprocal = vmulq_f32(vrecpsq_f32(dotNormals, reciprocal), reciprocal);
+      reciprocal = vmulq_f32(vrecpsq_f32(dotNormals, reciprocal), reciprocal);
+      const float32x4_t t = vmulq_f32(dotV, reciprocal);
+#endif
+      const float32x4_t rx = vmlaq_f32(px, vx, t);
+      const float32x4_t ry = vmlaq_f32(py, vy, t);
+      const float32x4_t rz = vmlaq_f32(pz, vz, t);
+      mask = vandq_u32(mask, vcgeq_f32(rx, vld1q_f32(Data(MinX) + i)));
+      mask = vandq_u32(mask, vcgeq_f32(ry, vld1q_f32(Data(MinY) + i)));
+      mask = vandq_u32(mask, vcgeq_f32(rz, vld1q_f32(Data(MinZ) + i)));
+      mask = vandq_u32(mask, vcleq_f32(rx, vld1q_f32(Data(MaxX) + i)));
+      mask = vandq_u32(mask, vcleq_f32(ry, vld1q_f32(Data(MaxY) + i)));
+      mask = vandq_u32(mask, vcleq_f32(rz, vld1q_f32(Data(MaxZ) + i)));
+      vst1q_f32(aOut + i, vbslq_f32(mask, vmulq_f32(vabsq_f32(t), length), miss));
+    }
+  }
+#elif defined(QUAD_HIT_BATCH_SSE)
+  void IntersectLanes(const vrb::Vector& aStart, const vrb::Vector& aDirection, const float aLength, float* aOut) const {
+    const __m128 sx = _mm_set1_ps(aStart.x()), sy = _mm_set1_ps(aStart.y()), sz = _mm_set1_ps(aStart.z());
+    const __m128 dx = _mm_set1_ps(aDirection.x()), dy = _mm_set1_ps(aDirection.y()), dz = _mm_set1_ps(aDirection.z());
+    const __m128 eps = _mm_set1_ps(kEpsilon);
+    const __m128 negEps = _mm_set1_ps(-kEpsilon);
+    const __m128 length = _mm_set1_ps(aLength);
+    const __m128 miss = _mm_set1_ps(-1.0f);
+    const __m128 signBit = _mm_set1_ps(-0.0f);
+    for (size_t i = 0; i < PaddedCount(); i += kLanes) {
+      const __m128 c0x = _mm_loadu_ps(Data(C0X) + i), c0y = _mm_loadu_ps(Data(C0Y) + i), c0z = _mm_loadu_ps(Data(C0Z) + i);
+      const __m128 c1x = _mm_loadu_ps(Data(C1X) + i), c1y = _mm_loadu_ps(Data(C1Y) + i), c1z = _mm_loadu_ps(Data(C1Z) + i);
+      const __m128 c2x = _mm_loadu_ps(Data(C2X) + i), c2y = _mm_loadu_ps(Data(C2Y) + i), c2z = _mm_loadu_ps(Data(C2Z) + i);
+      const __m128 px = _mm_add_ps(_mm_add_ps(_mm_mul_ps(c0x, sx), _mm_mul_ps(c1x, sy)),
+                                   _mm_add_ps(_mm_mul_ps(c2x, sz), _mm_loadu_ps(Data(TX) + i)));
+      const __m128 py = _mm_add_ps(_mm_add_ps(_mm_mul_ps(c0y, sx), _mm_mul_ps(c1y, sy)),
+                                   _mm_add_ps(_mm_mul_ps(c2y, sz), _mm_loadu_ps(Data(TY) + i)));
+      const __m128 pz = _mm_add_ps(_mm_add_ps(_mm_mul_ps(c0z, sx), _mm_mul_ps(c1z, sy)),
+                                   _mm_add_ps(_mm_mul_ps(c2z, sz), _mm_loadu_ps(Data(TZ) + i)));
+      const __m128 vx = _mm_add_ps(_mm_add_ps(_mm_mul_ps(c0x, dx), _mm_mul_ps(c1x, dy)), _mm_mul_ps(c2x, dz));
+      const __m128 vy = _mm_add_ps(_mm_add_ps(_mm_mul_ps(c0y, dx), _mm_mul_ps(c1y, dy)), _mm_mul_ps(c2y, dz));
+      const __m128 vz = _mm_add_ps(_mm_add_ps(_mm_mul_ps(c0z, dx), _mm_mul_ps(c1z, dy)), _mm_mul_ps(c2z, dz));
+      const __m128 nx = _mm_loadu_ps(Data(NX) + i), ny = _mm_loadu_ps(Data(NY) + i), nz = _mm_loadu_ps(Data(NZ) + i);
+      const __m128 dotNormals = _mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, nx), _mm_mul_ps(vy, ny)), _mm_mul_ps(vz, nz));
+      const __m128 dotV = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(Data(OX) + i), px), nx),
+                                                _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(Data(OY) + i), py), ny)),
+                                     _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(Data(OZ) + i), pz), nz));
+      __m128 mask = _mm_cmple_ps(dotNormals, negEps);
+      mask = _mm_and_ps(mask, _mm_or_ps(_mm_cmpge_ps(dotV, eps), _mm_cmple_ps(dotV, negEps)));
+      const __m128 t = _mm_div_ps(dotV, dotNormals);
+      const __m128 rx = _mm_add_ps(px, _mm_mul_ps(vx, t));
+      const __m128 ry = _mm_add_ps(py, _mm_mul_ps(vy, t));
+      const __m128 rz = _mm_add_ps(pz, _mm_mul_ps(vz, t));
+      mask = _mm_and_ps(mask, _mm_cmpge_ps(rx, _mm_loadu_ps(Data(MinX) + i)));
+      mask = _mm_and_ps(mask, _mm_cmpge_ps(ry, _mm_loadu_ps(Data(MinY) + i)));
+      mask = _mm_and_ps(mask, _mm_cmpge_ps(rz, _mm_loadu_ps(Data(MinZ) + i)));
+      mask = _mm_and_ps(mask, _mm_cmple_ps(rx, _mm_loadu_ps(Data(MaxX) + i)));
+      mask = _mm_and_ps(mask, _mm_cmple_ps(ry, _mm_loadu_ps(Data(MaxY) + i)));
+      mask = _mm_and_ps(mask, _mm_cmple_ps(rz, _mm_loadu_ps(Data(MaxZ) + i)));
+      const __m128 distance = _mm_mul_ps(_mm_andnot_ps(signBit, t), length);
+      _mm_storeu_ps(aOut + i, _mm_or_ps(_mm_and_ps(mask, distance), _mm_andnot_ps(mask, miss)));
+    }
+  }
+#endif
+};
+
+QuadHitBatchPtr
+QuadHitBatch::Create() {
+  return std::make_shared<vrb::ConcreteClass<QuadHitBatch, QuadHitBatch::State> >();
+}
+
+void
+QuadHitBatch::Clear() {
+  for (std::vector<float>& field: m.fields) {
+    field.clear();
+  }
+  m.count = 0;
+}
+
+size_t
+QuadHitBatch::Add(const vrb::Matrix& aInverseWorld, const vrb::Vector& aPlanePoint, const vrb::Vector& aNormal,
+                  const vrb::Vector& aMin, const vrb::Vector& aMax) {
+  if (m.count == m.PaddedCount()) {
+    for (std::vector<float>& field: m.fields) {
+      field.resize(field.size() + kLanes, 0.0f);
+    }
+  }
+  const size_t index = m.count++;
+  const vrb::Vector c0 = aInverseWorld.MultiplyDirection(vrb::Vector(1.0f, 0.0f, 0.0f));
+  const vrb::Vector c1 = aInverseWorld.MultiplyDirection(vrb::Vector(0.0f, 1.0f, 0.0f));
+  const vrb::Vector c2 = aInverseWorld.MultiplyDirection(vrb::Vector(0.0f, 0.0f, 1.0f));
+  const vrb::Vector translation = aInverseWorld.MultiplyPosition(vrb::Vector(0.0f, 0.0f, 0.0f));
+  const vrb::Vector* vectors[] = { &c0, &c1, &c2, &translation, &aNormal, &aPlanePoint, &aMin, &aMax };
+  int field = 0;
+  for (const vrb::Vector* vector: vectors) {
+    m.fields[field++][index] = vector->x();
+    m.fields[field++][index] = vector->y();
+    m.fields[field++][index] = vector->z();
+  }
+  return index;
+}
+
+size_t
+QuadHitBatch::GetCount() const {
+  return m.count;
+}
+
+void
+QuadHitBatch::Intersect(const vrb::Vector& aStart, const vrb::Vector& aDirection, std::vector<float>& aDistances) const {
+#if defined(QUAD_HIT_BATCH_NEON) || defined(QUAD_HIT_BATCH_SSE)
+  aDistances.resize(m.PaddedCount());
+  m.IntersectLanes(aStart, aDirection, aDirection.Magnitude(), aDistances.data());
+  aDistances.resize(m.count);
+#else
+  IntersectScalar(aStart, aDirection, aDistances);
+#endif
+}
+
+void
+QuadHitBatch::IntersectScalar(const vrb::Vector& aStart, const vrb::Vector& aDirection, std::vector<float>& aDistances) const {
+  aDistances.resize(m.count);
+  m.IntersectScalar(aStart, aDirection, aDirection.Magnitude(), aDistances.data());
+}
+
+QuadHitBatch::QuadHitBatch(State& aState) : m(aState) {}
+
+} // namespace crow
@@ -0,0 +1,48 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef VRBROWSER_QUAD_HIT_BATCH_H
+#define VRBROWSER_QUAD_HIT_BATCH_H
+
+#include "vrb/Forward.h"
+#include "vrb/MacroUtils.h"
+
+#include <memory>
+#include <vector>
+
+namespace crow {
+
+class QuadHitBatch;
+typedef std::shared_ptr<QuadHitBatch> QuadHitBatchPtr;
+
+// Ray intersection against many quads at once. Quads are stored as a structure
+// of arrays and tested four at a time with NEON or SSE when available. Only
+// hits that Quad::TestIntersection would report as inside are returned.
+class QuadHitBatch {
+public:
+  static QuadHitBatchPtr Create();
+  void Clear();
+  // Adds a quad from its inverse world transform and the local space plane and
+  // inside bounds used by Quad::TestIntersection. Returns the quad index.
+  size_t Add(const vrb::Matrix& aInverseWorld, const vrb::Vector& aPlanePoint, const vrb::Vector& aNormal,
+             const vrb::Vector& aMin, const vrb::Vector& aMax);
+  size_t GetCount() const;
+  // Writes the world distance to the inside hit for each quad, or -1.0f when there is none.
+  void Intersect(const vrb::Vector& aStart, const vrb::Vector& aDirection, std::vector<float>& aDistances) const;
+  // Same as Intersect without SIMD.
+  void IntersectScalar(const vrb::Vector& aStart, const vrb::Vector& aDirection, std::vector<float>& aDistances) const;
+protected:
+  struct State;
+  QuadHitBatch(State& aState);
+  ~QuadHitBatch() = default;
+private:
+  State& m;
+  QuadHitBatch() = delete;
+  VRB_NO_DEFAULTS(QuadHitBatch)
+};
+
+} // namespace crow
+
+#endif // VRBROWSER_QUAD_HIT_BATCH_H
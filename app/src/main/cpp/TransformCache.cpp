@@ -0,0 +1,90 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "TransformCache.h"
+#include "vrb/ConcreteClass.h"
+
+#include "vrb/Matrix.h"
+#include "vrb/Transform.h"
+
+namespace crow {
+
+struct TransformCache::State {
+  vrb::TransformPtr node;
+  vrb::Matrix world;
+  vrb::Matrix inverse;
+  bool enabled;
+  bool worldValid;
+  bool inverseValid;
+  uint64_t hits;
+  uint64_t misses;
+
+  State()
+      : world(vrb::Matrix::Identity())
+      , inverse(vrb::Matrix::Identity())
+      , enabled(false)
+      , worldValid(false)
+      , inverseValid(false)
+      , hits(0)
+      , misses(0)
+  {}
+};
+
+TransformCachePtr
+TransformCache::Create(const vrb::TransformPtr& aNode) {
+  TransformCachePtr result = std::make_shared<vrb::ConcreteClass<TransformCache, TransformCache::State> >();
+  result->m.node = aNode;
+  return result;
+}
+
+void
+TransformCache::SetEnabled(const bool aEnabled) {
+  m.enabled = aEnabled;
+  Invalidate();
+}
+
+void
+TransformCache::Invalidate() {
+  m.worldValid = false;
+  m.inverseValid = false;
+}
+
+const vrb::Matrix&
+TransformCache::GetWorldTransform() {
+  if (m.enabled && m.worldValid) {
+    m.hits++;
+    return m.world;
+  }
+  m.world = m.node->GetWorldTransform();
+  if (m.enabled) {
+    m.misses++;
+    m.worldValid = true;
+  }
+  return m.world;
+}
+
+const vrb::Matrix&
+TransformCache::GetInverseWorldTransform() {
+  if (m.enabled && m.inverseValid) {
+    m.hits++;
+    return m.inverse;
+  }
+  m.inverse = GetWorldTransform().AfineInverse();
+  if (m.enabled) {
+    m.misses++;
+    m.inverseValid = true;
+  }
+  return m.inverse;
+}
+
+void
+TransformCache::GetStats(uint64_t& aHits, uint64_t& aMisses) const {
+  aHits = m.hits;
+  aMisses = m.misses;
+}
+
+TransformCache::TransformCache(State& aState) : m(aState) {}
+
+} // namespace crow
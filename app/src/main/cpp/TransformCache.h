@@ -0,0 +1,43 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef VRBROWSER_TRANSFORM_CACHE_H
+#define VRBROWSER_TRANSFORM_CACHE_H
+
+#include "vrb/Forward.h"
+#include "vrb/MacroUtils.h"
+
+#include <memory>
+#include <stdint.h>
+
+namespace crow {
+
+class TransformCache;
+typedef std::shared_ptr<TransformCache> TransformCachePtr;
+
+// World transform of a node and its inverse, kept until Invalidate() is called.
+// The owner must invalidate whenever the node or any of its ancestors change.
+// While disabled every query is recomputed and nothing is counted.
+class TransformCache {
+public:
+  static TransformCachePtr Create(const vrb::TransformPtr& aNode);
+  void SetEnabled(const bool aEnabled);
+  void Invalidate();
+  const vrb::Matrix& GetWorldTransform();
+  const vrb::Matrix& GetInverseWorldTransform();
+  void GetStats(uint64_t& aHits, uint64_t& aMisses) const;
+protected:
+  struct State;
+  TransformCache(State& aState);
+  ~TransformCache() = default;
+private:
+  State& m;
+  TransformCache() = delete;
+  VRB_NO_DEFAULTS(TransformCache)
+};
+
+} // namespace crow
+
+#endif // VRBROWSER_TRANSFORM_CACHE_H
@@ -11,6 +11,7 @@
 namespace crow {
 
 static uint64_t sIndex = 0;
+static uint64_t sOrderChangeCount = 0;
 
 struct VRLayer::State {
   bool initialized;
@@ -131,6 +132,11 @@ VRLayer::ShouldDrawBefore(const VRLayer& aLayer) {
   return m.drawIndex < aLayer.m.drawIndex;
 }
 
+uint64_t
+VRLayer::GetOrderChangeCount() {
+  return sOrderChangeCount;
+}
+
 void
 VRLayer::SetInitialized(bool aInitialized) {
   m.initialized = aInitialized;
@@ -166,7 +172,10 @@ VRLayer::SetCurrentEye(crow::device::Eye aEye) {
 
 void
 VRLayer::SetPriority(int32_t aPriority) {
-  m.priority = aPriority;
+  if (m.priority != aPriority) {
+    m.priority = aPriority;
+    sOrderChangeCount++;
+  }
 }
 
 VRLayer::VRLayer(State& aState, LayerType aLayerType): m(aState) {
@@ -200,7 +209,10 @@ VRLayer::SetSurfaceChangedDelegate(const crow::VRLayer::SurfaceChangedDelegate &
 
 void
 VRLayer::SetDrawInFront(bool aDrawInFront) {
-  m.drawInFront = aDrawInFront;
+  if (m.drawInFront != aDrawInFront) {
+    m.drawInFront = aDrawInFront;
+    sOrderChangeCount++;
+  }
 }
 
 void
@@ -401,6 +413,30 @@ VRLayerCylinder::VRLayerCylinder(State& aState): VRLayerSurface(aState, LayerTyp
 
 VRLayerCylinder::~VRLayerCylinder() {}
 
+// Layer Projection
+
+struct VRLayerProjection::State: public VRLayerSurface::State {
+  State() {
+    textureRect[0] = device::EyeRect(0.0f, 0.0f, 0.5f, 1.0f);
+    textureRect[1] = device::EyeRect(0.5f, 0.0f, 0.5f, 1.0f);
+  }
+};
+
+VRLayerProjectionPtr
+VRLayerProjection::Create(const int32_t aWidth, const int32_t aHeight) {
+  auto result = std::make_shared<vrb::ConcreteClass<VRLayerProjection, VRLayerProjection::State>>();
+  result->m.width = aWidth;
+  result->m.height = aHeight;
+  result->m.surfaceType = VRLayerSurface::SurfaceType::FBO;
+  return result;
+}
+
+VRLayerProjection::VRLayerProjection(State& aState): VRLayerSurface(aState, LayerType::PROJECTION), m(aState) {
+
+}
+
+VRLayerProjection::~VRLayerProjection() {}
+
 // Layer Cube
 
 struct VRLayerCube::State: public VRLayer::State {
@@ -26,7 +26,8 @@ public:
   enum class LayerType {
     QUAD,
     CUBEMAP,
-    EQUIRECTANGULAR
+    EQUIRECTANGULAR,
+    PROJECTION
   };
 
   enum class SurfaceChange {
@@ -52,6 +53,8 @@ public:
   bool IsComposited() const;
 
   bool ShouldDrawBefore(const VRLayer& aLayer);
+  // Incremented whenever the priority or the draw in front flag of any layer changes.
+  static uint64_t GetOrderChangeCount();
   void SetInitialized(bool aInitialized);
   void RequestDraw();
   void ClearRequestDraw();
@@ -151,6 +154,25 @@ private:
 };
 
 
+class VRLayerProjection;
+typedef std::shared_ptr<VRLayerProjection> VRLayerProjectionPtr;
+
+// Side by side stereo image the runtime composites in place of the eye buffers,
+// with the head pose of the frame it belongs to. Texture rects default to the
+// left and right halves.
+class VRLayerProjection: public VRLayerSurface {
+public:
+  static VRLayerProjectionPtr Create(const int32_t aWidth, const int32_t aHeight);
+protected:
+  struct State;
+  VRLayerProjection(State& aState);
+  virtual ~VRLayerProjection();
+private:
+  State& m;
+  VRB_NO_DEFAULTS(VRLayerProjection)
+};
+
+
 class VRLayerCube;
 typedef std::shared_ptr<VRLayerCube> VRLayerCubePtr;
 
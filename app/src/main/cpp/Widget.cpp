@@ -6,6 +6,7 @@
 #include "Widget.h"
 #include "Cylinder.h"
 #include "Quad.h"
+#include "TransformCache.h"
 #include "VRLayer.h"
 #include "VRBrowser.h"
 #include "WidgetPlacement.h"
@@ -32,6 +33,8 @@
 namespace crow {
 
 static const float kFrameSize = 0.02f;
+// Padding for float error in the intersection tests.
+static const float kBoundingSphereMargin = 0.01f;
 #if defined(OCULUSVR)
 static const float kBorder = 0.0f;
 #else
@@ -51,6 +54,7 @@ struct Widget::State {
   vrb::TogglePtr root;
   vrb::TransformPtr transform;
   vrb::TransformPtr transformContainer; // Used for cylinder rotations
+  TransformCachePtr transformCache;
   vrb::TextureSurfacePtr surface;
   WidgetPlacementPtr placement;
   WidgetResizerPtr resizer;
@@ -92,6 +96,9 @@ struct Widget::State {
     } else {
       transform->AddNode(cylinder->GetRoot());
     }
+    transformCache = TransformCache::Create(transform);
+    transformCache->SetEnabled(true);
+    EnableSurfaceTransformCache();
 
     toggleState = IsReadyForComposition();
     root->ToggleAll(toggleState);
@@ -133,6 +140,23 @@ struct Widget::State {
     }
   }
 
+  void EnableSurfaceTransformCache() {
+    if (quad) {
+      quad->GetTransformCache()->SetEnabled(true);
+    } else if (cylinder) {
+      cylinder->GetTransformCache()->SetEnabled(true);
+    }
+  }
+
+  void InvalidateTransformCache() {
+    transformCache->Invalidate();
+    if (quad) {
+      quad->GetTransformCache()->Invalidate();
+    } else if (cylinder) {
+      cylinder->GetTransformCache()->Invalidate();
+    }
+  }
+
   bool IsReadyForComposition() {
     return GetLayer() || placement->composited || placement->GetClearColor().Alpha() > 0;
   }
@@ -188,6 +212,7 @@ struct Widget::State {
     } else {
       transformContainer->SetTransform(vrb::Matrix::Identity());
     }
+    InvalidateTransformCache();
   }
 
   void RemoveResizer() {
@@ -337,6 +362,32 @@ Widget::TestControllerIntersection(const vrb::Vector& aStartPoint, const vrb::Ve
   return result;
 }
 
+bool
+Widget::GetBoundingSphere(vrb::Vector& aCenter, float& aRadius) const {
+  if (!m.root->IsEnabled(*m.transformContainer)) {
+    return false;
+  }
+  vrb::Vector min, max;
+  vrb::Matrix transform;
+  if (m.quad) {
+    m.quad->GetHitBounds(min, max);
+    transform = m.quad->GetTransformCache()->GetWorldTransform();
+  } else {
+    m.cylinder->GetHitBounds(min, max);
+    transform = m.cylinder->GetTransformCache()->GetWorldTransform();
+  }
+  const vrb::Vector halfSize = (max - min) * 0.5f;
+  const vrb::Vector x = transform.MultiplyDirection(vrb::Vector(halfSize.x(), 0.0f, 0.0f));
+  const vrb::Vector y = transform.MultiplyDirection(vrb::Vector(0.0f, halfSize.y(), 0.0f));
+  const vrb::Vector z = transform.MultiplyDirection(vrb::Vector(0.0f, 0.0f, halfSize.z()));
+  const vrb::Vector extent(fabsf(x.x()) + fabsf(y.x()) + fabsf(z.x()),
+                           fabsf(x.y()) + fabsf(y.y()) + fabsf(z.y()),
+                           fabsf(x.z()) + fabsf(y.z()) + fabsf(z.z()));
+  aCenter = transform.MultiplyPosition(min + halfSize);
+  aRadius = extent.Magnitude() + kBoundingSphereMargin;
+  return true;
+}
+
 void
 Widget::ConvertToWidgetCoordinates(const vrb::Vector& point, float& aX, float& aY, bool aClamp) const {
   bool clamp = !m.resizing;
@@ -360,6 +411,7 @@ Widget::GetTransform() const {
 void
 Widget::SetTransform(const vrb::Matrix& aTransform) {
   m.transform->SetTransform(aTransform);
+  m.InvalidateTransformCache();
   if (m.cylinder) {
     m.UpdateCylinderMatrix();
   }
@@ -408,6 +460,8 @@ Widget::SetQuad(const QuadPtr& aQuad) {
   m.quad = aQuad;
   m.transform->AddNode(aQuad->GetRoot());
   m.transformContainer->SetTransform(vrb::Matrix::Identity());
+  m.EnableSurfaceTransformCache();
+  m.InvalidateTransformCache();
 
   m.RemoveResizer();
   m.RemoveBorder();
@@ -428,6 +482,7 @@ Widget::SetCylinder(const CylinderPtr& aCylinder) {
 
   m.cylinder = aCylinder;
   m.transform->AddNode(aCylinder->GetRoot());
+  m.EnableSurfaceTransformCache();
 
   m.RemoveResizer();
   m.RemoveBorder();
@@ -444,6 +499,29 @@ Widget::GetTransformNode() const {
   return m.transform;
 }
 
+const TransformCachePtr&
+Widget::GetTransformCache() const {
+  return m.transformCache;
+}
+
+void
+Widget::InvalidateTransformCache() {
+  m.InvalidateTransformCache();
+}
+
+void
+Widget::GetTransformCacheStats(uint64_t& aHits, uint64_t& aMisses) const {
+  m.transformCache->GetStats(aHits, aMisses);
+  uint64_t hits = 0, misses = 0;
+  if (m.quad) {
+    m.quad->GetTransformCache()->GetStats(hits, misses);
+  } else if (m.cylinder) {
+    m.cylinder->GetTransformCache()->GetStats(hits, misses);
+  }
+  aHits += hits;
+  aMisses += misses;
+}
+
 const WidgetPlacementPtr&
 Widget::GetPlacement() const {
   return m.placement;
@@ -634,6 +712,7 @@ void Widget::LayoutQuadWithCylinderParent(const WidgetPtr& aParent) {
   if (!aParent) {
     // No parent, reset the container transform.
     m.transformContainer->SetTransform(vrb::Matrix::Identity());
+    m.InvalidateTransformCache();
     return;
   }
   CylinderPtr cylinder = aParent->GetCylinder();
@@ -649,6 +728,7 @@ void Widget::LayoutQuadWithCylinderParent(const WidgetPtr& aParent) {
     // e.g. Place the tray tooltips on the correct tray position which may be rotated based on the
     // parent cylindrical window.
     m.transformContainer->SetTransform(aParent->m.transformContainer->GetTransform());
+    m.InvalidateTransformCache();
   }
   m.UpdateResizerTransform();
 }
@@ -27,6 +27,9 @@ typedef std::shared_ptr<VRLayer> VRLayerPtr;
 class Quad;
 typedef std::shared_ptr<Quad> QuadPtr;
 
+class TransformCache;
+typedef std::shared_ptr<TransformCache> TransformCachePtr;
+
 class Widget;
 typedef std::shared_ptr<Widget> WidgetPtr;
 
@@ -53,6 +56,9 @@ public:
   void GetWorldSize(float& aWidth, float& aHeight) const;
   bool TestControllerIntersection(const vrb::Vector& aStartPoint, const vrb::Vector& aDirection, vrb::Vector& aResult, vrb::Vector& aNormal,
                                   const bool aClamp, bool& aIsInWidget, float& aDistance) const;
+  // World space sphere around the area where TestControllerIntersection can report
+  // aIsInWidget. Does not include the resize handles. Returns false when disabled.
+  bool GetBoundingSphere(vrb::Vector& aCenter, float& aRadius) const;
   void ConvertToWidgetCoordinates(const vrb::Vector& aPoint, float& aX, float& aY, bool aClamp = true) const;
   vrb::Vector ConvertToWorldCoordinates(const vrb::Vector& aLocalPoint) const;
   vrb::Vector ConvertToWorldCoordinates(const float aWidgetX, const float aWidgetY) const;
@@ -67,6 +73,10 @@ public:
   void SetCylinder(const CylinderPtr& aCylinder);
   VRLayerSurfacePtr GetLayer() const;
   vrb::TransformPtr GetTransformNode() const;
+  const TransformCachePtr& GetTransformCache() const;
+  // Must be called when a transform above the widget root changes.
+  void InvalidateTransformCache();
+  void GetTransformCacheStats(uint64_t& aHits, uint64_t& aMisses) const;
   const WidgetPlacementPtr& GetPlacement() const;
   void SetPlacement(const WidgetPlacementPtr& aPlacement);
   WidgetResizerPtr StartResize(const vrb::Vector& aMaxSize,  const vrb::Vector& aMinSize);
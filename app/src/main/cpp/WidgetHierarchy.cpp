@@ -0,0 +1,155 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "WidgetHierarchy.h"
+#include "vrb/ConcreteClass.h"
+
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace crow {
+
+namespace {
+
+struct Node {
+  int32_t parent;
+  std::vector<int32_t> children;
+  int32_t depth;
+  uint32_t enter;
+  uint32_t exit;
+  bool visited;
+  Node() : parent(-1), depth(0), enter(0), exit(0), visited(false) {}
+};
+
+} // namespace
+
+struct WidgetHierarchy::State {
+  std::unordered_map<int32_t, Node> nodes;
+  bool dirty;
+
+  State() : dirty(false) {}
+
+  const Node* Find(const int32_t aHandle) {
+    if (dirty) {
+      Rebuild();
+    }
+    auto it = nodes.find(aHandle);
+    return it != nodes.end() ? &it->second : nullptr;
+  }
+
+  bool HasParent(const int32_t aHandle, const Node& aNode) const {
+    return aNode.parent != aHandle && nodes.find(aNode.parent) != nodes.end();
+  }
+
+  // Iterative DFS so that deep trees and cycles in bad placement data can not
+  // overflow the stack. Nodes only reachable through a cycle become roots.
+  void Visit(const int32_t aRoot, uint32_t& aCounter) {
+    std::vector<std::pair<int32_t, size_t>> stack;
+    Node& root = nodes[aRoot];
+    root.visited = true;
+    root.depth = 0;
+    root.enter = aCounter++;
+    stack.emplace_back(aRoot, 0);
+    while (!stack.empty()) {
+      Node& current = nodes[stack.back().first];
+      size_t& next = stack.back().second;
+      if (next >= current.children.size()) {
+        current.exit = aCounter++;
+        stack.pop_back();
+        continue;
+      }
+      const int32_t childHandle = current.children[next++];
+      Node& child = nodes[childHandle];
+      if (child.visited) {
+        continue;
+      }
+      child.visited = true;
+      child.depth = current.depth + 1;
+      child.enter = aCounter++;
+      stack.emplace_back(childHandle, 0);
+    }
+  }
+
+  void Rebuild() {
+    for (auto& entry: nodes) {
+      entry.second.children.clear();
+      entry.second.visited = false;
+    }
+    for (auto& entry: nodes) {
+      if (HasParent(entry.first, entry.second)) {
+        nodes[entry.second.parent].children.push_back(entry.first);
+      }
+    }
+    uint32_t counter = 0;
+    for (auto& entry: nodes) {
+      if (!entry.second.visited && !HasParent(entry.first, entry.second)) {
+        Visit(entry.first, counter);
+      }
+    }
+    for (auto& entry: nodes) {
+      if (!entry.second.visited) {
+        Visit(entry.first, counter);
+      }
+    }
+    dirty = false;
+  }
+};
+
+WidgetHierarchyPtr
+WidgetHierarchy::Create() {
+  return std::make_shared<vrb::ConcreteClass<WidgetHierarchy, WidgetHierarchy::State> >();
+}
+
+void
+WidgetHierarchy::SetParent(const int32_t aHandle, const int32_t aParentHandle) {
+  auto it = m.nodes.find(aHandle);
+  if (it == m.nodes.end()) {
+    m.nodes[aHandle].parent = aParentHandle;
+    m.dirty = true;
+  } else if (it->second.parent != aParentHandle) {
+    it->second.parent = aParentHandle;
+    m.dirty = true;
+  }
+}
+
+void
+WidgetHierarchy::Remove(const int32_t aHandle) {
+  if (m.nodes.erase(aHandle) > 0) {
+    m.dirty = true;
+  }
+}
+
+int32_t
+WidgetHierarchy::GetParent(const int32_t aHandle) const {
+  const Node* node = m.Find(aHandle);
+  if (!node || !m.HasParent(aHandle, *node)) {
+    return -1;
+  }
+  return node->parent;
+}
+
+int32_t
+WidgetHierarchy::GetDepth(const int32_t aHandle) const {
+  const Node* node = m.Find(aHandle);
+  return node ? node->depth : 0;
+}
+
+bool
+WidgetHierarchy::IsAncestor(const int32_t aAncestor, const int32_t aHandle) const {
+  if (aAncestor == aHandle) {
+    return false;
+  }
+  const Node* ancestor = m.Find(aAncestor);
+  const Node* node = m.Find(aHandle);
+  if (!ancestor || !node) {
+    return false;
+  }
+  return ancestor->enter < node->enter && node->exit < ancestor->exit;
+}
+
+WidgetHierarchy::WidgetHierarchy(State& aState) : m(aState) {}
+
+} // namespace crow
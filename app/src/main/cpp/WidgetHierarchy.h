@@ -0,0 +1,43 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef VRBROWSER_WIDGET_HIERARCHY_H
+#define VRBROWSER_WIDGET_HIERARCHY_H
+
+#include "vrb/MacroUtils.h"
+
+#include <memory>
+#include <stdint.h>
+
+namespace crow {
+
+class WidgetHierarchy;
+typedef std::shared_ptr<WidgetHierarchy> WidgetHierarchyPtr;
+
+// Parent/child tree of widget handles. Depth and ancestor queries are answered
+// in constant time from Euler tour intervals, which are rebuilt lazily after
+// the tree changes. A parent handle that is not registered makes the widget a
+// root, the same as a missing parent widget.
+class WidgetHierarchy {
+public:
+  static WidgetHierarchyPtr Create();
+  void SetParent(const int32_t aHandle, const int32_t aParentHandle);
+  void Remove(const int32_t aHandle);
+  int32_t GetParent(const int32_t aHandle) const;
+  int32_t GetDepth(const int32_t aHandle) const;
+  bool IsAncestor(const int32_t aAncestor, const int32_t aHandle) const;
+protected:
+  struct State;
+  WidgetHierarchy(State& aState);
+  ~WidgetHierarchy() = default;
+private:
+  State& m;
+  WidgetHierarchy() = delete;
+  VRB_NO_DEFAULTS(WidgetHierarchy)
+};
+
+} // namespace crow
+
+#endif // VRBROWSER_WIDGET_HIERARCHY_H
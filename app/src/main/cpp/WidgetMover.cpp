@@ -8,6 +8,7 @@
 #include "WidgetPlacement.h"
 #include "VRBrowser.h"
 #include "Cylinder.h"
+#include "TransformCache.h"
 #include "vrb/ConcreteClass.h"
 #include "vrb/Matrix.h"
 #include "vrb/Transform.h"
@@ -47,7 +48,7 @@ struct WidgetMover::State {
       vrb::Vector min, max;
       aWidget->GetWidgetMinAndMax(min, max);
       vrb::Vector point =  aWidget->GetCylinder()->ProjectPointToQuad(aWorldPoint, 0.5f, aWidget->GetCylinderDensity(), min, max);
-      return aWidget->GetTransformNode()->GetWorldTransform().MultiplyPosition(point);
+      return aWidget->GetTransformCache()->GetWorldTransform().MultiplyPosition(point);
     } else {
       return aWorldPoint;
     }
@@ -74,7 +75,7 @@ struct WidgetMover::State {
       }
 
       // Convert the world point to a point relative to the window.
-      result = parentWidget->GetTransformNode()->GetWorldTransform().AfineInverse().MultiplyPosition(result);
+      result = parentWidget->GetTransformCache()->GetInverseWorldTransform().MultiplyPosition(result);
     }
 
     return result;
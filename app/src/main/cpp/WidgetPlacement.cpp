@@ -5,9 +5,61 @@
 
 #include "WidgetPlacement.h"
 
+#include <cstring>
+
 namespace crow {
 
 const float WidgetPlacement::kWorldDPIRatio = 2.0f/720.0f;
+const int32_t WidgetPlacement::kPackedVersion = 1;
+
+namespace {
+
+// Flag bits of the packed layout, must match WidgetPlacement.java.
+const int32_t kPackedVisible = 1 << 0;
+const int32_t kPackedShowPointer = 1 << 1;
+const int32_t kPackedComposited = 1 << 2;
+const int32_t kPackedLayer = 1 << 3;
+const int32_t kPackedProxifyLayer = 1 << 4;
+const int32_t kPackedCylinder = 1 << 5;
+
+class PackedReader {
+public:
+  PackedReader(const uint8_t* aData, const size_t aSize, size_t aOffset)
+      : mData(aData), mSize(aSize), mOffset(aOffset), mValid(true) {}
+
+  template<typename T>
+  T Read() {
+    T result = {};
+    if (!mValid || mOffset + sizeof(T) > mSize) {
+      mValid = false;
+      return result;
+    }
+    memcpy(&result, mData + mOffset, sizeof(T));
+    mOffset += sizeof(T);
+    return result;
+  }
+
+  std::string ReadString(const int32_t aLength) {
+    if (!mValid || aLength < 0 || mOffset + (size_t)aLength > mSize) {
+      mValid = false;
+      return std::string();
+    }
+    std::string result((const char*)(mData + mOffset), (size_t)aLength);
+    // Strings are padded to keep the next record aligned.
+    mOffset += ((size_t)aLength + 3) & ~(size_t)3;
+    return result;
+  }
+
+  bool IsValid() const { return mValid && mOffset <= mSize; }
+  size_t GetOffset() const { return mOffset; }
+private:
+  const uint8_t* mData;
+  const size_t mSize;
+  size_t mOffset;
+  bool mValid;
+};
+
+} // namespace
 
 WidgetPlacementPtr
 WidgetPlacement::FromJava(JNIEnv* aEnv, jobject& aObject) {
@@ -78,11 +130,66 @@ WidgetPlacement::FromJava(JNIEnv* aEnv, jobject& aObject) {
   return result;
 }
 
+WidgetPlacementPtr
+WidgetPlacement::FromBuffer(const uint8_t* aData, const size_t aSize, size_t& aOffset, int32_t& aHandle) {
+  if (!aData) {
+    return nullptr;
+  }
+
+  PackedReader reader(aData, aSize, aOffset);
+  std::shared_ptr<WidgetPlacement> result(new WidgetPlacement());
+
+  aHandle = reader.Read<int32_t>();
+  result->width = reader.Read<int32_t>();
+  result->height = reader.Read<int32_t>();
+  result->anchor.x() = reader.Read<float>();
+  result->anchor.y() = reader.Read<float>();
+  result->translation.x() = reader.Read<float>();
+  result->translation.y() = reader.Read<float>();
+  result->translation.z() = reader.Read<float>();
+  result->rotationAxis.x() = reader.Read<float>();
+  result->rotationAxis.y() = reader.Read<float>();
+  result->rotationAxis.z() = reader.Read<float>();
+  result->rotation = reader.Read<float>();
+  result->parentHandle = reader.Read<int32_t>();
+  result->parentAnchor.x() = reader.Read<float>();
+  result->parentAnchor.y() = reader.Read<float>();
+  result->density = reader.Read<float>();
+  result->worldWidth = reader.Read<float>();
+  const int32_t flags = reader.Read<int32_t>();
+  result->visible = (flags & kPackedVisible) != 0;
+  result->showPointer = (flags & kPackedShowPointer) != 0;
+  result->composited = (flags & kPackedComposited) != 0;
+  result->layer = (flags & kPackedLayer) != 0;
+  result->proxifyLayer = (flags & kPackedProxifyLayer) != 0;
+  result->cylinder = (flags & kPackedCylinder) != 0;
+  result->scene = reader.Read<int32_t>();
+  result->textureScale = reader.Read<float>();
+  result->cylinderMapRadius = reader.Read<float>();
+  result->tintColor = reader.Read<int32_t>();
+  result->borderColor = reader.Read<int32_t>();
+  result->clearColor = reader.Read<int32_t>();
+  const int32_t nameLength = reader.Read<int32_t>();
+  result->name = reader.ReadString(nameLength);
+
+  if (!reader.IsValid()) {
+    return nullptr;
+  }
+  aOffset = reader.GetOffset();
+  return result;
+}
+
 WidgetPlacementPtr
 WidgetPlacement::Create(const WidgetPlacement& aPlacement) {
   return WidgetPlacementPtr(new WidgetPlacement(aPlacement));
 }
 
+WidgetPlacementPtr
+WidgetPlacement::Create() {
+  // Value initialization zeroes every field, callers fill in the rest.
+  return WidgetPlacementPtr(new WidgetPlacement());
+}
+
 int32_t
 WidgetPlacement::GetTextureWidth() const{
   return (int32_t)ceilf(width * density * textureScale);
@@ -54,8 +54,14 @@ struct WidgetPlacement {
   WidgetPlacement::Scene GetScene() const;
 
   static const float kWorldDPIRatio;
+  // Version of the packed layout written by WidgetPlacement.packInto() in Java.
+  static const int32_t kPackedVersion;
   static WidgetPlacementPtr FromJava(JNIEnv* aEnv, jobject& aObject);
+  // Reads one packed placement at aOffset and advances it. Returns nullptr if
+  // the record does not fit in aSize bytes.
+  static WidgetPlacementPtr FromBuffer(const uint8_t* aData, const size_t aSize, size_t& aOffset, int32_t& aHandle);
   static WidgetPlacementPtr Create(const WidgetPlacement& aPlacement);
+  static WidgetPlacementPtr Create();
 private:
   WidgetPlacement() = default;
   WidgetPlacement(const WidgetPlacement&) = default;
@@ -9,6 +9,7 @@
 #include "WidgetBorder.h"
 #include "Cylinder.h"
 #include "Quad.h"
+#include "TransformCache.h"
 #include "vrb/ConcreteClass.h"
 
 #include "vrb/Color.h"
@@ -349,7 +350,7 @@ struct WidgetResizer::State {
       return widget->GetCylinder()->ProjectPointToQuad(aWorldPoint, GetAnchorX(), widget->GetCylinderDensity(), min, max);
     } else {
       // For quads just convert to world point to local point.
-      vrb::Matrix modelView = widget->GetTransformNode()->GetWorldTransform().AfineInverse();
+      vrb::Matrix modelView = widget->GetTransformCache()->GetInverseWorldTransform();
       return modelView.MultiplyPosition(aWorldPoint);
     }
   }
@@ -380,7 +381,7 @@ struct WidgetResizer::State {
     const float theta = widget->GetCylinder()->GetCylinderTheta() * sx;
     int32_t textureWidth, textureHeight;
     widget->GetCylinder()->GetTextureSize(textureWidth, textureHeight);
-    vrb::Matrix modelView = widget->GetTransformNode()->GetWorldTransform().AfineInverse();
+    vrb::Matrix modelView = widget->GetTransformCache()->GetInverseWorldTransform();
 
     // Delta for x anchor point != 0.5f.
     float centerX = 0.0f;
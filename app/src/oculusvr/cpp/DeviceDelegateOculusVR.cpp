@@ -9,6 +9,8 @@
 #include "DeviceUtils.h"
 #include "ElbowModel.h"
 #include "BrowserEGLContext.h"
+#include "LayerScheduler.h"
+#include "PoseRing.h"
 #include "VRBrowser.h"
 #include "VRLayer.h"
 
@@ -79,9 +81,12 @@ struct DeviceDelegateOculusVR::State {
   ovrJava java = {};
   ovrMobile* ovr = nullptr;
   OculusEyeSwapChainPtr eyeSwapChains[VRAPI_EYE_COUNT];
+  OculusLayerProjectionPtr projectionLayer;
+  // The last frame was submitted from projectionLayer instead of the eye buffers.
+  bool projectionLayerSubmitted = false;
   OculusLayerCubePtr cubeLayer;
   OculusLayerEquirectPtr equirectLayer;
-  std::vector<OculusLayerPtr> uiLayers;
+  LayerScheduler<OculusLayerPtr> uiLayers;
   ovrTextureSwapChain* clearColorSwapChain = nullptr;
   device::RenderMode renderMode = device::RenderMode::StandAlone;
   vrb::FBOPtr currentFBO;
@@ -94,6 +99,14 @@ struct DeviceDelegateOculusVR::State {
   ovrTracking2 prevPredictedTracking = {};
   ovrTracking2 predictedTracking = {};
   ovrTracking2 discardPredictedTracking = {};
+  struct FramePose {
+    ovrTracking2 tracking = {};
+    double displayTime = 0;
+  };
+  // Predicted poses by WebXR input frame ID, so EndFrame can use the one Gecko rendered with.
+  PoseRing<FramePose, 4> framePoses;
+  FramePose framePose;
+  bool useFramePose = false;
   uint32_t discardedFrameIndex = 0;
   int discardCount = 0;
   uint32_t renderWidth = 0;
@@ -251,7 +264,7 @@ struct DeviceDelegateOculusVR::State {
       vrb::RenderContextPtr ctx = context.lock();
       aLayer->Init(java.Env, ctx);
     }
-    uiLayers.push_back(aLayer);
+    uiLayers.Add(aLayer);
     if (aSurfaceType == VRLayerSurface::SurfaceType::FBO) {
       aLayer->SetBindDelegate([=](const vrb::FBOPtr& aFBO, GLenum aTarget, bool bound){
         if (aFBO) {
@@ -946,10 +959,11 @@ DeviceDelegateOculusVR::StartFrame(const FramePrediction aPrediction) {
 
   m.framePrediction = aPrediction;
   m.frameIndex++;
-  if (aPrediction == FramePrediction::ONE_FRAME_AHEAD) {
+  if (aPrediction != FramePrediction::NO_FRAME_AHEAD) {
     m.prevPredictedDisplayTime = m.predictedDisplayTime;
     m.prevPredictedTracking = m.predictedTracking;
-    m.predictedDisplayTime = vrapi_GetPredictedDisplayTime(m.ovr, m.frameIndex + 1);
+    const uint32_t framesAhead = aPrediction == FramePrediction::TWO_FRAMES_AHEAD ? 2 : 1;
+    m.predictedDisplayTime = vrapi_GetPredictedDisplayTime(m.ovr, m.frameIndex + framesAhead);
   } else {
     m.predictedDisplayTime = vrapi_GetPredictedDisplayTime(m.ovr, m.frameIndex);
   }
@@ -1030,11 +1044,27 @@ DeviceDelegateOculusVR::BindEye(const device::Eye aWhich) {
     VRB_LOG("No Swap chain FBO found");
   }
 
-  for (const OculusLayerPtr& layer: m.uiLayers) {
+  for (const OculusLayerPtr& layer: m.uiLayers.GetLayers()) {
     layer->SetCurrentEye(aWhich);
   }
 }
 
+void
+DeviceDelegateOculusVR::SetFramePoseId(const uint64_t aInputFrameId) {
+  State::FramePose pose;
+  pose.tracking = m.predictedTracking;
+  pose.displayTime = m.predictedDisplayTime;
+  m.framePoses.Put(aInputFrameId, pose);
+}
+
+void
+DeviceDelegateOculusVR::UseFramePose(const uint64_t aInputFrameId) {
+  m.useFramePose = m.framePoses.Get(aInputFrameId, m.framePose);
+  if (!m.useFramePose) {
+    VRB_LOG("No predicted pose for WebXR frame %llu", (unsigned long long)aInputFrameId);
+  }
+}
+
 void
 DeviceDelegateOculusVR::EndFrame(const FrameEndMode aEndMode) {
   if (!m.ovr) {
@@ -1046,9 +1076,12 @@ DeviceDelegateOculusVR::EndFrame(const FrameEndMode aEndMode) {
     m.currentFBO.reset();
   }
 
-  const bool frameAhead = m.framePrediction == FramePrediction::ONE_FRAME_AHEAD;
-  const ovrTracking2& tracking = frameAhead ? m.prevPredictedTracking : m.predictedTracking;
-  const double displayTime = frameAhead ? m.prevPredictedDisplayTime : m.predictedDisplayTime;
+  const bool frameAhead = m.framePrediction != FramePrediction::NO_FRAME_AHEAD;
+  const ovrTracking2& tracking = m.useFramePose ? m.framePose.tracking :
+                                 (frameAhead ? m.prevPredictedTracking : m.predictedTracking);
+  const double displayTime = m.useFramePose ? m.framePose.displayTime :
+                             (frameAhead ? m.prevPredictedDisplayTime : m.predictedDisplayTime);
+  m.useFramePose = false;
 
   if (aEndMode == FrameEndMode::DISCARD) {
     // Reuse the last frame when a frame is discarded.
@@ -1079,14 +1112,15 @@ DeviceDelegateOculusVR::EndFrame(const FrameEndMode aEndMode) {
     m.equirectLayer->ClearRequestDraw();
   }
 
-  // Sort quad layers by draw priority
-  std::sort(m.uiLayers.begin(), m.uiLayers.end(), [](const OculusLayerPtr & a, OculusLayerPtr & b) -> bool {
-    return a->GetLayer()->ShouldDrawBefore(*b->GetLayer());
-  });
+  // Quad layers in draw priority order
+  m.uiLayers.Update();
+  const std::vector<OculusLayerPtr>& uiLayers = m.uiLayers.GetLayers();
+  const size_t frontIndex = m.uiLayers.GetFrontIndex();
 
   // Draw back layers
-  for (const OculusLayerPtr& layer: m.uiLayers) {
-    if (!layer->GetDrawInFront() && layer->IsDrawRequested() && (layerCount < ovrMaxLayerCount - 1)) {
+  for (size_t i = 0; i < frontIndex; i++) {
+    const OculusLayerPtr& layer = uiLayers[i];
+    if (layer->IsDrawRequested() && (layerCount < ovrMaxLayerCount - 1)) {
       layer->Update(tracking, m.clearColorSwapChain);
       layers[layerCount++] = layer->Header();
       layer->ClearRequestDraw();
@@ -1098,23 +1132,37 @@ DeviceDelegateOculusVR::EndFrame(const FrameEndMode aEndMode) {
   const float fovY = vrapi_GetSystemPropertyFloat(&m.java, VRAPI_SYS_PROP_SUGGESTED_EYE_FOV_DEGREES_Y);
   const ovrMatrix4f projectionMatrix = ovrMatrix4f_CreateProjectionFov(fovX, fovY, 0.0f, 0.0f, VRAPI_ZNEAR, 0.0f);
 
+  // WebXR frames drawn into the projection layer replace the eye buffers. A discarded
+  // frame shows the last image again, from the projection layer if it came from there.
+  const bool useProjectionLayer = m.projectionLayer &&
+      (m.projectionLayer->IsDrawRequested() ||
+       (aEndMode == FrameEndMode::DISCARD && m.projectionLayerSubmitted));
   ovrLayerProjection2 projection = vrapi_DefaultLayerProjection2();
-  projection.HeadPose = tracking.HeadPose;
-  projection.Header.SrcBlend = VRAPI_FRAME_LAYER_BLEND_SRC_ALPHA;
-  projection.Header.DstBlend = VRAPI_FRAME_LAYER_BLEND_ONE_MINUS_SRC_ALPHA;
-  for (int i = 0; i < VRAPI_FRAME_LAYER_EYE_MAX; ++i) {
-    const auto &eyeSwapChain = m.eyeSwapChains[i];
-    const int swapChainIndex = m.frameIndex % eyeSwapChain->swapChainLength;
-    // Set up OVR layer textures
-    projection.Textures[i].ColorSwapChain = eyeSwapChain->ovrSwapChain;
-    projection.Textures[i].SwapChainIndex = swapChainIndex;
-    projection.Textures[i].TexCoordsFromTanAngles = ovrMatrix4f_TanAngleMatrixFromProjection(&projectionMatrix);
-  }
-  layers[layerCount++] = &projection.Header;
+  if (useProjectionLayer) {
+    m.projectionLayer->SetProjection(projectionMatrix);
+    m.projectionLayer->Update(tracking, m.clearColorSwapChain);
+    layers[layerCount++] = m.projectionLayer->Header();
+    m.projectionLayer->ClearRequestDraw();
+  } else {
+    projection.HeadPose = tracking.HeadPose;
+    projection.Header.SrcBlend = VRAPI_FRAME_LAYER_BLEND_SRC_ALPHA;
+    projection.Header.DstBlend = VRAPI_FRAME_LAYER_BLEND_ONE_MINUS_SRC_ALPHA;
+    for (int i = 0; i < VRAPI_FRAME_LAYER_EYE_MAX; ++i) {
+      const auto &eyeSwapChain = m.eyeSwapChains[i];
+      const int swapChainIndex = m.frameIndex % eyeSwapChain->swapChainLength;
+      // Set up OVR layer textures
+      projection.Textures[i].ColorSwapChain = eyeSwapChain->ovrSwapChain;
+      projection.Textures[i].SwapChainIndex = swapChainIndex;
+      projection.Textures[i].TexCoordsFromTanAngles = ovrMatrix4f_TanAngleMatrixFromProjection(&projectionMatrix);
+    }
+    layers[layerCount++] = &projection.Header;
+  }
+  m.projectionLayerSubmitted = useProjectionLayer;
 
   // Draw front layers
-  for (const OculusLayerPtr& layer: m.uiLayers) {
-    if (layer->GetDrawInFront() && layer->IsDrawRequested() && layerCount < ovrMaxLayerCount) {
+  for (size_t i = frontIndex; i < uiLayers.size(); i++) {
+    const OculusLayerPtr& layer = uiLayers[i];
+    if (layer->IsDrawRequested() && layerCount < ovrMaxLayerCount) {
       layer->Update(tracking, m.clearColorSwapChain);
       layers[layerCount++] = layer->Header();
       layer->ClearRequestDraw();
@@ -1159,12 +1207,9 @@ DeviceDelegateOculusVR::CreateLayerQuad(const VRLayerSurfacePtr& aMoveLayer) {
   VRLayerQuadPtr layer = VRLayerQuad::Create(aMoveLayer->GetWidth(), aMoveLayer->GetHeight(), aMoveLayer->GetSurfaceType());
   OculusLayerQuadPtr oculusLayer;
 
-  for (int i = 0; i < m.uiLayers.size(); ++i) {
-    if (m.uiLayers[i]->GetLayer() == aMoveLayer) {
-      oculusLayer = OculusLayerQuad::Create(m.java.Env, layer, m.uiLayers[i]);
-      m.uiLayers.erase(m.uiLayers.begin() + i);
-      break;
-    }
+  OculusLayerPtr source = m.uiLayers.Remove(aMoveLayer);
+  if (source) {
+    oculusLayer = OculusLayerQuad::Create(m.java.Env, layer, source);
   }
   if (oculusLayer) {
     m.AddUILayer(oculusLayer, aMoveLayer->GetSurfaceType());
@@ -1193,12 +1238,9 @@ DeviceDelegateOculusVR::CreateLayerCylinder(const VRLayerSurfacePtr& aMoveLayer)
   VRLayerCylinderPtr layer = VRLayerCylinder::Create(aMoveLayer->GetWidth(), aMoveLayer->GetHeight(), aMoveLayer->GetSurfaceType());
   OculusLayerCylinderPtr oculusLayer;
 
-  for (int i = 0; i < m.uiLayers.size(); ++i) {
-    if (m.uiLayers[i]->GetLayer() == aMoveLayer) {
-      oculusLayer = OculusLayerCylinder::Create(m.java.Env, layer, m.uiLayers[i]);
-      m.uiLayers.erase(m.uiLayers.begin() + i);
-      break;
-    }
+  OculusLayerPtr source = m.uiLayers.Remove(aMoveLayer);
+  if (source) {
+    oculusLayer = OculusLayerCylinder::Create(m.java.Env, layer, source);
   }
   if (oculusLayer) {
     m.AddUILayer(oculusLayer, aMoveLayer->GetSurfaceType());
@@ -1207,6 +1249,24 @@ DeviceDelegateOculusVR::CreateLayerCylinder(const VRLayerSurfacePtr& aMoveLayer)
 }
 
 
+VRLayerProjectionPtr
+DeviceDelegateOculusVR::CreateLayerProjection(int32_t aWidth, int32_t aHeight) {
+  if (!m.layersEnabled) {
+    return nullptr;
+  }
+  if (m.projectionLayer) {
+    m.projectionLayer->Destroy();
+  }
+  VRLayerProjectionPtr layer = VRLayerProjection::Create(aWidth, aHeight);
+  m.projectionLayer = OculusLayerProjection::Create(layer);
+  m.projectionLayerSubmitted = false;
+  if (m.ovr) {
+    vrb::RenderContextPtr context = m.context.lock();
+    m.projectionLayer->Init(m.java.Env, context);
+  }
+  return layer;
+}
+
 VRLayerCubePtr
 DeviceDelegateOculusVR::CreateLayerCube(int32_t aWidth, int32_t aHeight, GLint aInternalFormat) {
   if (!m.layersEnabled) {
@@ -1227,13 +1287,7 @@ DeviceDelegateOculusVR::CreateLayerCube(int32_t aWidth, int32_t aHeight, GLint a
 VRLayerEquirectPtr
 DeviceDelegateOculusVR::CreateLayerEquirect(const VRLayerPtr &aSource) {
   VRLayerEquirectPtr result = VRLayerEquirect::Create();
-  OculusLayerPtr source;
-  for (const OculusLayerPtr& layer: m.uiLayers) {
-    if (layer->GetLayer() == aSource) {
-      source = layer;
-      break;
-    }
-  }
+  OculusLayerPtr source = m.uiLayers.Find(aSource);
   if (m.equirectLayer) {
     m.equirectLayer->Destroy();
   }
@@ -1247,6 +1301,12 @@ DeviceDelegateOculusVR::CreateLayerEquirect(const VRLayerPtr &aSource) {
 
 void
 DeviceDelegateOculusVR::DeleteLayer(const VRLayerPtr& aLayer) {
+  if (m.projectionLayer && m.projectionLayer->layer == aLayer) {
+    m.projectionLayer->Destroy();
+    m.projectionLayer = nullptr;
+    m.projectionLayerSubmitted = false;
+    return;
+  }
   if (m.cubeLayer && m.cubeLayer->layer == aLayer) {
     m.cubeLayer->Destroy();
     m.cubeLayer = nullptr;
@@ -1257,12 +1317,9 @@ DeviceDelegateOculusVR::DeleteLayer(const VRLayerPtr& aLayer) {
     m.equirectLayer = nullptr;
     return;
   }
-  for (int i = 0; i < m.uiLayers.size(); ++i) {
-    if (m.uiLayers[i]->GetLayer() == aLayer) {
-      m.uiLayers[i]->Destroy();
-      m.uiLayers.erase(m.uiLayers.begin() + i);
-      return;
-    }
+  OculusLayerPtr layer = m.uiLayers.Remove(aLayer);
+  if (layer) {
+    layer->Destroy();
   }
 }
 
@@ -1279,9 +1336,12 @@ DeviceDelegateOculusVR::EnterVR(const crow::BrowserEGLContext& aEGLContext) {
     m.eyeSwapChains[i]->Init(render, m.renderMode, m.renderWidth, m.renderHeight);
   }
   vrb::RenderContextPtr context = m.context.lock();
-  for (OculusLayerPtr& layer: m.uiLayers) {
+  for (const OculusLayerPtr& layer: m.uiLayers.GetLayers()) {
     layer->Init(m.java.Env, context);
   }
+  if (m.projectionLayer) {
+    m.projectionLayer->Init(m.java.Env, context);
+  }
   if (m.cubeLayer) {
     m.cubeLayer->Init(m.java.Env, context);
   }
@@ -1327,12 +1387,15 @@ DeviceDelegateOculusVR::LeaveVR() {
 
 void
 DeviceDelegateOculusVR::OnDestroy() {
-  for (OculusLayerPtr& layer: m.uiLayers) {
+  for (const OculusLayerPtr& layer: m.uiLayers.GetLayers()) {
     layer->Destroy();
   }
   for (int i = 0; i < VRAPI_EYE_COUNT; ++i) {
     m.eyeSwapChains[i]->Destroy();
   }
+  if (m.projectionLayer) {
+    m.projectionLayer->Destroy();
+  }
   if (m.cubeLayer) {
     m.cubeLayer->Destroy();
   }
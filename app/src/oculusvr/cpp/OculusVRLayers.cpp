@@ -116,6 +116,125 @@ OculusLayerCylinder::Update(const ovrTracking2& aTracking, ovrTextureSwapChain*
 }
 
 
+// OculusLayerProjection
+
+OculusLayerProjectionPtr
+OculusLayerProjection::Create(const VRLayerProjectionPtr& aLayer) {
+  auto result = std::make_shared<OculusLayerProjection>();
+  result->layer = aLayer;
+  return result;
+}
+
+void
+OculusLayerProjection::Init(JNIEnv * aEnv, vrb::RenderContextPtr& aContext) {
+  contextWeak = aContext;
+  if (swapChain) {
+    return;
+  }
+  ovrLayer = vrapi_DefaultLayerProjection2();
+  ovrLayer.Header.SrcBlend = VRAPI_FRAME_LAYER_BLEND_SRC_ALPHA;
+  ovrLayer.Header.DstBlend = VRAPI_FRAME_LAYER_BLEND_ONE_MINUS_SRC_ALPHA;
+  InitSwapChain();
+  layer->SetResizeDelegate([=] {
+    DestroySwapChain();
+    InitSwapChain();
+  });
+  layer->SetBindDelegate([=](GLenum aTarget, bool aBind) {
+    Bind(aTarget, aBind);
+  });
+  // Drawn by the browser, there is no Java surface to wait for.
+  layer->SetInitialized(true);
+  SetComposited(true);
+}
+
+void
+OculusLayerProjection::Update(const ovrTracking2& aTracking, ovrTextureSwapChain* aClearSwapChain) {
+  OculusLayerBase<VRLayerProjectionPtr, ovrLayerProjection2>::Update(aTracking, aClearSwapChain);
+  ovrLayer.HeadPose = aTracking.HeadPose;
+  for (int i = 0; i < VRAPI_FRAME_LAYER_EYE_MAX; ++i) {
+    const device::EyeRect& textureRect = layer->GetTextureRect(i == 0 ? device::Eye::Left : device::Eye::Right);
+    ovrLayer.Textures[i].ColorSwapChain = swapChain;
+    ovrLayer.Textures[i].SwapChainIndex = swapChainIndex;
+    ovrLayer.Textures[i].TexCoordsFromTanAngles = ovrMatrix4f_TanAngleMatrixFromProjection(&projection);
+    ovrLayer.Textures[i].TextureRect.x = textureRect.mX;
+    ovrLayer.Textures[i].TextureRect.y = textureRect.mY;
+    ovrLayer.Textures[i].TextureRect.width = textureRect.mWidth;
+    ovrLayer.Textures[i].TextureRect.height = textureRect.mHeight;
+  }
+}
+
+void
+OculusLayerProjection::Destroy() {
+  fbos.clear();
+  swapChainLength = 0;
+  swapChainIndex = 0;
+  OculusLayerBase<VRLayerProjectionPtr, ovrLayerProjection2>::Destroy();
+}
+
+void
+OculusLayerProjection::SetProjection(const ovrMatrix4f& aProjection) {
+  projection = aProjection;
+}
+
+void
+OculusLayerProjection::InitSwapChain() {
+  vrb::RenderContextPtr ctx = contextWeak.lock();
+  if (!ctx) {
+    return;
+  }
+  const int32_t width = layer->GetWidth();
+  const int32_t height = layer->GetHeight();
+  swapChain = vrapi_CreateTextureSwapChain(VRAPI_TEXTURE_TYPE_2D, VRAPI_TEXTURE_FORMAT_8888,
+                                           width, height, 1, true);
+  swapChainLength = vrapi_GetTextureSwapChainLength(swapChain);
+  swapChainIndex = 0;
+  for (int i = 0; i < swapChainLength; ++i) {
+    vrb::FBOPtr fbo = vrb::FBO::Create(ctx);
+    GLuint texture = vrapi_GetTextureSwapChainHandle(swapChain, i);
+    VRB_GL_CHECK(glBindTexture(GL_TEXTURE_2D, texture));
+    VRB_GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+    VRB_GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+    VRB_GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
+    VRB_GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+    vrb::FBO::Attributes attributes;
+    attributes.depth = false;
+    attributes.samples = 0;
+    VRB_GL_CHECK(fbo->SetTextureHandle(texture, width, height, attributes));
+    if (!fbo->IsValid()) {
+      VRB_WARN("FAILED to make valid FBO for OculusLayerProjection");
+    }
+    fbos.push_back(fbo);
+  }
+}
+
+void
+OculusLayerProjection::DestroySwapChain() {
+  fbos.clear();
+  if (swapChain) {
+    vrapi_DestroyTextureSwapChain(swapChain);
+    swapChain = nullptr;
+  }
+  swapChainLength = 0;
+  swapChainIndex = 0;
+}
+
+void
+OculusLayerProjection::Bind(GLenum aTarget, bool aBind) {
+  if (fbos.empty()) {
+    return;
+  }
+  if (aBind) {
+    swapChainIndex = (swapChainIndex + 1) % swapChainLength;
+    const vrb::FBOPtr& fbo = fbos[swapChainIndex];
+    if (fbo->IsValid()) {
+      fbo->Bind(aTarget);
+      VRB_GL_CHECK(glViewport(0, 0, layer->GetWidth(), layer->GetHeight()));
+    }
+  } else {
+    fbos[swapChainIndex]->Unbind();
+  }
+}
+
 // OculusLayerCube
 
 OculusLayerCubePtr
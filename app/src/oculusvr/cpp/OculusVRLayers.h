@@ -12,6 +12,7 @@
 #include "VrApi_Helpers.h"
 #include "VrApi_SystemUtils.h"
 #include <memory>
+#include <vector>
 
 namespace crow {
 
@@ -339,6 +340,33 @@ public:
 };
 
 
+class OculusLayerProjection;
+
+typedef std::shared_ptr<OculusLayerProjection> OculusLayerProjectionPtr;
+
+// WebXR frames drawn into a buffered swap chain the compositor samples as the eye
+// buffers. Each frame is drawn into the next image, never into the one being composited.
+class OculusLayerProjection : public OculusLayerBase<VRLayerProjectionPtr, ovrLayerProjection2> {
+public:
+  static OculusLayerProjectionPtr Create(const VRLayerProjectionPtr &aLayer);
+  void Init(JNIEnv *aEnv, vrb::RenderContextPtr &aContext) override;
+  void Update(const ovrTracking2 &aTracking, ovrTextureSwapChain *aClearSwapChain) override;
+  void Destroy() override;
+  // Projection the eye buffers are sampled with, WebXR frames are rendered with the same field of view.
+  void SetProjection(const ovrMatrix4f &aProjection);
+
+protected:
+  void InitSwapChain();
+  void DestroySwapChain();
+  void Bind(GLenum aTarget, bool aBind);
+
+  vrb::RenderContextWeak contextWeak;
+  std::vector<vrb::FBOPtr> fbos;
+  int swapChainLength = 0;
+  int swapChainIndex = 0;
+  ovrMatrix4f projection = {};
+};
+
 class OculusLayerCube;
 
 typedef std::shared_ptr<OculusLayerCube> OculusLayerCubePtr;
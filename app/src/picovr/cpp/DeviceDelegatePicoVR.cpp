@@ -56,7 +56,7 @@ struct DeviceDelegatePicoVR::State {
     float axisX = 0;
     float axisY = 0;
     ElbowModel::HandEnum hand;
-    int hapticFrameID = 0;
+    uint64_t hapticFrameID = 0;
     Controller()
         : index(-1)
         , created(false)
@@ -158,6 +158,7 @@ struct DeviceDelegatePicoVR::State {
 
     if (aController.hapticFrameID != inputFrameID) {
       VRBrowserPico::UpdateHaptics(aController.index, pulseIntensity, pulseDuration);
+      aController.hapticFrameID = inputFrameID;
     }
   }
 
@@ -411,6 +412,18 @@ DeviceDelegatePicoVR::ProcessEvents() {
 
 }
 
+float
+DeviceDelegatePicoVR::GetPosePredictionFrames() const {
+  // Head and controller poses come from the latest sensor events, not from a display time prediction.
+  return 1.0f;
+}
+
+bool
+DeviceDelegatePicoVR::NeedsFrameReprojection() const {
+  // The eye buffers are submitted from Java every frame, a discarded frame shows stale content.
+  return true;
+}
+
 void
 DeviceDelegatePicoVR::StartFrame(const FramePrediction aPrediction) {
   vrb::Matrix head = vrb::Matrix::Rotation(m.orientation);
@@ -40,6 +40,8 @@ public:
   void StartFrame(const FramePrediction aPrediction) override;
   void BindEye(const device::Eye aWhich) override;
   void EndFrame(const FrameEndMode aMode) override;
+  float GetPosePredictionFrames() const override;
+  bool NeedsFrameReprojection() const override;
   bool IsInGazeMode() const override;
   int32_t GazeModeIndex() const override;
   bool IsControllerLightEnabled() const override;
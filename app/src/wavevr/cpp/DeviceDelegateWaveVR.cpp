@@ -911,6 +911,12 @@ DeviceDelegateWaveVR::EndFrame(const FrameEndMode aMode) {
   }
 }
 
+bool
+DeviceDelegateWaveVR::NeedsFrameReprojection() const {
+  // Skipping WVR_SubmitFrame makes the compositor repeat the last frame without correction.
+  return true;
+}
+
 bool
 DeviceDelegateWaveVR::IsRunning() {
   return m.isRunning;
@@ -35,6 +35,7 @@ public:
   void StartFrame(const FramePrediction aPrediction) override;
   void BindEye(const device::Eye aWhich) override;
   void EndFrame(const FrameEndMode aMode) override;
+  bool NeedsFrameReprojection() const override;
   // DeviceDelegateWaveVR interface
   bool IsRunning();
 protected: